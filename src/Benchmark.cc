@@ -0,0 +1,358 @@
+#include "Benchmark.hh"
+#include "Reactor.hh"
+#include "MSXMotherBoard.hh"
+#include "GlobalCommandController.hh"
+#include "EventDistributor.hh"
+#include "InputEvents.hh"
+#include "CliComm.hh"
+#include "CommandException.hh"
+#include "MSXException.hh"
+#include "FileContext.hh"
+#include "HostTimeProfile.hh"
+#include "PostProcessor.hh"
+#include "KernelBenchmark.hh"
+#include "Timer.hh"
+#include "StringOp.hh"
+#include "memory.hh"
+#include "outer.hh"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cassert>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+Benchmark::Benchmark(Reactor& reactor_)
+	: cmd(reactor_.getGlobalCommandController())
+	, reactor(reactor_)
+	, startTime(EmuTime::zero)
+	, hostStartTime(0)
+	, exitWhenDone(false)
+{
+}
+
+Benchmark::~Benchmark()
+{
+	abort();
+}
+
+void Benchmark::start(const string& filename, double duration,
+                      const string& renderer, bool sound, int frameSkip,
+                      int breakPoints, bool exitWhenDone_)
+{
+	if (isRunning()) {
+		throw CommandException("A benchmark is already running.");
+	}
+	if (duration <= 0.0) {
+		throw CommandException("Duration must be positive.");
+	}
+	if ((breakPoints < 0) || (breakPoints > 0x10000)) {
+		throw CommandException("Number of breakpoints must be in range 0..65536.");
+	}
+
+	TclObject command;
+	command.addListElement("reverse");
+	command.addListElement("loadreplay");
+	command.addListElement("-viewonly");
+	command.addListElement(filename);
+	command.executeCommand(reactor.getInterpreter());
+
+	auto* motherBoard = reactor.getMotherBoard();
+	if (!motherBoard) {
+		throw CommandException("No machine after loading the replay.");
+	}
+
+	// Which objects make snapshots of this machine expensive. Measured
+	// before the run, so that it doesn't influence the result.
+	TclObject sizesCommand;
+	sizesCommand.addListElement("reverse");
+	sizesCommand.addListElement("debug");
+	sizesCommand.addListElement("sizes");
+	snapshotSizes = sizesCommand.executeCommand(
+		reactor.getInterpreter()).getString().str();
+
+	try {
+		changeSetting("throttle", TclObject("off"));
+		changeSetting("mute", TclObject(sound ? "off" : "on"));
+		changeSetting("minframeskip", TclObject(frameSkip));
+		changeSetting("maxframeskip", TclObject(frameSkip));
+		if (!renderer.empty()) {
+			changeSetting("renderer", TclObject(renderer));
+		}
+		setBreakPoints(breakPoints);
+	} catch (MSXException&) {
+		restoreSettings();
+		throw;
+	}
+
+	exitWhenDone = exitWhenDone_;
+	startTime = motherBoard->getCurrentTime();
+	stopper = make_unique<Stopper>(motherBoard->getScheduler(), *this,
+	                               startTime + EmuDuration(duration));
+	hostStartTime = Timer::getTime();
+	HostTimeProfile::start();
+	PostProcessor::resetLineStats();
+}
+
+void Benchmark::abort()
+{
+	if (!isRunning()) return;
+	HostTimeProfile::stop();
+	stopper.reset();
+	restoreSettings();
+}
+
+void Benchmark::finish(EmuTime::param time)
+{
+	HostTimeProfile::stop();
+	auto hostTime = Timer::getTime() - hostStartTime;
+	lastResult = formatResult(time - startTime, hostTime);
+	restoreSettings();
+
+	reactor.getCliComm().printInfo(lastResult);
+	if (exitWhenDone) {
+		std::cout << lastResult << std::flush;
+		reactor.getEventDistributor().distributeEvent(
+			std::make_shared<QuitEvent>());
+	}
+	// Note: this is called from Stopper::executeUntil(), so this deletes
+	// the object that's currently executing. That's fine as long as this
+	// is the last statement.
+	stopper.reset();
+}
+
+string Benchmark::formatResult(EmuDuration emuDuration, uint64_t hostTime) const
+{
+	double emuSeconds  = emuDuration.toDouble();
+	double hostSeconds = hostTime / 1000000.0;
+	std::ostringstream os;
+	os << std::fixed << std::setprecision(3)
+	   << "emulated " << emuSeconds << "s in " << hostSeconds
+	   << "s host time: "
+	   << (hostSeconds > 0.0 ? emuSeconds / hostSeconds : 0.0)
+	   << " emulated seconds per host second\n";
+	for (int i = 0; i < HostTimeProfile::NUM_CATEGORIES; ++i) {
+		auto c = HostTimeProfile::Category(i);
+		auto us = HostTimeProfile::get(c);
+		os << "  " << std::left << std::setw(12)
+		   << HostTimeProfile::getName(c) << std::right
+		   << std::setw(10) << us / 1000 << "ms "
+		   << std::setw(7) << std::setprecision(1)
+		   << (hostTime ? 100.0 * us / hostTime : 0.0) << "%\n"
+		   << std::setprecision(3);
+	}
+	auto scaled = PostProcessor::getScaledLines();
+	auto reused = PostProcessor::getReusedLines();
+	if (scaled + reused) {
+		os << "post processing: " << std::setprecision(1)
+		   << 100.0 * reused / (scaled + reused)
+		   << "% of the output lines reused from the previous image\n"
+		   << std::setprecision(3);
+	}
+	if (!breakPointIds.empty()) {
+		os << "with " << breakPointIds.size()
+		   << " PC breakpoints set (never triggered)\n";
+	}
+	os << "snapshot size per object:\n" << snapshotSizes;
+	return os.str();
+}
+
+void Benchmark::changeSetting(const char* name, const TclObject& value)
+{
+	auto& interp = reactor.getInterpreter();
+	TclObject get;
+	get.addListElement("set");
+	get.addListElement(name);
+	savedSettings.emplace_back(name, get.executeCommand(interp));
+
+	TclObject set = get;
+	set.addListElement(value);
+	set.executeCommand(interp);
+}
+
+void Benchmark::restoreSettings()
+{
+	removeBreakPoints();
+	auto& interp = reactor.getInterpreter();
+	for (auto& s : savedSettings) {
+		TclObject set;
+		set.addListElement("set");
+		set.addListElement(s.first);
+		set.addListElement(s.second);
+		try {
+			set.executeCommand(interp);
+		} catch (CommandException&) {
+			// ignore, e.g. the renderer can't be switched back
+		}
+	}
+	savedSettings.clear();
+}
+
+// Spread the breakpoints evenly over the address space, so that (for a
+// realistic number of them) they hit the lines of frequently executed code as
+// well. Their condition is always false, so they never break, but the CPU
+// still has to check them.
+void Benchmark::setBreakPoints(int num)
+{
+	auto& interp = reactor.getInterpreter();
+	for (int i = 0; i < num; ++i) {
+		TclObject set;
+		set.addListElement("debug");
+		set.addListElement("set_bp");
+		set.addListElement(int((i * 0x10000) / num));
+		set.addListElement("0");
+		breakPointIds.push_back(set.executeCommand(interp));
+	}
+}
+
+void Benchmark::removeBreakPoints()
+{
+	auto& interp = reactor.getInterpreter();
+	for (auto& id : breakPointIds) {
+		TclObject remove;
+		remove.addListElement("debug");
+		remove.addListElement("remove_bp");
+		remove.addListElement(id);
+		try {
+			remove.executeCommand(interp);
+		} catch (CommandException&) {
+			// ignore, e.g. already removed by the user
+		}
+	}
+	breakPointIds.clear();
+}
+
+
+// class Stopper
+
+Benchmark::Stopper::Stopper(Scheduler& scheduler_, Benchmark& benchmark_,
+                            EmuTime::param time)
+	: Schedulable(scheduler_)
+	, benchmark(benchmark_)
+{
+	setSyncPoint(time);
+}
+
+void Benchmark::Stopper::executeUntil(EmuTime::param time)
+{
+	benchmark.finish(time);
+}
+
+void Benchmark::Stopper::schedulerDeleted()
+{
+	// The machine was deleted (e.g. 'reverse goto' or another
+	// 'loadreplay'), the measurement is meaningless now.
+	auto& b = benchmark;
+	b.reactor.getCliComm().printWarning(
+		"Benchmark aborted: the machine was replaced.");
+	b.abort(); // deletes this object
+}
+
+
+// class Cmd
+
+Benchmark::Cmd::Cmd(CommandController& commandController_)
+	: Command(commandController_, "benchmark")
+{
+}
+
+void Benchmark::Cmd::execute(array_ref<TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() < 2) {
+		throw SyntaxError();
+	}
+	auto& benchmark = OUTER(Benchmark, cmd);
+	string_ref subcommand = tokens[1].getString();
+	if (subcommand == "start") {
+		string renderer;
+		bool sound = false;
+		int frameSkip = 0;
+		int breakPoints = 0;
+		bool exit = false;
+		vector<string_ref> args;
+		for (size_t i = 2; i < tokens.size(); ++i) {
+			string_ref opt = tokens[i].getString();
+			if ((opt == "-renderer") && (++i < tokens.size())) {
+				renderer = tokens[i].getString().str();
+			} else if ((opt == "-sound") && (++i < tokens.size())) {
+				sound = tokens[i].getBoolean(getInterpreter());
+			} else if ((opt == "-frameskip") && (++i < tokens.size())) {
+				frameSkip = tokens[i].getInt(getInterpreter());
+			} else if ((opt == "-breakpoints") && (++i < tokens.size())) {
+				breakPoints = tokens[i].getInt(getInterpreter());
+			} else if (opt == "-exit") {
+				exit = true;
+			} else if (StringOp::startsWith(opt, '-')) {
+				throw SyntaxError();
+			} else {
+				args.push_back(opt);
+			}
+		}
+		if (args.size() != 2) {
+			throw SyntaxError();
+		}
+		TclObject durationObj(args[1]);
+		double duration = durationObj.getDouble(getInterpreter());
+		benchmark.start(args[0].str(), duration, renderer, sound,
+		                frameSkip, breakPoints, exit);
+	} else if (subcommand == "abort") {
+		benchmark.abort();
+	} else if (subcommand == "status") {
+		result.setBoolean(benchmark.isRunning());
+	} else if (subcommand == "result") {
+		result.setString(benchmark.lastResult);
+	} else if (subcommand == "kernels") {
+		result.setString(KernelBenchmark::run());
+	} else {
+		throw SyntaxError();
+	}
+}
+
+string Benchmark::Cmd::help(const vector<string>& /*tokens*/) const
+{
+	return "Measure the emulation speed.\n"
+	       "benchmark start <replay> <seconds> [-renderer <name>] [-sound <bool>] [-frameskip <n>] [-breakpoints <n>] [-exit]\n"
+	       "    Load the given replay and run it unthrottled for the given "
+	       "amount of emulated time. Sound is muted by default, frame "
+	       "skipping is fixed (default 0) to make the result reproducible. "
+	       "With -breakpoints the given number of PC breakpoints (spread "
+	       "over the address space, with a condition that's always false) "
+	       "is set during the run, to measure their cost. "
+	       "When finished the result is printed and all changed settings "
+	       "are restored. With -exit the result is also printed on stdout "
+	       "and openMSX quits.\n"
+	       "benchmark abort     stop the running benchmark\n"
+	       "benchmark status    is a benchmark running?\n"
+	       "benchmark result    result of the last finished benchmark\n"
+	       "benchmark kernels   compare the speed of the SSE2 and AVX2 "
+	       "variants of the pixel routines\n"
+	       "The result shows the emulated seconds per host second and how "
+	       "the host time was spent: CPU emulation, sync point callbacks "
+	       "(scheduler), VDP rendering, scaling/post-processing, sound "
+	       "generation and Tcl. For the SDL renderers it also shows how "
+	       "many output lines didn't have to be scaled because they were "
+	       "unchanged since the previous image.\n";
+}
+
+void Benchmark::Cmd::tabCompletion(vector<string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static const char* const subCommands[] = {
+			"start", "abort", "status", "result", "kernels",
+		};
+		completeString(tokens, subCommands);
+	} else if ((tokens.size() == 3) && (tokens[1] == "start")) {
+		completeFileName(tokens, userFileContext("replays"));
+	} else if ((tokens.size() > 4) && (tokens[1] == "start")) {
+		static const char* const options[] = {
+			"-renderer", "-sound", "-frameskip", "-breakpoints",
+			"-exit",
+		};
+		completeString(tokens, options);
+	}
+}
+
+} // namespace openmsx
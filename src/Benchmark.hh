@@ -0,0 +1,92 @@
+#ifndef BENCHMARK_HH
+#define BENCHMARK_HH
+
+#include "Command.hh"
+#include "Schedulable.hh"
+#include "EmuTime.hh"
+#include "TclObject.hh"
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+
+namespace openmsx {
+
+class Reactor;
+class MSXMotherBoard;
+
+/** Measures the emulation speed by running a replay unthrottled for a fixed
+  * amount of emulated time.
+  *
+  * A replay (savestate plus input events) fully determines what the emulated
+  * machine does, so as long as the same replay, duration and settings are
+  * used the host has to do exactly the same work in every run. Frame
+  * skipping normally depends on the host speed, so during the benchmark it
+  * is fixed as well.
+  *
+  * Besides the overall speed the host time is split into a few categories,
+  * see HostTimeProfile.
+  */
+class Benchmark
+{
+public:
+	explicit Benchmark(Reactor& reactor);
+	~Benchmark();
+
+	/** Load the replay and start measuring.
+	  * @param filename Replay file, see 'reverse loadreplay'.
+	  * @param duration Amount of emulated time to run (in seconds).
+	  * @param renderer Value for the 'renderer' setting, empty to keep
+	  *                 the current value.
+	  * @param sound Enable/disable sound (restored afterwards).
+	  * @param frameSkip Render 1 out of every 'frameSkip+1' frames.
+	  * @param breakPoints Number of (never triggering) PC breakpoints to
+	  *                    set during the run, to measure their cost.
+	  * @param exitWhenDone Print the result on stdout and quit openMSX
+	  *                     when finished (used by the -benchmark option).
+	  */
+	void start(const std::string& filename, double duration,
+	           const std::string& renderer, bool sound, int frameSkip,
+	           int breakPoints, bool exitWhenDone);
+	void abort();
+	bool isRunning() const { return stopper != nullptr; }
+
+private:
+	void finish(EmuTime::param time);
+	std::string formatResult(EmuDuration emuDuration, uint64_t hostTime) const;
+	void changeSetting(const char* name, const TclObject& value);
+	void restoreSettings();
+	void setBreakPoints(int num);
+	void removeBreakPoints();
+
+	struct Stopper final : Schedulable {
+		Stopper(Scheduler& scheduler, Benchmark& benchmark,
+		        EmuTime::param time);
+		void executeUntil(EmuTime::param time) override;
+		void schedulerDeleted() override;
+		Benchmark& benchmark;
+	};
+
+	struct Cmd final : Command {
+		explicit Cmd(CommandController& commandController);
+		void execute(array_ref<TclObject> tokens,
+		             TclObject& result) override;
+		std::string help(const std::vector<std::string>& tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} cmd;
+
+	Reactor& reactor;
+	std::unique_ptr<Stopper> stopper; // only when running
+	std::vector<std::pair<std::string, TclObject>> savedSettings;
+	std::vector<TclObject> breakPointIds;
+	std::string lastResult;
+	std::string snapshotSizes; // see 'reverse debug sizes'
+	EmuTime startTime;
+	uint64_t hostStartTime;
+	bool exitWhenDone;
+};
+
+} // namespace openmsx
+
+#endif
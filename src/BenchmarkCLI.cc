@@ -0,0 +1,35 @@
+#include "BenchmarkCLI.hh"
+#include "CommandLineParser.hh"
+#include "TclObject.hh"
+
+using std::string;
+
+namespace openmsx {
+
+BenchmarkCLI::BenchmarkCLI(CommandLineParser& parser_)
+	: parser(parser_)
+{
+	parser.registerOption("-benchmark", *this);
+}
+
+void BenchmarkCLI::parseOption(const string& option, array_ref<string>& cmdLine)
+{
+	string replay   = getArgument(option, cmdLine);
+	string duration = getArgument(option, cmdLine);
+
+	TclObject command;
+	command.addListElement("benchmark");
+	command.addListElement("start");
+	command.addListElement(replay);
+	command.addListElement(duration);
+	command.addListElement("-exit");
+	command.executeCommand(parser.getInterpreter());
+}
+
+string_ref BenchmarkCLI::optionHelp() const
+{
+	return "Run replay <file> unthrottled for <seconds> of emulated time, "
+	       "print the speed and quit";
+}
+
+} // namespace openmsx
@@ -0,0 +1,24 @@
+#ifndef BENCHMARKCLI_HH
+#define BENCHMARKCLI_HH
+
+#include "CLIOption.hh"
+
+namespace openmsx {
+
+class CommandLineParser;
+
+class BenchmarkCLI final : public CLIOption
+{
+public:
+	explicit BenchmarkCLI(CommandLineParser& commandLineParser);
+	void parseOption(const std::string& option,
+	                 array_ref<std::string>& cmdLine) override;
+	string_ref optionHelp() const override;
+
+private:
+	CommandLineParser& parser;
+};
+
+} // namespace openmsx
+
+#endif
@@ -45,6 +45,7 @@ CommandLineParser::CommandLineParser(Reactor& reactor_)
 	, cliExtension(*this)
 	, replayCLI(*this)
 	, saveStateCLI(*this)
+	, benchmarkCLI(*this)
 	, cassettePlayerCLI(*this)
 #if COMPONENT_LASERDISC
 	, laserdiscPlayerCLI(*this)
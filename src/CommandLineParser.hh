@@ -6,6 +6,7 @@
 #include "CliExtension.hh"
 #include "ReplayCLI.hh"
 #include "SaveStateCLI.hh"
+#include "BenchmarkCLI.hh"
 #include "CassettePlayerCLI.hh"
 #include "DiskImageCLI.hh"
 #include "HDImageCLI.hh"
@@ -135,6 +136,7 @@ private:
 	CliExtension cliExtension;
 	ReplayCLI replayCLI;
 	SaveStateCLI saveStateCLI;
+	BenchmarkCLI benchmarkCLI;
 	CassettePlayerCLI cassettePlayerCLI;
 #if COMPONENT_LASERDISC
 	LaserdiscPlayerCLI laserdiscPlayerCLI;
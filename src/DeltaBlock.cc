@@ -0,0 +1,242 @@
+#include "DeltaBlock.hh"
+#include "ThreadPool.hh"
+#include "snappy.hh"
+#include <algorithm>
+#include <mutex>
+#include <cstring>
+#include <cassert>
+
+namespace openmsx {
+
+// Protects the content of all pages (a page is replaced by its compressed
+// version on a worker thread) and the pool of uncompressed page buffers.
+static std::mutex pageMutex;
+
+// Buffers (of PAGE_SIZE bytes) for uncompressed pages. These are allocated
+// on the emulation thread and released again on the worker thread, reusing
+// them keeps malloc/free out of the snapshot code.
+static std::vector<MemBuffer<uint8_t>> rawPool;
+static const size_t MAX_RAW_POOL_SIZE = 1024;
+
+static MemBuffer<uint8_t> allocRawPage()
+{
+	{
+		std::lock_guard<std::mutex> lock(pageMutex);
+		if (!rawPool.empty()) {
+			auto result = std::move(rawPool.back());
+			rawPool.pop_back();
+			return result;
+		}
+	}
+	return MemBuffer<uint8_t>(DeltaBlock::PAGE_SIZE);
+}
+
+// class DeltaBlock
+
+#ifndef _MSC_VER
+// This line is required according to the c++ standard, but because of a vc++
+// extension, we get a link error in vc++ when we add this line.
+const size_t DeltaBlock::PAGE_SIZE;
+#endif
+
+DeltaBlock::DeltaBlock()
+	: size(0)
+	, prefetchWanted(false)
+{
+}
+
+void DeltaBlock::apply(uint8_t* dst, size_t size_) const
+{
+	assert(size_ == size); (void)size_;
+	{
+		std::lock_guard<std::mutex> lock(pageMutex);
+		if (!prefetched.empty()) {
+			memcpy(dst, prefetched.data(), size);
+			return;
+		}
+	}
+	for (size_t i = 0; i < pages.size(); ++i) {
+		size_t offset = i * PAGE_SIZE;
+		size_t len = std::min(PAGE_SIZE, size - offset);
+		const auto& page = *pages[i];
+		{
+			std::lock_guard<std::mutex> lock(pageMutex);
+			if (!page.compressed) {
+				// can be replaced by its compressed version
+				assert(page.size == len);
+				memcpy(dst + offset, page.data.data(), len);
+				continue;
+			}
+		}
+		// A compressed page never changes anymore, so decompress
+		// it without holding the lock.
+		snappy::uncompress(
+			reinterpret_cast<const char*>(page.data.data()),
+			page.size, reinterpret_cast<char*>(dst + offset), len);
+	}
+}
+
+void DeltaBlock::requestPrefetch()
+{
+	std::lock_guard<std::mutex> lock(pageMutex);
+	prefetchWanted = true;
+}
+
+void DeltaBlock::prefetch()
+{
+	{
+		std::lock_guard<std::mutex> lock(pageMutex);
+		if (!prefetchWanted || !prefetched.empty()) return;
+	}
+	// apply() only holds the lock to copy the uncompressed pages, so the
+	// emulation thread isn't blocked while we decompress.
+	MemBuffer<uint8_t> buf(size);
+	apply(buf.data(), size);
+	std::lock_guard<std::mutex> lock(pageMutex);
+	if (prefetchWanted && prefetched.empty()) {
+		std::swap(prefetched, buf);
+	}
+	// else: dropped in the mean time, 'buf' is freed after the unlock
+}
+
+void DeltaBlock::dropPrefetched()
+{
+	MemBuffer<uint8_t> tmp; // free outside the lock
+	std::lock_guard<std::mutex> lock(pageMutex);
+	prefetchWanted = false;
+	std::swap(prefetched, tmp);
+}
+
+size_t DeltaBlock::getMemorySize(
+	const DeltaBlock* prev, const DeltaBlock* next) const
+{
+	auto isShared = [&](const DeltaBlock* other, size_t i) {
+		return other && (other->pages.size() == pages.size()) &&
+		       (other->pages[i] == pages[i]);
+	};
+	size_t result = 0;
+	std::lock_guard<std::mutex> lock(pageMutex);
+	for (size_t i = 0; i < pages.size(); ++i) {
+		if (!isShared(prev, i) && !isShared(next, i)) {
+			result += pages[i]->size;
+		}
+	}
+	if (!prefetched.empty()) result += size;
+	return result;
+}
+
+
+// class LastDeltaBlocks
+
+LastDeltaBlocks::LastDeltaBlocks(ThreadPool* compressor_)
+	: compressor(compressor_)
+{
+}
+
+void LastDeltaBlocks::compressPage(DeltaBlock::Page& page)
+{
+	// The uncompressed data is never modified and only this function
+	// replaces it, so it can be read without holding the lock.
+	assert(!page.compressed);
+	size_t len = page.size;
+	size_t dstLen = snappy::maxCompressedLength(len);
+	MemBuffer<uint8_t> buf(dstLen);
+	snappy::compress(reinterpret_cast<const char*>(page.data.data()), len,
+	                 reinterpret_cast<char*>(buf.data()), dstLen);
+	if (dstLen >= len) {
+		// incompressible, keep as-is
+		return;
+	}
+	buf.resize(dstLen);
+
+	std::lock_guard<std::mutex> lock(pageMutex);
+	std::swap(page.data, buf);
+	page.size = dstLen;
+	page.compressed = true;
+	if (rawPool.size() < MAX_RAW_POOL_SIZE) {
+		rawPool.push_back(std::move(buf));
+	}
+}
+
+std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNew(
+	const void* id, const uint8_t* data, size_t size, DirtyPages* dirty)
+{
+	auto& info = infos[std::make_pair(id, size)];
+	info.used = true;
+	const DeltaBlock* prev = info.block.get();
+	if (!prev) {
+		info.copy.resize(size);
+	}
+	// Only skip the comparison when 'info.copy' is the state in which we
+	// last saw this blob (e.g. not after clear()).
+	bool trustDirty = prev && dirty && dirty->isSyncedWith(this);
+
+	auto block = std::make_shared<DeltaBlock>();
+	block->size = size;
+	size_t numPages = (size + DeltaBlock::PAGE_SIZE - 1) / DeltaBlock::PAGE_SIZE;
+	block->pages.reserve(numPages);
+	for (size_t i = 0; i < numPages; ++i) {
+		size_t offset = i * DeltaBlock::PAGE_SIZE;
+		size_t len = std::min(DeltaBlock::PAGE_SIZE, size - offset);
+		if (trustDirty && !dirty->isDirty(i)) {
+			block->pages.push_back(prev->pages[i]);
+			continue;
+		}
+		// Compare with the actual (uncompressed) content of the
+		// previous snapshot. A hash would need less memory, but a
+		// collision would silently corrupt the restored state.
+		if (prev && (memcmp(&info.copy[offset], data + offset, len) == 0)) {
+			block->pages.push_back(prev->pages[i]);
+			continue;
+		}
+		memcpy(&info.copy[offset], data + offset, len);
+
+		auto page = std::make_shared<DeltaBlock::Page>();
+		page->data = allocRawPage();
+		memcpy(page->data.data(), data + offset, len);
+		page->size = len;
+		page->compressed = false;
+		if (compressor) {
+			// Only keep a weak reference: no need to compress pages
+			// of snapshots that are already dropped again.
+			std::weak_ptr<DeltaBlock::Page> weak = page;
+			compressor->addTask([weak] {
+				if (auto p = weak.lock()) compressPage(*p);
+			});
+		} else {
+			compressPage(*page);
+		}
+		block->pages.push_back(std::move(page));
+	}
+	info.block = block;
+	if (dirty) dirty->sync(this);
+	return block;
+}
+
+void LastDeltaBlocks::prune()
+{
+	for (auto it = infos.begin(); it != infos.end(); /**/) {
+		if (it->second.used) {
+			it->second.used = false;
+			++it;
+		} else {
+			it = infos.erase(it);
+		}
+	}
+}
+
+void LastDeltaBlocks::clear()
+{
+	infos.clear();
+}
+
+size_t LastDeltaBlocks::getMemorySize() const
+{
+	size_t result = 0;
+	for (auto& p : infos) {
+		result += p.first.second; // size of 'copy'
+	}
+	return result;
+}
+
+} // namespace openmsx
@@ -0,0 +1,122 @@
+#ifndef DELTABLOCK_HH
+#define DELTABLOCK_HH
+
+#include "MemBuffer.hh"
+#include "DirtyPages.hh"
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+
+namespace openmsx {
+
+class ThreadPool;
+
+/** Compressed representation of a (large) blob in a reverse snapshot.
+  *
+  * The blob is split in fixed-size pages, each page is compressed
+  * separately. Pages that didn't change since the previous snapshot are not
+  * stored again, instead the (reference counted) page of the previous
+  * snapshot is shared. Typically only a small part of the RAM and VRAM
+  * changes between two snapshots, so this saves a lot of memory (and
+  * compression time).
+  *
+  * Each page is self-contained, so restoring a snapshot never has to walk a
+  * chain of deltas and dropping older snapshots never invalidates newer
+  * ones.
+  *
+  * Changed pages are first stored uncompressed, compression can then
+  * happen later on a worker thread (see LastDeltaBlocks). A page can be
+  * restored in both states.
+  */
+class DeltaBlock
+{
+public:
+	static const size_t PAGE_SIZE = DirtyPages::PAGE_SIZE;
+
+	DeltaBlock();
+
+	/** Restore the original blob. Can be called while some of the pages
+	  * are still being compressed. */
+	void apply(uint8_t* dst, size_t size) const;
+
+	/** Mark this block for prefetch(). Must be called (on the emulation
+	  * thread) before prefetch() is scheduled. */
+	void requestPrefetch();
+	/** Decompress the whole blob in advance, so that a later apply() is
+	  * only a memcpy. Meant to be called on a worker thread for snapshots
+	  * that will (likely) be restored soon, see ReverseManager. Does
+	  * nothing when the request was cancelled (by dropPrefetched()) in the
+	  * mean time, also not when that happens while decompressing. */
+	void prefetch();
+	/** Cancel requestPrefetch() and free the memory allocated by
+	  * prefetch(). */
+	void dropPrefetched();
+
+	/** Memory used by the pages of this block that are not shared with
+	  * the given neighbouring blocks (those can be nullptr), plus the
+	  * prefetched copy (if any). Pages are only ever shared with the same
+	  * page of the previous or next snapshot. */
+	size_t getMemorySize(const DeltaBlock* prev, const DeltaBlock* next) const;
+
+private:
+	struct Page {
+		MemBuffer<uint8_t> data;
+		size_t size; // size of 'data'
+		bool compressed;
+	};
+	std::vector<std::shared_ptr<Page>> pages;
+	size_t size; // size of the original blob
+	MemBuffer<uint8_t> prefetched; // empty unless prefetch() was called
+	bool prefetchWanted; // protected by the page mutex
+
+	friend class LastDeltaBlocks;
+};
+
+/** Remembers the content of each blob in the most recent snapshot, so that
+  * the next snapshot can find the unchanged pages.
+  */
+class LastDeltaBlocks
+{
+public:
+	/** @param compressor When not null, changed pages are compressed
+	  *                   asynchronously by this pool, otherwise they are
+	  *                   compressed immediately. */
+	explicit LastDeltaBlocks(ThreadPool* compressor = nullptr);
+
+	/** Create a DeltaBlock for the given blob.
+	  * @param id Identifies the blob between consecutive snapshots. We use
+	  *           the address of the data, that's stable for the blobs
+	  *           that matter (RAM, VRAM, ...).
+	  * @param dirty When not null, the pages that were not written since
+	  *              the previous call (for the same blob) are reused
+	  *              without comparing them.
+	  */
+	std::shared_ptr<DeltaBlock> createNew(
+		const void* id, const uint8_t* data, size_t size,
+		DirtyPages* dirty = nullptr);
+
+	/** Forget blobs that were not part of the last snapshot (e.g. belonged
+	  * to a device that was removed in the mean time). */
+	void prune();
+
+	void clear();
+
+	/** Memory used by the uncompressed copies of the last blobs. */
+	size_t getMemorySize() const;
+
+private:
+	static void compressPage(DeltaBlock::Page& page);
+
+	struct Info {
+		std::shared_ptr<DeltaBlock> block;
+		MemBuffer<uint8_t> copy; // uncompressed content of 'block'
+		bool used;
+	};
+	std::map<std::pair<const void*, size_t>, Info> infos;
+	ThreadPool* compressor;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef DIRTYPAGES_HH
+#define DIRTYPAGES_HH
+
+#include <vector>
+#include <cstddef>
+
+namespace openmsx {
+
+/** Keeps track of which pages of a memory block (e.g. a Ram object) were
+  * written since the previous reverse snapshot. LastDeltaBlocks can then
+  * reuse the pages of the previous snapshot without even comparing them, so
+  * the cost of a snapshot becomes proportional to the amount of memory that
+  * actually changed.
+  *
+  * Tracking is off by default, then all pages are always reported as dirty.
+  * The owner of the memory may only enable it when really all writes are
+  * reported, including writes via pointers that are handed out to other
+  * components (e.g. the CPU write cache lines).
+  */
+class DirtyPages
+{
+public:
+	static const unsigned PAGE_BITS = 12;
+	static const size_t PAGE_SIZE = size_t(1) << PAGE_BITS;
+
+	explicit DirtyPages(size_t size)
+		: pages((size + PAGE_SIZE - 1) >> PAGE_BITS, true)
+		, syncedWith(nullptr)
+		, tracking(false)
+	{
+	}
+
+	void enableTracking(bool enable)
+	{
+		tracking = enable;
+		markAll();
+	}
+	bool isTracking() const { return tracking; }
+
+	void mark(size_t addr)
+	{
+		pages[addr >> PAGE_BITS] = true;
+	}
+	void mark(size_t addr, size_t size)
+	{
+		if (size == 0) return;
+		size_t last = (addr + size - 1) >> PAGE_BITS;
+		for (size_t i = addr >> PAGE_BITS; i <= last; ++i) {
+			pages[i] = true;
+		}
+	}
+	void markAll()
+	{
+		pages.assign(pages.size(), true);
+	}
+
+//internal (for LastDeltaBlocks):
+	/** Can the clean pages be trusted by the given snapshot creator?
+	  * Only if it's the one that consumed the previous state. */
+	bool isSyncedWith(const void* creator) const
+	{
+		return tracking && (syncedWith == creator);
+	}
+	bool isDirty(size_t page) const
+	{
+		return pages[page];
+	}
+	/** All pages are now known by the given snapshot creator. */
+	void sync(const void* creator)
+	{
+		if (!tracking) return;
+		syncedWith = creator;
+		pages.assign(pages.size(), false);
+	}
+
+private:
+	std::vector<bool> pages;
+	const void* syncedWith;
+	bool tracking;
+};
+
+} // namespace openmsx
+
+#endif
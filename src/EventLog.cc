@@ -0,0 +1,112 @@
+#include "EventLog.hh"
+#include "StateChange.hh"
+#include "serialize.hh"
+#include <cassert>
+
+namespace openmsx {
+
+// The types of the logged events, shared by all EventLog objects. There are
+// only a few dozen StateChange subclasses, and a type is only added the first
+// time an event of that type is logged.
+struct EventType {
+	const std::type_info* info;
+	const char* name; // as registered for polymorphic serialization
+};
+static std::vector<EventType> eventTypes;
+
+static uint16_t getTypeIndex(const std::type_info& info, const char* name)
+{
+	for (size_t i = 0; i < eventTypes.size(); ++i) {
+		if (*eventTypes[i].info == info) return uint16_t(i);
+	}
+	assert(eventTypes.size() < 0x10000);
+	eventTypes.push_back({&info, name});
+	return uint16_t(eventTypes.size() - 1);
+}
+
+// Reused for all events, so that logging an event normally doesn't allocate
+// (except for growing the log itself).
+static MemOutputArchive& getEventWriter()
+{
+	static MemOutputArchive writer(256);
+	return writer;
+}
+
+std::shared_ptr<StateChange> EventLog::get(size_t idx) const
+{
+	assert(idx < entries.size());
+	size_t begin = entries[idx].offset;
+	size_t end = (idx + 1 < entries.size()) ? entries[idx + 1].offset
+	                                        : arena.size();
+	MemInputArchive in(arena.data() + begin, end - begin);
+	in.setType(eventTypes[entries[idx].type].name);
+	std::shared_ptr<StateChange> result;
+	in.serialize("event", result);
+	return result;
+}
+
+const std::type_info& EventLog::getType(size_t idx) const
+{
+	return *eventTypes[entries[idx].type].info;
+}
+
+void EventLog::push_back(const std::shared_ptr<StateChange>& event)
+{
+	auto& out = getEventWriter();
+	out.clear();
+	out.omitType();
+	out.serialize("event", event);
+	assert(out.getOmittedType());
+
+	assert(arena.size() <= 0xFFFFFFFF);
+	const auto& ev = *event;
+	entries.push_back({ev.getTime(), uint32_t(arena.size()),
+	                   getTypeIndex(typeid(ev), out.getOmittedType())});
+	arena.insert(arena.end(), out.getData(), out.getData() + out.getSize());
+}
+
+void EventLog::truncate(size_t newSize)
+{
+	if (newSize >= entries.size()) return;
+	arena.resize(entries[newSize].offset);
+	entries.erase(entries.begin() + newSize, entries.end());
+}
+
+void EventLog::swap(EventLog& other)
+{
+	std::swap(entries, other.entries);
+	std::swap(arena,   other.arena);
+}
+
+void EventLog::clear()
+{
+	// clear() and free storage capacity
+	std::vector<Entry>().swap(entries);
+	std::vector<uint8_t>().swap(arena);
+}
+
+EventLog::Events EventLog::toVector() const
+{
+	Events result;
+	result.reserve(entries.size());
+	for (size_t i = 0; i < entries.size(); ++i) {
+		result.push_back(get(i));
+	}
+	return result;
+}
+
+void EventLog::assign(const Events& events)
+{
+	clear();
+	entries.reserve(events.size());
+	for (auto& e : events) {
+		push_back(e);
+	}
+}
+
+size_t EventLog::getMemorySize() const
+{
+	return entries.capacity() * sizeof(Entry) + arena.capacity();
+}
+
+} // namespace openmsx
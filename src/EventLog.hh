@@ -0,0 +1,75 @@
+#ifndef EVENTLOG_HH
+#define EVENTLOG_HH
+
+#include "EmuTime.hh"
+#include <vector>
+#include <memory>
+#include <typeinfo>
+#include <cstdint>
+
+namespace openmsx {
+
+class StateChange;
+
+/** The log of recorded input events (StateChange objects) of the reverse
+  * history.
+  *
+  * A long session can contain millions of events. Instead of keeping a heap
+  * allocated object per event, each event is serialized (MemOutputArchive)
+  * and appended to one contiguous buffer. Only the time and type of each
+  * event are kept separately, that's all that's needed to schedule the
+  * events. The type is a small index in a table shared by all logs, so the
+  * serialized data doesn't contain the (polymorphic) type name. A temporary
+  * StateChange object is only recreated from the buffer when the event is
+  * actually replayed.
+  */
+class EventLog
+{
+public:
+	using Events = std::vector<std::shared_ptr<StateChange>>;
+
+	size_t size() const { return entries.size(); }
+	bool empty() const { return entries.empty(); }
+
+	EmuTime::param getTime(size_t idx) const { return entries[idx].time; }
+
+	/** Is the event at the given index of type T (exactly, not a subtype)? */
+	template<typename T> bool isA(size_t idx) const
+	{
+		return getType(idx) == typeid(T);
+	}
+
+	/** Recreate the event at the given index. */
+	std::shared_ptr<StateChange> get(size_t idx) const;
+
+	void push_back(const std::shared_ptr<StateChange>& event);
+	void pop_back() { truncate(size() - 1); }
+	/** Remove all events starting from the given index. */
+	void truncate(size_t newSize);
+
+	void swap(EventLog& other);
+	/** Remove all events and free the allocated memory. */
+	void clear();
+
+	/** Conversion from/to a list of objects, that's how the log is stored
+	  * in replay files. */
+	Events toVector() const;
+	void assign(const Events& events);
+
+	size_t getMemorySize() const;
+
+private:
+	const std::type_info& getType(size_t idx) const;
+
+	struct Entry {
+		EmuTime time;
+		uint32_t offset; // in 'arena'
+		uint16_t type;   // index in the table of event types
+	};
+	std::vector<Entry> entries;
+	std::vector<uint8_t> arena;
+};
+
+} // namespace openmsx
+
+#endif
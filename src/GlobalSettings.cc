@@ -22,6 +22,23 @@ GlobalSettings::GlobalSettings(GlobalCommandController& commandController_)
 	        "automatically save settings when openMSX exits", true)
 	, pauseOnLostFocusSetting(commandController, "pause_on_lost_focus",
 	       "pause emulation when the openMSX window loses focus", false)
+	, runAllMachinesSetting(commandController, "run_all_machines",
+	       "also emulate the machines that are not the active machine, "
+	       "after each time slice of the active machine each of them gets "
+	       "one time slice, without video or sound output", false,
+	       Setting::DONT_SAVE)
+	, reverseMemoryBudgetSetting(commandController, "reverse_memory_budget",
+	       "maximum amount of memory (in MB) used for the reverse history "
+	       "of each machine, this includes the uncompressed copy of the "
+	       "last snapshot and snapshots decompressed in advance, 0 means "
+	       "unlimited", 0, 0, 1000000)
+	, savestateFormatSetting(commandController, "savestate_format",
+	       "file format used by store_machine (and thus savestate) and by "
+	       "'reverse savereplay', loading always supports both formats",
+	       SAVESTATE_XML,
+	       EnumSetting<SavestateFormat>::Map{
+	              {"xml",    SAVESTATE_XML},
+	              {"binary", SAVESTATE_BINARY}})
 	, umrCallBackSetting(commandController, "umr_callback",
 		"Tcl proc to call when an UMR is detected", "")
 	, invalidPsgDirectionsSetting(commandController,
@@ -23,6 +23,8 @@ class GlobalCommandController;
 class GlobalSettings final : private Observer<Setting>
 {
 public:
+	enum SavestateFormat { SAVESTATE_XML, SAVESTATE_BINARY };
+
 	explicit GlobalSettings(GlobalCommandController& commandController);
 	~GlobalSettings();
 
@@ -41,6 +43,15 @@ public:
 	BooleanSetting& getPauseOnLostFocusSetting() {
 		return pauseOnLostFocusSetting;
 	}
+	BooleanSetting& getRunAllMachinesSetting() {
+		return runAllMachinesSetting;
+	}
+	IntegerSetting& getReverseMemoryBudgetSetting() {
+		return reverseMemoryBudgetSetting;
+	}
+	EnumSetting<SavestateFormat>& getSavestateFormatSetting() {
+		return savestateFormatSetting;
+	}
 	StringSetting& getUMRCallBackSetting() {
 		return umrCallBackSetting;
 	}
@@ -68,6 +79,9 @@ private:
 	BooleanSetting powerSetting;
 	BooleanSetting autoSaveSetting;
 	BooleanSetting pauseOnLostFocusSetting;
+	BooleanSetting runAllMachinesSetting;
+	IntegerSetting reverseMemoryBudgetSetting;
+	EnumSetting<SavestateFormat> savestateFormatSetting;
 	StringSetting  umrCallBackSetting;
 	StringSetting  invalidPsgDirectionsSetting;
 	EnumSetting<ResampledSoundDevice::ResampleType> resampleSetting;
@@ -455,6 +455,11 @@ void MSXDevice::invalidateMemCache(word start, unsigned size)
 	getCPU().invalidateMemCache(start, size);
 }
 
+void MSXDevice::fillReadCache(word start, unsigned size, const byte* data)
+{
+	getCPUInterface().fillReadCache(*this, start, size, data);
+}
+
 template<typename Archive>
 void MSXDevice::serialize(Archive& ar, unsigned /*version*/)
 {
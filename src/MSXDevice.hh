@@ -202,6 +202,16 @@ public:
 	  */
 	void invalidateMemCache(word start, unsigned size);
 
+	/** Alternative for invalidateMemCache() for devices that know the
+	  * new content of the region [start, start + size): reading from this
+	  * region now (linearly) reads from the buffer 'data', exactly like
+	  * getReadCacheLine() would return for each cache line in the region.
+	  * Instead of letting the CPU lazily query getReadCacheLine() for each
+	  * cache line again, the CPU cache is directly filled in. The write
+	  * cache is only invalidated. The region may not cross a 16kB border.
+	  */
+	void fillReadCache(word start, unsigned size, const byte* data);
+
 	/** Get the mother board this device belongs to
 	  */
 	MSXMotherBoard& getMotherBoard() const;
@@ -28,6 +28,7 @@
 #include "MSXEventDistributor.hh"
 #include "StateChangeDistributor.hh"
 #include "EventDelay.hh"
+#include "HostTimeProfile.hh"
 #include "RealTime.hh"
 #include "DeviceFactory.hh"
 #include "BooleanSetting.hh"
@@ -474,6 +475,7 @@ bool MSXMotherBoard::execute()
 	}
 	assert(getMachineConfig()); // otherwise powered cannot be true
 
+	HostTimeProfile::Scope profile(HostTimeProfile::CPU);
 	getCPU().execute(false);
 	return true;
 }
@@ -23,6 +23,7 @@
 #include "Display.hh"
 #include "Mixer.hh"
 #include "AviRecorder.hh"
+#include "Benchmark.hh"
 #include "GlobalSettings.hh"
 #include "BooleanSetting.hh"
 #include "EnumSetting.hh"
@@ -35,6 +36,7 @@
 #include "FileOperations.hh"
 #include "ReadDir.hh"
 #include "Thread.hh"
+#include "ThreadPool.hh"
 #include "Timer.hh"
 #include "serialize.hh"
 #include "openmsx.hh"
@@ -44,6 +46,8 @@
 #include "unreachable.hh"
 #include "memory.hh"
 #include "build-info.hh"
+#include <algorithm>
+#include <thread>
 #include <cassert>
 
 using std::string;
@@ -204,6 +208,8 @@ void Reactor::init()
 	virtualDrive = make_unique<DiskChanger>(
 		*this, "virtual_drive");
 	filePool = make_unique<FilePool>(*globalCommandController, *this);
+	snapshotCompressor = make_unique<ThreadPool>(
+		std::max(1u, std::thread::hardware_concurrency()));
 	userSettings = make_unique<UserSettings>(
 		*globalCommandController);
 	softwareDatabase = make_unique<RomDatabase>(
@@ -231,6 +237,7 @@ void Reactor::init()
 	restoreMachineCommand = make_unique<RestoreMachineCommand>(
 		*globalCommandController, *this);
 	aviRecordCommand = make_unique<AviRecorder>(*this);
+	benchmark = make_unique<Benchmark>(*this);
 	extensionInfo = make_unique<ConfigInfo>(
 		getOpenMSXInfoCommand(), "extensions");
 	machineInfo   = make_unique<ConfigInfo>(
@@ -528,8 +535,14 @@ void Reactor::run(CommandLineParser& parser)
 	while (running) {
 		eventDistributor->deliverEvents();
 		assert(garbageBoards.empty());
-		bool blocked = (blockedCounter > 0) || !activeBoard;
-		if (!blocked) blocked = !activeBoard->execute();
+		bool blocked = blockedCounter > 0;
+		if (!blocked) {
+			bool executed = activeBoard && activeBoard->execute();
+			if (globalSettings->getRunAllMachinesSetting().getBoolean()) {
+				executed |= executeBackgroundBoards();
+			}
+			blocked = !executed;
+		}
 		if (blocked) {
 			// At first sight a better alternative is to use the
 			// SDL_WaitEvent() function. Though when inspecting
@@ -542,6 +555,39 @@ void Reactor::run(CommandLineParser& parser)
 	}
 }
 
+// Give each of the non-active machines one time slice. Everything runs in the
+// main thread, one machine after the other (most of the emulation code
+// assumes it runs in the main thread, and e.g. the Tcl interpreter is shared
+// by all machines). Rules for the machines in the background:
+//  - they don't synchronize with real time, they use the host time that is
+//    not needed by the active machine
+//  - their video and sound output is not shown (same as before)
+//  - breakpoints and debug conditions are shared by all machines, so those
+//    only apply to the active machine; watchpoints are per machine and do
+//    trigger in the background
+//  - 'pause' or a break (e.g. caused by a watchpoint) stops all machines
+bool Reactor::executeBackgroundBoards()
+{
+	// A time slice can execute Tcl callbacks that delete (other) machines
+	// or change the active machine, so don't iterate over 'boards'
+	// directly.
+	vector<MSXMotherBoard*> todo;
+	for (auto& b : boards) {
+		if (b.get() != activeBoard) todo.push_back(b.get());
+	}
+	bool executed = false;
+	for (auto* board : todo) {
+		if (blockedCounter > 0) break;
+		if ((board == activeBoard) ||
+		    none_of(begin(boards), end(boards),
+		            [&](Boards::value_type& b) { return b.get() == board; })) {
+			continue;
+		}
+		executed |= board->execute();
+	}
+	return executed;
+}
+
 void Reactor::unpause()
 {
 	if (paused) {
@@ -869,16 +915,19 @@ StoreMachineCommand::StoreMachineCommand(
 
 void StoreMachineCommand::execute(array_ref<TclObject> tokens, TclObject& result)
 {
+	bool binary = reactor.getGlobalSettings().getSavestateFormatSetting().getEnum()
+	           == GlobalSettings::SAVESTATE_BINARY;
+	const char* extension = binary ? ".bin" : ".xml.gz";
 	string filename;
 	string_ref machineID;
 	switch (tokens.size()) {
 	case 1:
 		machineID = reactor.getMachineID();
-		filename = FileOperations::getNextNumberedFileName("savestates", "openmsxstate", ".xml.gz");
+		filename = FileOperations::getNextNumberedFileName("savestates", "openmsxstate", extension);
 		break;
 	case 2:
 		machineID = tokens[1].getString();
-		filename = FileOperations::getNextNumberedFileName("savestates", "openmsxstate", ".xml.gz");
+		filename = FileOperations::getNextNumberedFileName("savestates", "openmsxstate", extension);
 		break;
 	case 3:
 		machineID = tokens[1].getString();
@@ -890,8 +939,13 @@ void StoreMachineCommand::execute(array_ref<TclObject> tokens, TclObject& result
 
 	auto& board = reactor.getMachine(machineID);
 
-	XmlOutputArchive out(filename);
-	out.serialize("machine", board);
+	if (binary) {
+		BinaryOutputArchive out(filename, &reactor.getSnapshotCompressor());
+		out.serialize("machine", board);
+	} else {
+		XmlOutputArchive out(filename);
+		out.serialize("machine", board);
+	}
 	result.setString(filename);
 }
 
@@ -902,6 +956,8 @@ string StoreMachineCommand::help(const vector<string>& /*tokens*/) const
 		"store_machine machineID             Save state of machine \"machineID\" to file \"openmsxNNNN.xml.gz\"\n"
                 "store_machine machineID <filename>  Save state of machine \"machineID\" to indicated file\n"
 		"\n"
+		"The 'savestate_format' setting selects between XML and binary files "
+		"(\".bin\" instead of \".xml.gz\").\n"
 		"This is a low-level command, the 'savestate' script is easier to use.";
 }
 
@@ -959,8 +1015,13 @@ void RestoreMachineCommand::execute(array_ref<TclObject> tokens,
 
 	//std::cerr << "Loading " << filename << std::endl;
 	try {
-		XmlInputArchive in(filename);
-		in.serialize("machine", *newBoard);
+		if (BinaryInputArchive::isBinaryArchive(filename)) {
+			BinaryInputArchive in(filename);
+			in.serialize("machine", *newBoard);
+		} else {
+			XmlInputArchive in(filename);
+			in.serialize("machine", *newBoard);
+		}
 	} catch (XMLException& e) {
 		throw CommandException("Cannot load state, bad file format: " + e.getMessage());
 	} catch (MSXException& e) {
@@ -982,6 +1043,7 @@ string RestoreMachineCommand::help(const vector<string>& /*tokens*/) const
 		"restore_machine                       Load state from last saved state in default directory\n"
 		"restore_machine <filename>            Load state from indicated file\n"
 		"\n"
+		"Both XML and binary savestates are supported, the format is detected automatically.\n"
 		"This is a low-level command, the 'loadstate' script is easier to use.";
 }
 
@@ -28,6 +28,7 @@ class DiskFactory;
 class DiskManipulator;
 class DiskChanger;
 class FilePool;
+class ThreadPool;
 class UserSettings;
 class RomDatabase;
 class TclCallbackMessages;
@@ -46,6 +47,7 @@ class ActivateMachineCommand;
 class StoreMachineCommand;
 class RestoreMachineCommand;
 class AviRecorder;
+class Benchmark;
 class ConfigInfo;
 class RealTimeInfo;
 template <typename T> class EnumSetting;
@@ -84,6 +86,9 @@ public:
 	EnumSetting<int>& getMachineSetting() { return *machineSetting; }
 	RomDatabase& getSoftwareDatabase() { return *softwareDatabase; }
 	FilePool& getFilePool() { return *filePool; }
+	/** Worker threads (one per CPU core) that (de)compress the reverse
+	  * snapshots and the blobs of binary savestates. */
+	ThreadPool& getSnapshotCompressor() { return *snapshotCompressor; }
 
 	void switchMachine(const std::string& machine);
 	MSXMotherBoard* getMotherBoard() const;
@@ -111,6 +116,7 @@ private:
 	void createMachineSetting();
 	void switchBoard(MSXMotherBoard* newBoard);
 	void deleteBoard(MSXMotherBoard* board);
+	bool executeBackgroundBoards();
 	MSXMotherBoard& getMachine(string_ref machineID) const;
 	std::vector<string_ref> getMachineIDs() const;
 
@@ -144,6 +150,7 @@ private:
 	std::unique_ptr<DiskManipulator> diskManipulator;
 	std::unique_ptr<DiskChanger> virtualDrive;
 	std::unique_ptr<FilePool> filePool;
+	std::unique_ptr<ThreadPool> snapshotCompressor;
 
 	std::unique_ptr<EnumSetting<int>> machineSetting;
 	std::unique_ptr<UserSettings> userSettings;
@@ -161,6 +168,7 @@ private:
 	std::unique_ptr<StoreMachineCommand> storeMachineCommand;
 	std::unique_ptr<RestoreMachineCommand> restoreMachineCommand;
 	std::unique_ptr<AviRecorder> aviRecordCommand;
+	std::unique_ptr<Benchmark> benchmark;
 	std::unique_ptr<ConfigInfo> extensionInfo;
 	std::unique_ptr<ConfigInfo> machineInfo;
 	std::unique_ptr<RealTimeInfo> realTimeInfo;
@@ -117,7 +117,9 @@ void RealTime::internalSync(EmuTime::param time, bool allowSleep)
 
 void RealTime::executeUntil(EmuTime::param time)
 {
-	internalSync(time, true);
+	// Machines running in the background (see 'run_all_machines') don't
+	// sleep, they only use the time that is left by the active machine.
+	internalSync(time, motherBoard.isActive());
 	setSyncPoint(time + getEmuDuration(SYNC_INTERVAL));
 }
 
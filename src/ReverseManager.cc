@@ -1,5 +1,6 @@
 #include "ReverseManager.hh"
 #include "MSXMotherBoard.hh"
+#include "MSXCPU.hh"
 #include "EventDistributor.hh"
 #include "StateChangeDistributor.hh"
 #include "Keyboard.hh"
@@ -9,6 +10,7 @@
 #include "MSXCommandController.hh"
 #include "XMLException.hh"
 #include "TclObject.hh"
+#include "File.hh"
 #include "FileOperations.hh"
 #include "FileContext.hh"
 #include "StateChange.hh"
@@ -16,12 +18,16 @@
 #include "CliComm.hh"
 #include "Display.hh"
 #include "Reactor.hh"
+#include "GlobalSettings.hh"
 #include "CommandException.hh"
+#include "ThreadPool.hh"
 #include "MemBuffer.hh"
+#include "SerializeProfile.hh"
 #include "StringOp.hh"
 #include "serialize.hh"
 #include "serialize_stl.hh"
 #include "xrange.hh"
+#include <algorithm>
 #include <functional>
 #include <cassert>
 #include <cmath>
@@ -36,6 +42,14 @@ namespace openmsx {
 // Time between two snapshots (in seconds)
 static const double SNAPSHOT_PERIOD = 1.0;
 
+// Snapshots younger than this (in seconds) are only dropped to stay within
+// the memory budget when there's nothing older left to drop.
+static const double DENSE_HISTORY = 25 * SNAPSHOT_PERIOD;
+
+// Two 'reverse goto' commands that are less than this (in us of host time)
+// apart are considered to be part of one scrub action.
+static const uint64_t SCRUB_TIMEOUT = 500000;
+
 // Max number of snapshots in a replay file
 static const unsigned MAX_NOF_SNAPSHOTS = 10;
 
@@ -54,6 +68,20 @@ static const char* const REPLAY_DIR = "replays";
 // merely in-between snapshots, so it is quicker to jump to a later time in the
 // event log.
 
+// In replay files the event log is stored as a list of StateChange objects.
+template<typename Archive>
+static void serializeEvents(Archive& ar, EventLog& log)
+{
+	EventLog::Events events;
+	if (!ar.isLoader()) {
+		events = log.toVector();
+	}
+	ar.serialize("events", events);
+	if (ar.isLoader()) {
+		log.assign(events);
+	}
+}
+
 struct Replay
 {
 	explicit Replay(Reactor& reactor_)
@@ -61,7 +89,7 @@ struct Replay
 
 	Reactor& reactor;
 
-	ReverseManager::Events* events;
+	EventLog* events;
 	std::vector<Reactor::Board> motherBoards;
 	EmuTime currentTime;
 	// this is the amount of times the reverse goto command was used, which
@@ -81,14 +109,14 @@ struct Replay
 			motherBoards.push_back(move(newBoard));
 		}
 
-		ar.serialize("events", *events);
+		serializeEvents(ar, *events);
 
 		if (ar.versionAtLeast(version, 3)) {
 			ar.serialize("currentTime", currentTime);
 		} else {
 			assert(ar.isLoader());
 			assert(!events->empty());
-			currentTime = events->back()->getTime();
+			currentTime = events->getTime(events->size() - 1);
 		}
 
 		if (ar.versionAtLeast(version, 4)) {
@@ -98,20 +126,77 @@ struct Replay
 };
 SERIALIZE_CLASS_VERSION(Replay, 4);
 
+// Replays in the binary savestate format are seekable: the DATA section starts
+// with a ReplayInfo, followed by the snapshots, each one serialized
+// independently of the others. The "SIDX" section is an index on those
+// snapshots, so that a single snapshot can be loaded without touching the
+// rest of the file. Per snapshot it contains (each field 8 bytes, little
+// endian): the time, the number of events before the snapshot and the
+// position of the snapshot in the DATA section.
+
+struct ReplayInfo
+{
+	ReplayInfo() : currentTime(EmuTime::dummy()) {}
+
+	EventLog* events;
+	EmuTime currentTime;
+	unsigned reRecordCount;
+
+	template<typename Archive>
+	void serialize(Archive& ar, unsigned /*version*/)
+	{
+		serializeEvents(ar, *events);
+		ar.serialize("currentTime", currentTime);
+		ar.serialize("reRecordCount", reRecordCount);
+	}
+};
+
+static const char* const SNAPSHOT_INDEX = "SIDX";
+static const size_t INDEX_ENTRY_SIZE = 3 * 8;
+
+static void appendLE64(std::vector<uint8_t>& buf, uint64_t v)
+{
+	for (int i = 0; i < 8; ++i) {
+		buf.push_back(uint8_t(v >> (8 * i)));
+	}
+}
+static uint64_t readLE64(const uint8_t* p)
+{
+	uint64_t result = 0;
+	for (int i = 0; i < 8; ++i) {
+		result |= uint64_t(p[i]) << (8 * i);
+	}
+	return result;
+}
+
 
 // struct ReverseHistory
 
+ReverseManager::ReverseHistory::ReverseHistory()
+	: lastGotoTarget(EmuTime::zero)
+	, lastGotoHostTime(0)
+{
+}
+
 void ReverseManager::ReverseHistory::swap(ReverseHistory& other)
 {
 	std::swap(chunks, other.chunks);
-	std::swap(events, other.events);
+	events.swap(other.events);
+	std::swap(lastGotoTarget, other.lastGotoTarget);
+	std::swap(lastGotoHostTime, other.lastGotoHostTime);
+	std::swap(prefetched, other.prefetched);
 }
 
 void ReverseManager::ReverseHistory::clear()
 {
 	// clear() and free storage capacity
 	Chunks().swap(chunks);
-	Events().swap(events);
+	events.clear();
+	for (auto& block : prefetched) {
+		block->dropPrefetched();
+	}
+	prefetched.clear();
+	lastGotoHostTime = 0;
 }
 
 
@@ -131,6 +216,12 @@ public:
 };
 REGISTER_POLYMORPHIC_CLASS(StateChange, EndLogEvent, "EndLog");
 
+static bool endsWithEndLog(const EventLog& events)
+{
+	return !events.empty() &&
+	       events.isA<EndLogEvent>(events.size() - 1);
+}
+
 // class ReverseManager
 
 ReverseManager::ReverseManager(MSXMotherBoard& motherBoard_)
@@ -141,6 +232,7 @@ ReverseManager::ReverseManager(MSXMotherBoard& motherBoard_)
 	, reverseCmd(motherBoard.getCommandController())
 	, keyboard(nullptr)
 	, eventDelay(nullptr)
+	, lastDeltaBlocks(&motherBoard.getReactor().getSnapshotCompressor())
 	, replayIndex(0)
 	, collecting(false)
 	, pendingTakeSnapshot(false)
@@ -184,6 +276,7 @@ void ReverseManager::stop()
 		syncNewSnapshot.removeSyncPoint(); // don't schedule new snapshot takings
 		syncInputEvent .removeSyncPoint(); // stop any pending replay actions
 		history.clear();
+		lastDeltaBlocks.clear();
 		replayIndex = 0;
 		collecting = false;
 		pendingTakeSnapshot = false;
@@ -195,12 +288,9 @@ void ReverseManager::stop()
 
 EmuTime::param ReverseManager::getEndTime(const ReverseHistory& hist) const
 {
-	if (!hist.events.empty()) {
-		if (auto* ev = dynamic_cast<const EndLogEvent*>(
-				hist.events.back().get())) {
-			// last log element is EndLogEvent, use that
-			return ev->getTime();
-		}
+	if (endsWithEndLog(hist.events)) {
+		// last log element is EndLogEvent, use that
+		return hist.events.getTime(hist.events.size() - 1);
 	}
 	// otherwise use current time
 	assert(!isReplaying());
@@ -240,12 +330,40 @@ void ReverseManager::status(TclObject& result) const
 	result.addListElement(snapshots);
 
 	result.addListElement("last_event");
-	auto lastEvent = history.events.rbegin();
-	if (lastEvent != history.events.rend() && dynamic_cast<const EndLogEvent*>(lastEvent->get())) {
-		++lastEvent;
+	size_t numEvents = history.events.size();
+	if (endsWithEndLog(history.events)) {
+		--numEvents;
 	}
-	EmuTime le(isCollecting() && (lastEvent != history.events.rend()) ? (*lastEvent)->getTime() : EmuTime::zero);
+	EmuTime le(isCollecting() && (numEvents != 0) ? history.events.getTime(numEvents - 1) : EmuTime::zero);
 	result.addListElement((le - EmuTime::zero).toDouble());
+
+	// memory usage (in kB), in total and split on the age of the snapshots
+	static const int bucketLimits[] = { 60, 600, 3600 }; // in seconds
+	size_t buckets[4] = { 0, 0, 0, 0 };
+	const ReverseChunk* prev = nullptr;
+	for (auto& p : history.chunks) {
+		// note: while replaying there are also snapshots in the future
+		double age = (p.second.time < current)
+		           ? (current - p.second.time).toDouble() : 0.0;
+		int bucket = 0;
+		while ((bucket < 3) && (age >= bucketLimits[bucket])) ++bucket;
+		buckets[bucket] += getChunkMemory(p.second, prev, nullptr);
+		prev = &p.second;
+	}
+	result.addListElement("memory_kb");
+	result.addListElement(int((buckets[0] + buckets[1] +
+	                           buckets[2] + buckets[3]) / 1024));
+	result.addListElement("memory_kb_by_age");
+	TclObject byAge;
+	for (int i = 0; i < 4; ++i) {
+		if (i < 3) {
+			byAge.addListElement(bucketLimits[i]);
+		} else {
+			byAge.addListElement("older");
+		}
+		byAge.addListElement(int(buckets[i] / 1024));
+	}
+	result.addListElement(byAge);
 }
 
 void ReverseManager::debugInfo(TclObject& result) const
@@ -267,6 +385,20 @@ void ReverseManager::debugInfo(TclObject& result) const
 	result.setString(string(res));
 }
 
+void ReverseManager::debugSizes(TclObject& result)
+{
+	// Take an extra snapshot, only to measure it. Unlike the regular
+	// snapshots all blobs are compressed into the stream itself (no
+	// DeltaBlocks), so the sizes don't depend on the previous snapshot.
+	SerializeProfile profile;
+	MemOutputArchive out;
+	out.setProfile(&profile);
+	out.serialize("machine", motherBoard);
+	size_t size;
+	out.releaseBuffer(size);
+	result.setString(profile.format(1024));
+}
+
 static void parseGoTo(Interpreter& interp, array_ref<TclObject> tokens,
                       bool& novideo, double& time)
 {
@@ -325,9 +457,87 @@ void ReverseManager::goTo(EmuTime::param target, bool novideo)
 			"Reverse was not enabled. First execute the 'reverse "
 			"start' command to start collecting data.");
 	}
+	prefetchSnapshots(target);
 	goTo(target, novideo, history, true); // move in current time-line
 }
 
+/* Dragging the reverse bar results in a quick succession of 'reverse goto'
+ * commands. Each one restores a snapshot, part of that time goes to
+ * decompressing the large blobs (RAM, VRAM, ...). So when we detect such a
+ * scrub action, we guess the next target (same direction, same step size)
+ * and already decompress the snapshots around it on a worker thread, see
+ * DeltaBlock::prefetch().
+ * That saves roughly 0.15ms per 256kB of blob data on a typical desktop
+ * CPU. Recreating the MSXMotherBoard and emulating from the snapshot up to
+ * the target time still take much longer, those are not addressed here.
+ */
+void ReverseManager::prefetchSnapshots(EmuTime::param target)
+{
+	auto now = Timer::getTime();
+	bool scrubbing = (now - history.lastGotoHostTime) < SCRUB_TIMEOUT;
+	EmuTime endTime = getEndTime(history);
+	EmuTime last = std::min(history.lastGotoTarget, endTime);
+	EmuTime current = std::min(target, endTime);
+	history.lastGotoTarget = current;
+	history.lastGotoHostTime = now;
+
+	auto& chunks = history.chunks;
+	// last snapshot that's not newer than the given time
+	auto findChunk = [&](EmuTime::param time) {
+		auto it = begin(chunks);
+		while ((std::next(it) != end(chunks)) &&
+		       (std::next(it)->second.time <= time)) {
+			++it;
+		}
+		return it;
+	};
+	auto addBlocks = [](std::vector<shared_ptr<DeltaBlock>>& blocks,
+	                    const ReverseChunk& chunk) {
+		blocks.insert(end(blocks), begin(chunk.deltaBlocks),
+		              end(chunk.deltaBlocks));
+	};
+
+	// Keep the prefetched data of the snapshot that's about to be
+	// restored, drop all the rest.
+	std::vector<shared_ptr<DeltaBlock>> keep;
+	addBlocks(keep, findChunk(current)->second);
+
+	std::vector<shared_ptr<DeltaBlock>> todo;
+	if (scrubbing && (current != last)) {
+		bool forward = current > last;
+		EmuTime predicted = forward
+			? current + (current - last)
+			: (((last - current) < (current - EmuTime::zero))
+			   ? current - (last - current) : EmuTime::zero);
+		auto it = findChunk(predicted);
+		addBlocks(todo, it->second);
+		// also the next one in the scrub direction
+		if (forward) {
+			if (std::next(it) != end(chunks)) {
+				addBlocks(todo, std::next(it)->second);
+			}
+		} else if (it != begin(chunks)) {
+			addBlocks(todo, std::prev(it)->second);
+		}
+	}
+	keep.insert(end(keep), begin(todo), end(todo));
+
+	for (auto& block : history.prefetched) {
+		if (find(begin(keep), end(keep), block) == end(keep)) {
+			block->dropPrefetched();
+		}
+	}
+	history.prefetched = move(keep);
+
+	if (!todo.empty()) {
+		for (auto& block : todo) block->requestPrefetch();
+		auto& pool = motherBoard.getReactor().getSnapshotCompressor();
+		pool.addTask([todo] {
+			for (auto& block : todo) block->prefetch();
+		});
+	}
+}
+
 // this function is used below, but factored out, because it's already way too long
 static void reportProgress(Reactor& reactor, const EmuTime& targetTime, int percentage)
 {
@@ -414,9 +624,7 @@ void ReverseManager::goTo(
 			// -- restore old snapshot --
 			newBoard_ = reactor.createEmptyMotherBoard();
 			newBoard = newBoard_.get();
-			MemInputArchive in(it->second.savestate.data(),
-					   it->second.size);
-			in.serialize("machine", *newBoard);
+			restoreSnapshot(it->second, *newBoard);
 
 			if (eventDelay) {
 				// Handle all events that are scheduled, but not yet
@@ -426,8 +634,7 @@ void ReverseManager::goTo(
 			}
 
 			// terminate replay log with EndLogEvent (if not there already)
-			if (hist.events.empty() ||
-			    !dynamic_cast<const EndLogEvent*>(hist.events.back().get())) {
+			if (!endsWithEndLog(hist.events)) {
 				hist.events.push_back(
 					std::make_shared<EndLogEvent>(currentTime));
 			}
@@ -553,38 +760,37 @@ void ReverseManager::saveReplay(
 
 	string filename;
 	int maxNofExtraSnapshots = MAX_NOF_SNAPSHOTS;
-	switch (tokens.size()) {
-	case 2:
-		// nothing
-		break;
-	case 3:
-		filename = tokens[2].getString().str();
-		break;
-	case 4:
-	case 5:
-		size_t tn;
-		for (tn = 2; tn < (tokens.size() - 1); ++tn) {
-			if (tokens[tn] == "-maxnofextrasnapshots") {
-				maxNofExtraSnapshots = tokens[tn + 1].getInt(interp);
-				break;
+	double snapshotInterval = 0.0;
+	for (size_t i = 2; i < tokens.size(); ++i) {
+		string_ref token = tokens[i].getString();
+		if (token == "-maxnofextrasnapshots") {
+			if (++i == tokens.size()) {
+				throw CommandException("Missing argument");
 			}
+			maxNofExtraSnapshots = tokens[i].getInt(interp);
+			if (maxNofExtraSnapshots < 0) {
+				throw CommandException("Maximum number of snapshots should be at least 0");
+			}
+		} else if (token == "-snapshotinterval") {
+			if (++i == tokens.size()) {
+				throw CommandException("Missing argument");
+			}
+			snapshotInterval = tokens[i].getDouble(interp);
+			if (snapshotInterval < 0.0) {
+				throw CommandException("Snapshot interval can't be negative");
+			}
+		} else if (filename.empty()) {
+			filename = token.str();
+		} else {
+			throw SyntaxError();
 		}
-		if (tn == (tokens.size() - 1)) throw SyntaxError();
-		if (tokens.size() == 5) {
-			filename = tokens[tn == 2 ? 4 : 2].getString().str();
-		}
-		if (maxNofExtraSnapshots < 0) {
-			throw CommandException("Maximum number of snapshots should be at least 0");
-		}
-
-		break;
-	default:
-		throw SyntaxError();
 	}
 	filename = FileOperations::parseCommandFileArgument(
 		filename, REPLAY_DIR, "openmsx", ".omr");
 
 	auto& reactor = motherBoard.getReactor();
+	bool seekable = reactor.getGlobalSettings().getSavestateFormatSetting().getEnum()
+	             == GlobalSettings::SAVESTATE_BINARY;
 	Replay replay(reactor);
 	replay.reRecordCount = reRecordCount;
 
@@ -592,14 +798,14 @@ void ReverseManager::saveReplay(
 	// so that on load we can go back there
 	replay.currentTime = getCurrentTime();
 
-	// restore first snapshot to be able to serialize it to a file
-	auto initialBoard = reactor.createEmptyMotherBoard();
-	MemInputArchive in(begin(chunks)->second.savestate.data(),
-	                   begin(chunks)->second.size);
-	in.serialize("machine", *initialBoard);
-	replay.motherBoards.push_back(move(initialBoard));
+	if (!seekable) {
+		// restore first snapshot to be able to serialize it to a file
+		auto initialBoard = reactor.createEmptyMotherBoard();
+		restoreSnapshot(begin(chunks)->second, *initialBoard);
+		replay.motherBoards.push_back(move(initialBoard));
+	}
 
-	if (maxNofExtraSnapshots > 0) {
+	if (!seekable && (maxNofExtraSnapshots > 0)) {
 		// determine which extra snapshots to put in the replay
 		const auto& startTime = begin(chunks)->second.time;
 		// for the end time, try to take MAX_DIST_1_BEFORE_LAST_SNAPSHOT
@@ -622,9 +828,7 @@ void ReverseManager::saveReplay(
 				if (it != lastAddedIt) {
 					// this is a new one, add it to the list of snapshots
 					Reactor::Board board = reactor.createEmptyMotherBoard();
-					MemInputArchive in2(it->second.savestate.data(),
-							    it->second.size);
-					in2.serialize("machine", *board);
+					restoreSnapshot(it->second, *board);
 					replay.motherBoards.push_back(move(board));
 					lastAddedIt = it;
 				}
@@ -638,17 +842,20 @@ void ReverseManager::saveReplay(
 	}
 
 	// add sentinel when there isn't one yet
-	bool addSentinel = history.events.empty() ||
-		!dynamic_cast<EndLogEvent*>(history.events.back().get());
+	bool addSentinel = !endsWithEndLog(history.events);
 	if (addSentinel) {
 		/// make sure the replay log ends with a EndLogEvent
 		history.events.push_back(std::make_shared<EndLogEvent>(
 			getCurrentTime()));
 	}
 	try {
-		XmlOutputArchive out(filename);
-		replay.events = &history.events;
-		out.serialize("replay", replay);
+		if (seekable) {
+			saveSeekableReplay(filename, snapshotInterval);
+		} else {
+			XmlOutputArchive out(filename);
+			replay.events = &history.events;
+			out.serialize("replay", replay);
+		}
 	} catch (MSXException&) {
 		if (addSentinel) {
 			history.events.pop_back();
@@ -667,6 +874,91 @@ void ReverseManager::saveReplay(
 	result.setString("Saved replay to " + filename);
 }
 
+void ReverseManager::saveSeekableReplay(
+	const string& filename, double snapshotInterval)
+{
+	ReplayInfo info;
+	info.events = &history.events;
+	info.currentTime = getCurrentTime();
+	info.reRecordCount = reRecordCount;
+
+	auto& reactor = motherBoard.getReactor();
+	BinaryOutputArchive out(filename, &reactor.getSnapshotCompressor());
+	out.serialize("replay", info);
+
+	// Store all snapshots, or only those that are at least
+	// 'snapshotInterval' apart. The first and the last one are always
+	// included.
+	const auto& chunks = history.chunks;
+	auto last = std::prev(end(chunks));
+	EmuDuration interval(snapshotInterval);
+	EmuTime nextTime = EmuTime::zero;
+	std::vector<uint8_t> index;
+	for (auto it = begin(chunks); it != end(chunks); ++it) {
+		const auto& chunk = it->second;
+		if ((chunk.time < nextTime) && (it != last)) continue;
+		nextTime = chunk.time + interval;
+
+		auto board = reactor.createEmptyMotherBoard();
+		restoreSnapshot(chunk, *board);
+		out.resetIds(); // each snapshot must be loadable on its own
+		appendLE64(index, (chunk.time - EmuTime::zero).length());
+		appendLE64(index, chunk.eventCount);
+		appendLE64(index, out.getPosition());
+		out.serialize("machine", *board);
+	}
+	out.addSection(SNAPSHOT_INDEX, move(index));
+}
+
+void ReverseManager::loadSeekableReplay(
+	const string& filename, ReverseHistory& newHistory,
+	EmuTime& currentTime, unsigned& newReRecordCount)
+{
+	BinaryInputArchive in(filename);
+	ReplayInfo info;
+	info.events = &newHistory.events;
+	in.serialize("replay", info);
+	currentTime = info.currentTime;
+	newReRecordCount = info.reRecordCount;
+
+	const uint8_t* index;
+	size_t indexSize;
+	if (!in.getSection(SNAPSHOT_INDEX, index, indexSize) ||
+	    (indexSize == 0) || ((indexSize % INDEX_ENTRY_SIZE) != 0)) {
+		throw MSXException("Missing or corrupt snapshot index.");
+	}
+	// Only fill in the index, snapshots are loaded when needed (see
+	// restoreSnapshot()).
+	auto& newChunks = newHistory.chunks;
+	for (size_t i = 0; i < indexSize; i += INDEX_ENTRY_SIZE) {
+		ReverseChunk newChunk;
+		newChunk.time = EmuTime::makeEmuTime(readLE64(index + i + 0));
+		newChunk.eventCount = unsigned(readLE64(index + i + 8));
+		newChunk.replayPos  = size_t  (readLE64(index + i + 16));
+		newChunk.replayFile = in.getFile();
+		if ((newChunk.eventCount > newHistory.events.size()) ||
+		    (!newChunks.empty() &&
+		     (newChunk.time <= newChunks.rbegin()->second.time))) {
+			throw MSXException("Corrupt snapshot index.");
+		}
+		newChunks[newHistory.getNextSeqNum(newChunk.time)] =
+			move(newChunk);
+	}
+}
+
+void ReverseManager::restoreSnapshot(
+	const ReverseChunk& chunk, MSXMotherBoard& board)
+{
+	if (chunk.replayFile) {
+		BinaryInputArchive in(chunk.replayFile, chunk.replayPos);
+		in.serialize("machine", board);
+	} else {
+		MemInputArchive in(chunk.savestate.data(), chunk.size,
+		                   &chunk.deltaBlocks);
+		in.serialize("machine", board);
+	}
+}
+
 void ReverseManager::loadReplay(
 	Interpreter& interp, array_ref<TclObject> tokens, TclObject& result)
 {
@@ -714,11 +1006,19 @@ void ReverseManager::loadReplay(
 	// restore replay
 	auto& reactor = motherBoard.getReactor();
 	Replay replay(reactor);
-	Events events;
+	EventLog events;
 	replay.events = &events;
+	ReverseHistory seekableHistory;
+	bool seekable = false;
 	try {
-		XmlInputArchive in(filename);
-		in.serialize("replay", replay);
+		if (BinaryInputArchive::isBinaryArchive(filename)) {
+			seekable = true;
+			loadSeekableReplay(filename, seekableHistory,
+			                   replay.currentTime, replay.reRecordCount);
+		} else {
+			XmlInputArchive in(filename);
+			in.serialize("replay", replay);
+		}
 	} catch (XMLException& e) {
 		throw CommandException("Cannot load replay, bad file format: " + e.getMessage());
 	} catch (MSXException& e) {
@@ -743,6 +1043,16 @@ void ReverseManager::loadReplay(
 	// now we can change the view only mode
 	motherBoard.getStateChangeDistributor().setViewOnlyMode(enableViewOnly);
 
+	if (seekable) {
+		// The snapshot index was already restored, the snapshots
+		// themselves are only loaded when needed.
+		reRecordCount = replay.reRecordCount;
+		bool novideo = false;
+		goTo(destination, novideo, seekableHistory, false);
+		result.setString("Loaded replay from " + filename);
+		return;
+	}
+
 	assert(!replay.motherBoards.empty());
 	auto& newReverseManager = replay.motherBoards[0]->getReverseManager();
 	auto& newHistory = newReverseManager.history;
@@ -756,23 +1066,25 @@ void ReverseManager::loadReplay(
 	}
 
 	// Restore event log
-	swap(newHistory.events, events);
+	newHistory.events.swap(events);
 	auto& newEvents = newHistory.events;
 
 	// Restore snapshots
 	unsigned replayIdx = 0;
+	LastDeltaBlocks replayDeltaBlocks;
 	for (auto& m : replay.motherBoards) {
 		ReverseChunk newChunk;
 		newChunk.time = m->getCurrentTime();
 
-		MemOutputArchive out;
+		MemOutputArchive out(replayDeltaBlocks, newChunk.deltaBlocks);
 		out.serialize("machine", *m);
+		replayDeltaBlocks.prune();
 		newChunk.savestate = out.releaseBuffer(newChunk.size);
 
 		// update replayIdx
 		// TODO: should we use <= instead??
 		while (replayIdx < newEvents.size() &&
-		       (newEvents[replayIdx]->getTime() < newChunk.time)) {
+		       (newEvents.getTime(replayIdx) < newChunk.time)) {
 			replayIdx++;
 		}
 		newChunk.eventCount = replayIdx;
@@ -846,7 +1158,7 @@ void ReverseManager::execNewSnapshot()
 
 void ReverseManager::execInputEvent()
 {
-	auto event = history.events[replayIndex];
+	auto event = history.events.get(replayIndex);
 	try {
 		// deliver current event at current time
 		motherBoard.getStateChangeDistributor().distributeReplay(event);
@@ -902,26 +1214,35 @@ void ReverseManager::takeSnapshot(EmuTime::param time)
 	// the same moment in time).
 
 	// actually create new snapshot
-	MemOutputArchive out;
-	out.serialize("machine", motherBoard);
 	ReverseChunk& newChunk = history.chunks[seqNum];
+	newChunk.deltaBlocks.clear();
+	newChunk.replayFile.reset();
+	MemOutputArchive out(lastDeltaBlocks, newChunk.deltaBlocks);
+	out.serialize("machine", motherBoard);
+	lastDeltaBlocks.prune();
+	// The dirty pages of RAM are reset now (see DirtyPages). But the CPU
+	// can still write via its cached pointers, drop those so that the
+	// next write to each cache line is seen again.
+	motherBoard.getCPU().invalidateMemCache(0x0000, 0x10000);
 	newChunk.time = time;
 	newChunk.savestate = out.releaseBuffer(newChunk.size);
 	newChunk.eventCount = replayIndex;
+
+	enforceMemoryBudget();
 }
 
 void ReverseManager::replayNextEvent()
 {
 	// schedule next event at its own time
 	assert(replayIndex < history.events.size());
-	syncInputEvent.setSyncPoint(history.events[replayIndex]->getTime());
+	syncInputEvent.setSyncPoint(history.events.getTime(replayIndex));
 }
 
 void ReverseManager::signalStateChange(const shared_ptr<StateChange>& event)
 {
 	if (isReplaying()) {
 		// this is an event we just replayed
-		assert(event == history.events[replayIndex]);
+		assert(event->getTime() == history.events.getTime(replayIndex));
 		if (dynamic_cast<EndLogEvent*>(event.get())) {
 			signalStopReplay(event->getTime());
 		} else {
@@ -948,8 +1269,7 @@ void ReverseManager::stopReplay(EmuTime::param time)
 	if (isReplaying()) {
 		// if we're replaying, stop it and erase remainder of event log
 		syncInputEvent.removeSyncPoint();
-		Events& events = history.events;
-		events.erase(begin(events) + replayIndex, end(events));
+		history.events.truncate(replayIndex);
 		// search snapshots that are newer than 'time' and erase them
 		auto it = find_if(begin(history.chunks), end(history.chunks),
 			[&](Chunks::value_type& p) { return p.second.time > time; });
@@ -987,6 +1307,106 @@ void ReverseManager::dropOldSnapshots(unsigned count)
 	}
 }
 
+// Memory that would be freed by dropping the given snapshot (this does not
+// include pages that are shared with the neighbouring snapshots).
+size_t ReverseManager::getChunkMemory(
+	const ReverseChunk& chunk, const ReverseChunk* prev,
+	const ReverseChunk* next)
+{
+	auto neighbour = [&](const ReverseChunk* other, size_t i) {
+		return (other && (other->deltaBlocks.size() == chunk.deltaBlocks.size()))
+		       ? other->deltaBlocks[i].get() : nullptr;
+	};
+	size_t result = chunk.size;
+	for (auto i : xrange(chunk.deltaBlocks.size())) {
+		result += chunk.deltaBlocks[i]->getMemorySize(
+			neighbour(prev, i), neighbour(next, i));
+	}
+	return result;
+}
+
+size_t ReverseManager::getMemoryUsage(const ReverseHistory& hist)
+{
+	size_t result = 0;
+	const ReverseChunk* prev = nullptr;
+	for (auto& p : hist.chunks) {
+		result += getChunkMemory(p.second, prev, nullptr);
+		prev = &p.second;
+	}
+	return result;
+}
+
+/* Should be called each time a new snapshot is added (after
+ * dropOldSnapshots()). While the history uses more memory than allowed by the
+ * 'reverse_memory_budget' setting, drop the snapshot where we lose the least
+ * resolution (the size of the gap it leaves behind) per freed byte. Snapshots
+ * of the last DENSE_HISTORY seconds are only dropped when there's no other
+ * choice. The first and the last snapshot are never dropped.
+ */
+void ReverseManager::enforceMemoryBudget()
+{
+	auto& settings = motherBoard.getReactor().getGlobalSettings();
+	int budgetMB = settings.getReverseMemoryBudgetSetting().getInt();
+	if (budgetMB == 0) return;
+	size_t budget = size_t(budgetMB) * 1024 * 1024;
+	// The copies to create the next snapshot are also part of the budget,
+	// but they can't be freed.
+	budget -= std::min(budget, lastDeltaBlocks.getMemorySize());
+
+	auto& chunks = history.chunks;
+	if (chunks.size() <= 2) return;
+	size_t usage = getMemoryUsage(history);
+	if (usage <= budget) return;
+
+	// The memory freed by dropping a snapshot only depends on its direct
+	// neighbours. So calculate it once per snapshot, and after dropping one
+	// only recalculate it for the two neighbours.
+	struct Candidate {
+		Chunks::iterator it;
+		size_t freed;
+	};
+	auto getFreed = [](Chunks::iterator it) {
+		return getChunkMemory(it->second, &std::prev(it)->second,
+		                      &std::next(it)->second);
+	};
+	std::vector<Candidate> candidates;
+	for (auto it = std::next(begin(chunks)); std::next(it) != end(chunks); ++it) {
+		candidates.push_back({it, getFreed(it)});
+	}
+
+	EmuTime now = getCurrentTime();
+	while (!candidates.empty() && (usage > budget)) {
+		size_t best = 0;
+		bool bestDense = true;
+		double bestScore = 0.0;
+		for (auto i : xrange(candidates.size())) {
+			auto it = candidates[i].it;
+			bool dense = (it->second.time >= now) ||
+			             ((now - it->second.time).toDouble() < DENSE_HISTORY);
+			double gap = (std::next(it)->second.time -
+			              std::prev(it)->second.time).toDouble();
+			double score = gap / std::max<size_t>(candidates[i].freed, 1);
+			if ((i == 0) || (bestDense && !dense) ||
+			    ((dense == bestDense) && (score < bestScore))) {
+				best = i;
+				bestDense = dense;
+				bestScore = score;
+			}
+		}
+		usage -= std::min(usage, candidates[best].freed);
+		chunks.erase(candidates[best].it);
+		candidates.erase(begin(candidates) + best);
+		if (best != 0) {
+			auto& c = candidates[best - 1];
+			c.freed = getFreed(c.it);
+		}
+		if (best != candidates.size()) {
+			auto& c = candidates[best];
+			c.freed = getFreed(c.it);
+		}
+	}
+}
+
 void ReverseManager::schedule(EmuTime::param time)
 {
 	syncNewSnapshot.setSyncPoint(time + EmuDuration(SNAPSHOT_PERIOD));
@@ -1015,7 +1435,11 @@ void ReverseManager::ReverseCmd::execute(array_ref<TclObject> tokens, TclObject&
 	} else if (subcommand == "status") {
 		manager.status(result);
 	} else if (subcommand == "debug") {
-		manager.debugInfo(result);
+		if ((tokens.size() == 3) && (tokens[2] == "sizes")) {
+			manager.debugSizes(result);
+		} else {
+			manager.debugInfo(result);
+		}
 	} else if (subcommand == "goback") {
 		manager.goBack(tokens);
 	} else if (subcommand == "goto") {
@@ -1050,11 +1474,12 @@ string ReverseManager::ReverseCmd::help(const vector<string>& /*tokens*/) const
 	return "start               start collecting reverse data\n"
 	       "stop                stop collecting\n"
 	       "status              show various status info on reverse\n"
+	       "debug sizes         show the size and serialization time of the objects in a snapshot\n"
 	       "goback <n>          go back <n> seconds in time\n"
 	       "goto <time>         go to an absolute moment in time\n"
 	       "viewonlymode <bool> switch viewonly mode on or off\n"
 	       "truncatereplay      stop replaying and remove all 'future' data\n"
-	       "savereplay [<name>] save the first snapshot and all replay data as a 'replay' (with optional name)\n"
+	       "savereplay [-maxnofextrasnapshots <n>] [-snapshotinterval <sec>] [<name>]   save the first snapshot and all replay data as a 'replay' (with optional name)\n"
 	       "loadreplay [-goto <begin|end|savetime|<n>>] [-viewonly] <name>   load a replay (snapshot and replay data) with given name and start replaying\n";
 }
 
@@ -1072,6 +1497,8 @@ void ReverseManager::ReverseCmd::tabCompletion(vector<string>& tokens) const
 			std::vector<const char*> cmds;
 			if (tokens[1] == "loadreplay") {
 				cmds = { "-goto", "-viewonly" };
+			} else {
+				cmds = { "-maxnofextrasnapshots", "-snapshotinterval" };
 			}
 			completeFileName(tokens, userDataFileContext(REPLAY_DIR), cmds);
 		} else if (tokens[1] == "viewonlymode") {
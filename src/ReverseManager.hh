@@ -7,6 +7,8 @@
 #include "Command.hh"
 #include "EmuTime.hh"
 #include "MemBuffer.hh"
+#include "DeltaBlock.hh"
+#include "EventLog.hh"
 #include "array_ref.hh"
 #include "outer.hh"
 #include <vector>
@@ -17,6 +19,7 @@
 namespace openmsx {
 
 class MSXMotherBoard;
+class File;
 class Keyboard;
 class EventDelay;
 class EventDistributor;
@@ -51,11 +54,19 @@ public:
 
 private:
 	struct ReverseChunk {
-		ReverseChunk() : time(EmuTime::zero) {}
+		ReverseChunk() : time(EmuTime::zero), size(0), replayPos(0) {}
 
 		EmuTime time;
 		MemBuffer<uint8_t> savestate;
 		size_t size;
+		// Large blobs are stored separately, see DeltaBlock.
+		std::vector<std::shared_ptr<DeltaBlock>> deltaBlocks;
+
+		// Snapshots of a (binary) replay file are only loaded when
+		// needed. For those 'savestate' is empty and instead this is
+		// the file and the position of the snapshot in that file.
+		std::shared_ptr<File> replayFile;
+		size_t replayPos;
 
 		// Number of recorded events (or replay index) when this
 		// snapshot was created. So when going back replay should
@@ -63,15 +74,21 @@ private:
 		unsigned eventCount;
 	};
 	using Chunks = std::map<unsigned, ReverseChunk>;
-	using Events = std::vector<std::shared_ptr<StateChange>>;
 
 	struct ReverseHistory {
+		ReverseHistory();
 		void swap(ReverseHistory& other);
 		void clear();
 		unsigned getNextSeqNum(EmuTime::param time) const;
 
 		Chunks chunks;
-		Events events;
+		EventLog events;
+
+		// To predict the next 'reverse goto' while scrubbing, see
+		// prefetchSnapshots().
+		EmuTime lastGotoTarget;
+		uint64_t lastGotoHostTime; // in us
+		std::vector<std::shared_ptr<DeltaBlock>> prefetched;
 	};
 
 	bool isCollecting() const { return collecting; }
@@ -80,16 +97,26 @@ private:
 	void stop();
 	void status(TclObject& result) const;
 	void debugInfo(TclObject& result) const;
+	void debugSizes(TclObject& result);
 	void goBack(array_ref<TclObject> tokens);
 	void goTo(array_ref<TclObject> tokens);
 	void saveReplay(Interpreter& interp,
 	                array_ref<TclObject> tokens, TclObject& result);
 	void loadReplay(Interpreter& interp,
 	                array_ref<TclObject> tokens, TclObject& result);
+	void saveSeekableReplay(const std::string& filename,
+	                        double snapshotInterval);
+	static void loadSeekableReplay(const std::string& filename,
+	                               ReverseHistory& newHistory,
+	                               EmuTime& currentTime,
+	                               unsigned& newReRecordCount);
+	static void restoreSnapshot(const ReverseChunk& chunk,
+	                            MSXMotherBoard& board);
 
 	void signalStopReplay(EmuTime::param time);
 	EmuTime::param getEndTime(const ReverseHistory& history) const;
 	void goTo(EmuTime::param targetTime, bool novideo);
+	void prefetchSnapshots(EmuTime::param target);
 	void goTo(EmuTime::param targetTime, bool novideo,
 	          ReverseHistory& history, bool sameTimeLine);
 	void transferHistory(ReverseHistory& oldHistory,
@@ -99,6 +126,11 @@ private:
 	void schedule(EmuTime::param time);
 	void replayNextEvent();
 	template<unsigned N> void dropOldSnapshots(unsigned count);
+	void enforceMemoryBudget();
+	static size_t getChunkMemory(const ReverseChunk& chunk,
+	                             const ReverseChunk* prev,
+	                             const ReverseChunk* next);
+	static size_t getMemoryUsage(const ReverseHistory& history);
 
 	// Schedulable
 	struct SyncNewSnapshot : Schedulable {
@@ -143,6 +175,7 @@ private:
 	Keyboard* keyboard;
 	EventDelay* eventDelay;
 	ReverseHistory history;
+	LastDeltaBlocks lastDeltaBlocks;
 	unsigned replayIndex;
 	bool collecting;
 	bool pendingTakeSnapshot;
@@ -150,6 +183,7 @@ private:
 	unsigned reRecordCount;
 
 	friend struct Replay;
+	friend struct ReplayInfo;
 };
 
 } // namespace openmsx
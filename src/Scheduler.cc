@@ -2,10 +2,20 @@
 #include "Schedulable.hh"
 #include "Thread.hh"
 #include "MSXCPU.hh"
+#include "HostTimeProfile.hh"
 #include "serialize.hh"
+#include "StringOp.hh"
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <iterator> // for back_inserter
+#include <sstream>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
 
 namespace openmsx {
 
@@ -23,6 +33,7 @@ Scheduler::Scheduler()
 	: scheduleTime(EmuTime::zero)
 	, cpu(nullptr)
 	, scheduleInProgress(false)
+	, statsEnabled(false)
 {
 }
 
@@ -45,8 +56,8 @@ void Scheduler::setSyncPoint(EmuTime::param time, Schedulable& device)
 	// Push sync point into queue.
 	queue.insert(SynchronizationPoint(time, &device),
 	             [](SynchronizationPoint& sp) { sp.setTime(EmuTime::infinity); },
-	             [](const SynchronizationPoint& x, const SynchronizationPoint& y) {
-	                     return x.getTime() < y.getTime(); });
+	             LessSyncPoint());
+	if (unlikely(statsEnabled)) ++getStats(device).set;
 
 	if (!scheduleInProgress && cpu) {
 		// only when scheduleHelper() is not being executed
@@ -59,31 +70,56 @@ void Scheduler::setSyncPoint(EmuTime::param time, Schedulable& device)
 Scheduler::SyncPoints Scheduler::getSyncPoints(const Schedulable& device) const
 {
 	SyncPoints result;
+#ifdef USE_SCHEDULER_HEAP
+	// The heap is not sorted. The result gets serialized, and after loading
+	// the sync points are inserted again in this order. So (also for sync
+	// points with the same time) it must be the order in which they would
+	// be executed.
+	queue.copy_sorted_if(back_inserter(result), EqualSchedulable(device));
+#else
 	copy_if(std::begin(queue), std::end(queue), back_inserter(result),
 	        EqualSchedulable(device));
+#endif
 	return result;
 }
 
 bool Scheduler::removeSyncPoint(Schedulable& device)
 {
 	assert(Thread::isMainThread());
-	return queue.remove(EqualSchedulable(device));
+	bool result = queue.remove(EqualSchedulable(device));
+	if (unlikely(statsEnabled) && result) ++getStats(device).removed;
+	return result;
 }
 
 void Scheduler::removeSyncPoints(Schedulable& device)
 {
 	assert(Thread::isMainThread());
-	queue.remove_all(EqualSchedulable(device));
+	if (unlikely(statsEnabled)) {
+		auto oldSize = queue.size();
+		queue.remove_all(EqualSchedulable(device));
+		if (auto num = oldSize - queue.size()) {
+			getStats(device).removed += num;
+		}
+	} else {
+		queue.remove_all(EqualSchedulable(device));
+	}
 }
 
 bool Scheduler::pendingSyncPoint(const Schedulable& device,
                                  EmuTime& result) const
 {
 	assert(Thread::isMainThread());
-	auto it = std::find_if(std::begin(queue), std::end(queue),
-	                       EqualSchedulable(device));
-	if (it != std::end(queue)) {
-		result = it->getTime();
+	// Not all queue implementations iterate in sorted order, so look for
+	// the earliest match.
+	const SynchronizationPoint* earliest = nullptr;
+	for (auto& sp : queue) {
+		if ((sp.getDevice() == &device) &&
+		    (!earliest || (sp.getTime() < earliest->getTime()))) {
+			earliest = &sp;
+		}
+	}
+	if (earliest) {
+		result = earliest->getTime();
 		return true;
 	} else {
 		return false;
@@ -109,7 +145,21 @@ void Scheduler::scheduleHelper(EmuTime::param limit, EmuTime next)
 
 		queue.remove_front();
 
-		device->executeUntil(next);
+		HostTimeProfile::Scope profile(HostTimeProfile::SCHEDULER);
+		if (unlikely(statsEnabled)) {
+			using namespace std::chrono;
+			// The callback may delete the device (e.g.
+			// Benchmark::Stopper), so look up its type before.
+			std::type_index type(typeid(*device));
+			auto start = steady_clock::now();
+			device->executeUntil(next);
+			auto& s = stats[type];
+			++s.fired;
+			s.hostTime += duration_cast<nanoseconds>(
+				steady_clock::now() - start).count();
+		} else {
+			device->executeUntil(next);
+		}
 
 		next = getNext();
 		if (likely(next > limit)) break;
@@ -119,6 +169,63 @@ void Scheduler::scheduleHelper(EmuTime::param limit, EmuTime next)
 	cpu->setNextSyncPoint(next);
 }
 
+Scheduler::Stats& Scheduler::getStats(const Schedulable& device)
+{
+	return stats[std::type_index(typeid(device))];
+}
+
+static std::string getTypeName(const std::type_index& type)
+{
+	std::string result = type.name();
+#ifdef __GNUC__
+	int status;
+	if (char* demangled = abi::__cxa_demangle(
+			type.name(), nullptr, nullptr, &status)) {
+		result = demangled;
+		free(demangled);
+	}
+#endif
+	// strip prefixes added by some compilers, and the namespace all
+	// Schedulables live in
+	for (auto* prefix : {"class ", "struct ", "openmsx::"}) {
+		if (StringOp::startsWith(result, prefix)) {
+			result = result.substr(strlen(prefix));
+		}
+	}
+	return result;
+}
+
+std::string Scheduler::getStatsReport() const
+{
+	using Entry = std::pair<std::string, Stats>;
+	std::vector<Entry> entries;
+	for (auto& p : stats) {
+		entries.emplace_back(getTypeName(p.first), p.second);
+	}
+	std::sort(entries.begin(), entries.end(),
+	          [](const Entry& x, const Entry& y) {
+	                  return x.second.fired > y.second.fired; });
+
+	std::ostringstream os;
+	os << std::left << std::setw(40) << "schedulable" << std::right
+	   << std::setw(12) << "set"
+	   << std::setw(12) << "removed"
+	   << std::setw(12) << "fired"
+	   << std::setw(12) << "time(us)"
+	   << std::setw(10) << "avg(ns)" << '\n';
+	for (auto& e : entries) {
+		auto& s = e.second;
+		os << std::left << std::setw(40) << e.first << std::right
+		   << std::setw(12) << s.set
+		   << std::setw(12) << s.removed
+		   << std::setw(12) << s.fired
+		   << std::setw(12) << s.hostTime / 1000
+		   << std::setw(10) << (s.fired ? s.hostTime / s.fired : 0)
+		   << '\n';
+	}
+	return os.str();
+}
+
 
 template <typename Archive>
 void SynchronizationPoint::serialize(Archive& ar, unsigned /*version*/)
@@ -2,9 +2,17 @@
 #define SCHEDULER_HH
 
 #include "EmuTime.hh"
+#ifdef USE_SCHEDULER_HEAP
+#include "SchedulerHeap.hh"
+#else
 #include "SchedulerQueue.hh"
+#endif
 #include "likely.hh"
 #include <vector>
+#include <unordered_map>
+#include <typeindex>
+#include <string>
+#include <cstdint>
 
 namespace openmsx {
 
@@ -30,6 +38,13 @@ private:
 	Schedulable* device;
 };
 
+struct LessSyncPoint {
+	bool operator()(const SynchronizationPoint& x,
+	                const SynchronizationPoint& y) const {
+		return x.getTime() < y.getTime();
+	}
+};
+
 
 class Scheduler
 {
@@ -69,6 +84,19 @@ public:
 		scheduleTime = limit;
 	}
 
+	/** Collect statistics per Schedulable (sub)class: the number of
+	  * sync points that were set, removed and fired, and the (host) time
+	  * spent in executeUntil(). Disabled by default because measuring
+	  * the time is not free.
+	  */
+	void setStatsEnabled(bool enabled) { statsEnabled = enabled; }
+	bool isStatsEnabled() const { return statsEnabled; }
+	void clearStats() { stats.clear(); }
+	/** Human readable table with the collected statistics, sorted on the
+	  * number of fired sync points (this is what fragments the CPU
+	  * emulation). */
+	std::string getStatsReport() const;
+
 	template <typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
@@ -109,13 +137,30 @@ private: // -> intended for Schedulable
 private:
 	void scheduleHelper(EmuTime::param limit, EmuTime next);
 
-	/** Vector used as heap, not a priority queue because that
-	  * doesn't allow removal of non-top element.
+	struct Stats {
+		Stats() : set(0), removed(0), fired(0), hostTime(0) {}
+		uint64_t set;
+		uint64_t removed;
+		uint64_t fired;
+		uint64_t hostTime; // in ns
+	};
+	Stats& getStats(const Schedulable& device);
+
+	/** Sorted container of all pending sync points. The default
+	  * implementation is very fast for the typical access pattern (see
+	  * SchedulerQueue), the heap is an alternative for when there are
+	  * many sync points at widely varying times.
 	  */
+#ifdef USE_SCHEDULER_HEAP
+	SchedulerHeap<SynchronizationPoint, LessSyncPoint> queue;
+#else
 	SchedulerQueue<SynchronizationPoint> queue;
+#endif
+	std::unordered_map<std::type_index, Stats> stats;
 	EmuTime scheduleTime;
 	MSXCPU* cpu;
 	bool scheduleInProgress;
+	bool statsEnabled;
 };
 
 } // namespace openmsx
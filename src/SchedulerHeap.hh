@@ -0,0 +1,115 @@
+#ifndef SCHEDULERHEAP_HH
+#define SCHEDULERHEAP_HH
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cassert>
+#include <cstdint>
+
+namespace openmsx {
+
+// Alternative for SchedulerQueue, same interface (as far as it's used by
+// Scheduler). Elements are stored in a binary heap instead of a sorted
+// array, so insert and remove_front are O(log(N)) instead of (amortized)
+// O(1) resp. O(N) for inserts that don't land near the front. Removing an
+// arbitrary element (remove() and remove_all()) stays O(N).
+//
+// Contrary to SchedulerQueue iterating over the elements does NOT visit them
+// in sorted order.
+//
+// Select this implementation by compiling with -DUSE_SCHEDULER_HEAP.
+template<typename T, typename LESS> class SchedulerHeap
+{
+	// A binary heap on its own is not stable, so add a sequence number to
+	// keep the same order as SchedulerQueue for equivalent elements.
+	struct Entry : T {
+		Entry(const T& t, uint64_t order_) : T(t), order(order_) {}
+		uint64_t order;
+	};
+	// 'x comes after y', the heap algorithms put the maximum element
+	// according to this predicate at the front.
+	struct Later {
+		bool operator()(const Entry& x, const Entry& y) const {
+			LESS less;
+			if (less(y, x)) return true;
+			if (less(x, y)) return false;
+			return x.order > y.order;
+		}
+	};
+
+public:
+	SchedulerHeap()
+		: counter(0)
+	{
+	}
+
+	size_t size()  const { return heap.size(); }
+	bool   empty() const { return heap.empty(); }
+
+	// Returns reference to the smallest element. Like SchedulerQueue this
+	// is the sentinel value when the heap is empty.
+	const T& front() const { return empty() ? sentinel : heap.front(); }
+
+	const Entry* begin() const { return heap.data(); }
+	const Entry* end()   const { return heap.data() + heap.size(); }
+
+	// Copy the elements for which the predicate holds, in the order in
+	// which remove_front() would return them (so the same order as
+	// iterating over SchedulerQueue).
+	template<typename OUT, typename PRED>
+	void copy_sorted_if(OUT out, PRED p) const
+	{
+		std::vector<Entry> tmp;
+		std::copy_if(heap.begin(), heap.end(), std::back_inserter(tmp), p);
+		std::sort(tmp.begin(), tmp.end(),
+		          [](const Entry& x, const Entry& y) { return Later()(y, x); });
+		std::copy(tmp.begin(), tmp.end(), out);
+	}
+
+	template<typename SET_SENTINEL>
+	void insert(const T& t, SET_SENTINEL setSentinel, LESS /*less*/)
+	{
+		setSentinel(sentinel);
+		heap.emplace_back(t, counter++);
+		std::push_heap(heap.begin(), heap.end(), Later());
+	}
+
+	void remove_front()
+	{
+		assert(!empty());
+		std::pop_heap(heap.begin(), heap.end(), Later());
+		heap.pop_back();
+	}
+
+	template<typename PRED> bool remove(PRED p)
+	{
+		auto it = std::find_if(heap.begin(), heap.end(), p);
+		if (it == heap.end()) return false;
+
+		if (it != (heap.end() - 1)) {
+			*it = heap.back();
+			heap.pop_back();
+			std::make_heap(heap.begin(), heap.end(), Later());
+		} else {
+			heap.pop_back();
+		}
+		return true;
+	}
+
+	template<typename PRED> void remove_all(PRED p)
+	{
+		heap.erase(std::remove_if(heap.begin(), heap.end(), p),
+		           heap.end());
+		std::make_heap(heap.begin(), heap.end(), Later());
+	}
+
+private:
+	std::vector<Entry> heap;
+	T sentinel;
+	uint64_t counter;
+};
+
+} // namespace openmsx
+
+#endif // SCHEDULERHEAP_HH
@@ -0,0 +1,89 @@
+#include "SerializeProfile.hh"
+#include "Timer.hh"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <cassert>
+
+namespace openmsx {
+
+void SerializeProfile::beginTag(const char* tag, size_t pos)
+{
+	std::string path = stack.empty() ? std::string(tag)
+	                                 : stack.back().path + '/' + tag;
+	stack.push_back({tag, std::move(path), pos, Timer::getTime(), 0, 0});
+}
+
+void SerializeProfile::endTag(size_t pos)
+{
+	assert(!stack.empty());
+	auto now = Timer::getTime();
+	Frame frame = std::move(stack.back());
+	stack.pop_back();
+
+	size_t stored = pos - frame.startPos;
+	auto& entry = entries[frame.path];
+	if (entry.path.empty()) {
+		entry = Entry{frame.path, 0, 0, 0, 0};
+	}
+	entry.rawSize    += stored - frame.blobStored + frame.blobRaw;
+	entry.storedSize += stored;
+	entry.time       += now - frame.startTime;
+	entry.count      += 1;
+
+	if (!stack.empty()) {
+		stack.back().blobRaw    += frame.blobRaw;
+		stack.back().blobStored += frame.blobStored;
+	}
+}
+
+void SerializeProfile::stringValue(string_ref str)
+{
+	// The polymorphic type of an object is stored in a 'type' tag (see
+	// ClassSaver), use it to name the enclosing object.
+	if ((stack.size() >= 2) && (strcmp(stack.back().tag, "type") == 0)) {
+		stack[stack.size() - 2].path += '[' + str.str() + ']';
+	}
+}
+
+void SerializeProfile::blob(size_t rawSize, size_t storedSize)
+{
+	if (stack.empty()) return;
+	stack.back().blobRaw    += rawSize;
+	stack.back().blobStored += storedSize;
+}
+
+std::vector<SerializeProfile::Entry> SerializeProfile::getEntries(size_t minSize) const
+{
+	std::vector<Entry> result;
+	for (auto& p : entries) {
+		if (p.second.storedSize >= minSize) {
+			result.push_back(p.second);
+		}
+	}
+	sort(begin(result), end(result), [](const Entry& x, const Entry& y) {
+		return (x.storedSize != y.storedSize)
+		     ? (x.storedSize > y.storedSize)
+		     : (x.path < y.path);
+	});
+	return result;
+}
+
+std::string SerializeProfile::format(size_t minSize) const
+{
+	std::ostringstream os;
+	os << "    stored       raw   time(us)  path\n";
+	for (auto& e : getEntries(minSize)) {
+		os << std::setw(10) << e.storedSize << ' '
+		   << std::setw(9) << e.rawSize << ' '
+		   << std::setw(10) << e.time << "  " << e.path;
+		if (e.count > 1) {
+			os << " (" << e.count << "x)";
+		}
+		os << '\n';
+	}
+	return os.str();
+}
+
+} // namespace openmsx
@@ -0,0 +1,62 @@
+#ifndef SERIALIZEPROFILE_HH
+#define SERIALIZEPROFILE_HH
+
+#include "string_ref.hh"
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+namespace openmsx {
+
+/** Attributes the size and the serialization time of a snapshot to the (tag)
+  * path of the serialized objects, for example
+  * "machine/config/device[VDP]/vram". The '[...]' part is the polymorphic
+  * type of the object. All sizes and times are inclusive (they contain those
+  * of the nested tags), objects with the same path (e.g. items of a
+  * collection) are added together.
+  *
+  * Attach it to a MemOutputArchive (see MemOutputArchive::setProfile()). This
+  * is only meant to find out which devices make snapshots expensive (see
+  * 'reverse debug sizes'), it's not used for the regular snapshots.
+  */
+class SerializeProfile
+{
+public:
+	struct Entry {
+		std::string path;
+		size_t rawSize;    // in bytes, before compression of the blobs
+		size_t storedSize; // in bytes, actual size in the stream
+		uint64_t time;     // in us
+		unsigned count;    // number of objects with this path
+	};
+
+	// Called by the archive.
+	void beginTag(const char* tag, size_t pos);
+	void endTag(size_t pos);
+	void stringValue(string_ref str);
+	void blob(size_t rawSize, size_t storedSize);
+
+	/** All entries with a stored size of at least 'minSize' bytes,
+	  * sorted on decreasing stored size. */
+	std::vector<Entry> getEntries(size_t minSize) const;
+
+	/** Same as getEntries(), but formatted as a table. */
+	std::string format(size_t minSize) const;
+
+private:
+	struct Frame {
+		const char* tag;
+		std::string path;
+		size_t startPos;
+		uint64_t startTime;
+		size_t blobRaw;
+		size_t blobStored;
+	};
+	std::vector<Frame> stack;
+	std::map<std::string, Entry> entries;
+};
+
+} // namespace openmsx
+
+#endif
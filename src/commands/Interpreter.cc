@@ -9,6 +9,7 @@
 #include "InterpreterOutput.hh"
 #include "MSXCPUInterface.hh"
 #include "FileOperations.hh"
+#include "HostTimeProfile.hh"
 #include "array_ref.hh"
 #include "stl.hh"
 #include "unreachable.hh"
@@ -197,6 +198,7 @@ bool Interpreter::isComplete(const string& command) const
 
 TclObject Interpreter::execute(const string& command)
 {
+	HostTimeProfile::Scope profile(HostTimeProfile::TCL);
 	int success = Tcl_Eval(interp, command.c_str());
 	if (success != TCL_OK) {
 		throw CommandException(Tcl_GetStringResult(interp));
@@ -206,6 +208,7 @@ TclObject Interpreter::execute(const string& command)
 
 TclObject Interpreter::executeFile(const string& filename)
 {
+	HostTimeProfile::Scope profile(HostTimeProfile::TCL);
 	int success = Tcl_EvalFile(interp, filename.c_str());
 	if (success != TCL_OK) {
 		throw CommandException(Tcl_GetStringResult(interp));
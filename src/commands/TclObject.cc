@@ -1,6 +1,7 @@
 #include "TclObject.hh"
 #include "Interpreter.hh"
 #include "CommandException.hh"
+#include "HostTimeProfile.hh"
 
 namespace openmsx {
 
@@ -207,6 +208,7 @@ bool TclObject::evalBool(Interpreter& interp_) const
 
 TclObject TclObject::executeCommand(Interpreter& interp_, bool compile)
 {
+	HostTimeProfile::Scope profile(HostTimeProfile::TCL);
 	auto* interp = interp_.interp;
 	int flags = compile ? 0 : TCL_EVAL_DIRECT;
 	int success = Tcl_EvalObjEx(interp, obj, flags);
@@ -1,4 +1,6 @@
 #include "BreakPointBase.hh"
+#include "CompiledCondition.hh"
+#include "MSXCPUInterface.hh"
 #include "CommandException.hh"
 #include "GlobalCliComm.hh"
 #include "ScopedAssign.hh"
@@ -7,10 +9,19 @@ namespace openmsx {
 
 BreakPointBase::BreakPointBase(TclObject command_, TclObject condition_)
 	: command(command_), condition(condition_)
+	, compiled(CompiledCondition::compile(condition.getString()))
 	, executing(false)
 {
 }
 
+bool BreakPointBase::isCompiledFalse(
+	const CPURegs& regs, const MSXCPUInterface& interface,
+	EmuTime::param time) const
+{
+	return compiled && !executing &&
+	       !compiled->evaluate(regs, interface, time);
+}
+
 bool BreakPointBase::isTrue(GlobalCliComm& cliComm, Interpreter& interp) const
 {
 	if (condition.getString().empty()) {
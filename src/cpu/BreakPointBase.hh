@@ -2,12 +2,17 @@
 #define BREAKPOINTBASE_HH
 
 #include "TclObject.hh"
+#include "EmuTime.hh"
 #include "string_ref.hh"
+#include <memory>
 
 namespace openmsx {
 
 class Interpreter;
 class GlobalCliComm;
+class CPURegs;
+class MSXCPUInterface;
+class CompiledCondition;
 
 /** Base class for CPU break and watch points.
  */
@@ -21,6 +26,15 @@ public:
 
 	void checkAndExecute(GlobalCliComm& cliComm, Interpreter& interp);
 
+	/** Returns true iff the condition could be compiled to native code
+	  * (see CompiledCondition) and it currently evaluates to false. In
+	  * that case checkAndExecute() would do nothing, so it can be skipped
+	  * without evaluating the condition via Tcl.
+	  */
+	bool isCompiledFalse(const CPURegs& regs,
+	                     const MSXCPUInterface& interface,
+	                     EmuTime::param time) const;
+
 protected:
 	// Note: we require GlobalCliComm here because breakpoint objects can
 	// be transfered to different MSX machines, and so the MSXCliComm
@@ -32,6 +46,7 @@ private:
 
 	TclObject command;
 	TclObject condition;
+	std::shared_ptr<const CompiledCondition> compiled; // can be nullptr
 	bool executing;
 };
 
@@ -113,6 +113,12 @@ protected:
 	inline bool limitReached() const {
 		return remaining < 0;
 	}
+	/** The number of ticks that can still be add()'ed before
+	  * limitReached() becomes true. Negative when the limit is already
+	  * reached (or disabled). */
+	int getTicksTillLimit() const {
+		return remaining;
+	}
 
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
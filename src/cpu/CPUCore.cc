@@ -165,6 +165,7 @@
 #include "CliComm.hh"
 #include "TclCallback.hh"
 #include "Dasm.hh"
+#include "CPUTraceBuffer.hh"
 #include "Z80.hh"
 #include "R800.hh"
 #include "Thread.hh"
@@ -295,6 +296,8 @@ static void initTables()
 template<class T> CPUCore<T>::CPUCore(
 		MSXMotherBoard& motherboard_, const string& name,
 		const BooleanSetting& traceSetting_,
+		const BooleanSetting& blockCacheSetting_,
+		CPUTraceBuffer& traceBuffer_,
 		TclCallback& diHaltCallback_, EmuTime::param time)
 	: CPURegs(T::isR800())
 	, T(time, motherboard_.getScheduler())
@@ -302,6 +305,8 @@ template<class T> CPUCore<T>::CPUCore(
 	, scheduler(motherboard.getScheduler())
 	, interface(nullptr)
 	, traceSetting(traceSetting_)
+	, blockCacheSetting(blockCacheSetting_)
+	, traceBuffer(traceBuffer_)
 	, diHaltCallback(diHaltCallback_)
 	, IRQStatus(motherboard.getDebugger(), name + ".pendingIRQ",
 	            "Non-zero if there are pending IRQs (thus CPU would enter "
@@ -323,11 +328,25 @@ template<class T> CPUCore<T>::CPUCore(
 	, NMIStatus(0)
 	, nmiEdge(false)
 	, exitLoop(false)
-	, tracingEnabled(traceSetting.getBoolean())
+	, printTrace(traceSetting.getBoolean())
+	, recordTrace(traceBuffer.getSizeSetting().getInt() != 0)
+	, recordPc(0)
+	, checkBreakLines(false)
+	, breakLinesVersion(MSXCPUInterface::getBreakPointLinesVersion())
+	, loopRegs()
+	, loopR(0)
+	, loopBranch(unsigned(-1))
+	, loopTicks(0)
+	, loopUncached(0)
+	, loopState(LOOP_NEW)
+	, uncachedReads(0)
+	, useBlockCache(false)
 	, isTurboR(motherboard.isTurboR())
 {
 	static_assert(!std::is_polymorphic<CPUCore<T>>::value,
 		"keep CPUCore non-virtual to keep PC at offset 0");
+	memset(recordOpcode, 0, sizeof(recordOpcode));
+	update(blockCacheSetting);
 	doSetFreq();
 	doReset(time);
 
@@ -353,6 +372,35 @@ template<class T> void CPUCore<T>::invalidateMemCache(unsigned start, unsigned s
 	memset(&writeCacheLine [first], 0, num * sizeof(byte*)); //
 	memset(&readCacheTried [first], 0, num * sizeof(bool));  // FALSE
 	memset(&writeCacheTried[first], 0, num * sizeof(bool));  //
+	memset(&readWatchedLine [first], 0, num * sizeof(byte*)); // nullptr
+	memset(&writeWatchedLine[first], 0, num * sizeof(byte*)); //
+	if (!blockLines.empty()) {
+		for (unsigned i = 0; i < num; ++i) {
+			blockLines[first + i].line = nullptr; // see executeBlock()
+		}
+	}
+}
+
+template<class T> void CPUCore<T>::fillReadCache(
+	unsigned start, unsigned size, const byte* data)
+{
+	unsigned first = start / CacheLine::SIZE;
+	unsigned num = size / CacheLine::SIZE;
+	// same offset trick as in RDMEMslow(): index with the full address
+	const byte* line = data - start;
+	for (unsigned i = 0; i < num; ++i) {
+		readCacheLine [first + i] = line;
+		readCacheTried[first + i] = true;
+	}
+	memset(&writeCacheLine [first], 0, num * sizeof(byte*)); // nullptr
+	memset(&writeCacheTried[first], 0, num * sizeof(bool));  // FALSE
+	memset(&readWatchedLine [first], 0, num * sizeof(byte*)); // nullptr
+	memset(&writeWatchedLine[first], 0, num * sizeof(byte*)); //
+	if (!blockLines.empty()) {
+		for (unsigned i = 0; i < num; ++i) {
+			blockLines[first + i].line = nullptr; // see executeBlock()
+		}
+	}
 }
 
 template<class T> void CPUCore<T>::doReset(EmuTime::param time)
@@ -448,6 +496,916 @@ template<class T> inline bool CPUCore<T>::needExitCPULoop()
 	//return exitLoop.exchange(false);
 }
 
+template<class T> inline bool CPUCore<T>::isBreakLine(unsigned address) const
+{
+	return checkBreakLines &&
+	       MSXCPUInterface::isBreakPointLine(address >> CacheLine::BITS);
+}
+
+template<class T> inline void CPUCore<T>::syncBreakLines()
+{
+	unsigned version = MSXCPUInterface::getBreakPointLinesVersion();
+	if (unlikely(breakLinesVersion != version)) {
+		// Breakpoint lines changed, make sure none of them is still
+		// cached (see RDMEMslow()).
+		breakLinesVersion = version;
+		invalidateMemCache(0x0000, 0x10000);
+	}
+}
+
+template<class T> inline void CPUCore<T>::resetPollingLoop()
+{
+	// The tick counts in the polling loop state are relative to the
+	// current limit, so they're only valid for one executeInstructions()
+	// run.
+	loopBranch = unsigned(-1);
+}
+
+template<class T> inline void CPUCore<T>::backwardBranch(unsigned branchEnd)
+{
+	if (T::isR800()) return; // see pollingLoop()
+	// skipped iterations wouldn't show up in the trace buffer
+	if (unlikely(recordTrace)) return;
+	if (likely(branchEnd != loopBranch)) {
+		loopBranch = branchEnd;
+		loopState = LOOP_NEW;
+	} else if (loopState != LOOP_REJECTED) {
+		pollingLoop(branchEnd);
+	}
+}
+
+// Many programs wait for an interrupt (e.g. VBLANK) or for a flag set by an
+// interrupt routine with a tight loop like
+//     loop: ld a,(JIFFY) ; cp b ; jr z,loop
+// Such a loop only reads memory and registers. When the CPU state is the same
+// at the start of two consecutive iterations, nothing can change until the
+// next sync point: memory that's in the read cache only changes via CPU
+// writes or via devices (and those only run at sync points), and IRQs are
+// also only raised at sync points. So instead of emulating each iteration,
+// we can skip as many whole iterations as fit before the next sync point.
+// This gives exactly the same result (registers, R, EmuTime) as emulating
+// them, the remaining partial iteration is emulated normally.
+//
+// This is called from taken backward jumps, the second time in a row the same
+// jump is taken. Only the Z80 is handled: R800 timing also depends on the
+// refresh and page-break state, so its iterations don't necessarily take the
+// same number of cycles.
+template<class T> NEVER_INLINE void CPUCore<T>::pollingLoop(unsigned branchEnd)
+{
+	if (loopState == LOOP_NEW) {
+		if (!isPollingLoopBody(getPC(), branchEnd)) {
+			loopState = LOOP_REJECTED;
+			return;
+		}
+		loopState = LOOP_CANDIDATE;
+	} else {
+		assert(loopState == LOOP_CANDIDATE);
+		LoopRegs regs = getLoopRegs();
+		if ((uncachedReads != loopUncached) ||
+		    (memcmp(&regs, &loopRegs, sizeof(regs)) != 0)) {
+			loopState = LOOP_REJECTED;
+			return;
+		}
+		int iterTicks = loopTicks - T::getTicksTillLimit();
+		int ticks = T::getTicksTillLimit();
+		if ((iterTicks > 0) && (ticks >= iterTicks)) {
+			unsigned n = ticks / iterTicks;
+			byte iterR = getR() - loopR;
+			T::add(n * iterTicks);
+			incR(n * iterR);
+		}
+	}
+	loopRegs = getLoopRegs();
+	loopR = getR();
+	loopTicks = T::getTicksTillLimit();
+	loopUncached = uncachedReads;
+}
+
+template<class T> inline typename CPUCore<T>::LoopRegs
+CPUCore<T>::getLoopRegs() const
+{
+	// Everything except R, which is handled in pollingLoop(). PC is the
+	// same by construction. Registers like IFF1 or IM can't be changed by
+	// the instructions accepted by isPollingLoopBody(). MEMPTR is set by
+	// the branch instruction itself.
+	return LoopRegs{getAF(),  getBC(),  getDE(),  getHL(),
+	                getAF2(), getBC2(), getDE2(), getHL2(),
+	                getIX(),  getIY(),  getSP(),  getI()};
+}
+
+// Returns the length of the given instruction if it's side-effect free (it
+// doesn't write to memory or I/O, and doesn't change interrupt or halt
+// state), 0 otherwise. Only the most common instructions are recognized.
+// 'isBranch' is set for (conditional) jumps.
+static unsigned pollingLoopInstruction(const byte* p, bool& isBranch)
+{
+	isBranch = false;
+	byte op = p[0];
+	switch (op) {
+	case 0x00: case 0x07: case 0x0F: case 0x17: case 0x1F: // nop, rotates
+	case 0x27: case 0x2F: case 0x37: case 0x3F: // daa cpl scf ccf
+	case 0x08: case 0xD9: case 0xEB: case 0xF9: // ex af,af' exx ex de,hl ld sp,hl
+	case 0x0A: case 0x1A:                       // ld a,(bc)  ld a,(de)
+	case 0x03: case 0x0B: case 0x13: case 0x1B: // inc/dec ss
+	case 0x23: case 0x2B: case 0x33: case 0x3B:
+	case 0x09: case 0x19: case 0x29: case 0x39: // add hl,ss
+	case 0x04: case 0x05: case 0x0C: case 0x0D: // inc/dec r
+	case 0x14: case 0x15: case 0x1C: case 0x1D:
+	case 0x24: case 0x25: case 0x2C: case 0x2D:
+	case 0x3C: case 0x3D:
+		return 1;
+	case 0x06: case 0x0E: case 0x16: case 0x1E: // ld r,n
+	case 0x26: case 0x2E: case 0x3E:
+	case 0xC6: case 0xCE: case 0xD6: case 0xDE: // alu n
+	case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+		return 2;
+	case 0x01: case 0x11: case 0x21: case 0x31: // ld ss,nn
+	case 0x2A: case 0x3A:                       // ld hl,(nn)  ld a,(nn)
+		return 3;
+	case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // jr
+		isBranch = true;
+		return 2;
+	case 0xC3: case 0xC2: case 0xCA: case 0xD2: // jp
+	case 0xDA: case 0xE2: case 0xEA: case 0xF2: case 0xFA:
+		isBranch = true;
+		return 3;
+	case 0xCB: {
+		// everything except rotate/shift/res/set on (hl)
+		byte op2 = p[1];
+		bool write = ((op2 & 7) == 6) && ((op2 < 0x40) || (op2 >= 0x80));
+		return write ? 0 : 2;
+	}
+	case 0xED:
+		switch (p[1]) {
+		case 0x44: return 2;                         // neg
+		case 0x4B: case 0x5B: case 0x6B: case 0x7B: return 4; // ld ss,(nn)
+		default:   return 0;
+		}
+	case 0xDD: case 0xFD:
+		switch (p[1]) {
+		case 0x09: case 0x19: case 0x29: case 0x39: // add ix,ss
+		case 0x23: case 0x2B:                       // inc/dec ix
+			return 2;
+		case 0x21: case 0x2A:                       // ld ix,nn  ld ix,(nn)
+			return 4;
+		case 0x46: case 0x4E: case 0x56: case 0x5E: // ld r,(ix+d)
+		case 0x66: case 0x6E: case 0x7E:
+		case 0x86: case 0x8E: case 0x96: case 0x9E: // alu (ix+d)
+		case 0xA6: case 0xAE: case 0xB6: case 0xBE:
+			return 3;
+		case 0xCB:                                  // bit n,(ix+d)
+			return ((p[3] & 0xC0) == 0x40) ? 4 : 0;
+		default:
+			return 0;
+		}
+	default:
+		if ((0x40 <= op) && (op < 0x80)) {
+			// ld r,r'  ld r,(hl), but not ld (hl),r and halt
+			return ((op & 0xF8) == 0x70) ? 0 : 1;
+		}
+		if ((0x80 <= op) && (op < 0xC0)) {
+			return 1; // alu r  alu (hl)
+		}
+		return 0;
+	}
+}
+
+template<class T> bool CPUCore<T>::isPollingLoopBody(
+	unsigned start, unsigned end) const
+{
+	// Straight-line code in cached memory, only the last instruction is a
+	// branch. Small limit on the size: it's a waste of time to look at
+	// bigger loops, they're unlikely polling loops.
+	static const unsigned MAX_SIZE = 32;
+	if ((start >= end) || ((end - start) > MAX_SIZE)) return false;
+	unsigned size = end - start;
+	byte code[MAX_SIZE + 3] = {}; // room for the longest instruction
+	for (unsigned i = 0; i < size; ++i) {
+		unsigned addr = start + i;
+		const byte* line = readCacheLine[addr >> CacheLine::BITS];
+		if (!line) return false;
+		code[i] = line[addr];
+	}
+	unsigned pos = 0;
+	while (pos < size) {
+		bool isBranch;
+		unsigned len = pollingLoopInstruction(&code[pos], isBranch);
+		if (len == 0) return false;
+		pos += len;
+		if (isBranch) return pos == size;
+	}
+	return false;
+}
+
+// The block cache skips part of the work executeInstructions() does for each
+// instruction. Runs of instructions that only use registers and immediate
+// operands are decoded once per cache line, executing such a block doesn't
+// need the readCacheLine lookup, the opcode fetch and the prefix decoding
+// for every instruction. Everything else (PC, R, T::add(), the trace buffer
+// and the limit check) is still done after each instruction exactly like in
+// executeInstructions(), so the result is the same, cycle for cycle.
+//
+// The blocks in a line belong to the readCacheLine[] entry they were decoded
+// from, invalidateMemCache() and fillReadCache() drop them together with that
+// entry. Writes to cached RAM don't go via the CPU core, so each block also
+// keeps the bytes it was decoded from, and it is decoded again when those
+// changed (self-modifying code).
+//
+// Like the polling loop detection, this is only done for the Z80. On the
+// R800 each opcode fetch can cause a page-break.
+template<class T> inline bool CPUCore<T>::executeBlock()
+{
+	unsigned address = getPC();
+	unsigned high = address >> CacheLine::BITS;
+	const byte* line = readCacheLine[high];
+	if (!line) return false;
+	BlockLine& blockLine = blockLines[high];
+	if (unlikely(blockLine.line != line)) {
+		blockLine.line = line;
+		memset(blockLine.index, BLOCK_UNKNOWN, sizeof(blockLine.index));
+		blockLine.blocks.clear();
+	}
+	if (likely(blockLine.index[address & CacheLine::LOW] == BLOCK_NONE)) {
+		return false;
+	}
+	return runBlock(blockLine, address);
+}
+
+template<class T> NEVER_INLINE bool CPUCore<T>::runBlock(
+	BlockLine& blockLine, unsigned address)
+{
+	const byte* code = &blockLine.line[address];
+	unsigned size = CacheLine::SIZE - (address & CacheLine::LOW);
+	byte& index = blockLine.index[address & CacheLine::LOW];
+	if (index == BLOCK_UNKNOWN) {
+		Block block;
+		if ((blockLine.blocks.size() == (256 - BLOCK_FIRST)) ||
+		    !decodeBlock(block, code, size)) {
+			index = BLOCK_NONE;
+			return false;
+		}
+		index = byte(BLOCK_FIRST + blockLine.blocks.size());
+		blockLine.blocks.push_back(block);
+	}
+	Block& block = blockLine.blocks[index - BLOCK_FIRST];
+	if (unlikely(memcmp(block.code, code, block.size) != 0)) {
+		if (!decodeBlock(block, code, size)) {
+			index = BLOCK_NONE;
+			return false;
+		}
+	}
+	for (unsigned i = 0; i < block.num; ++i) {
+		unsigned op = block.ops[i];
+		// number of opcode bytes, also the number of M1 cycles
+		unsigned n = (op < 0x100) ? 1 : 2;
+		setPC(getPC() + n);
+		incR(n);
+		int c = executeBlockInstruction(op);
+		T::add(c);
+		cpuTraceRecord();
+		T::R800Refresh(*this);
+		if (T::limitReached()) break;
+	}
+	return true;
+}
+
+// Returns the length of the given instruction if it's executed by
+// executeBlock() (it only uses registers and immediate operands), 0
+// otherwise. 'op' is set to the opcode, with 0x100, 0x200, 0x300 or 0x400
+// added for the CB, ED, DD or FD prefix.
+static unsigned blockInstruction(const byte* p, unsigned avail, unsigned& op)
+{
+	byte op1 = p[0];
+	switch (op1) {
+	case 0xCB: case 0xED: case 0xDD: case 0xFD: {
+		if (avail < 2) return 0;
+		byte op2 = p[1];
+		if (op1 == 0xCB) {
+			// everything except the (hl) variants
+			op = 0x100 | op2;
+			return ((op2 & 7) != 6) ? 2 : 0;
+		}
+		if (op1 == 0xED) {
+			op = 0x200 | op2;
+			// adc hl,ss  sbc hl,ss  neg
+			return ((op2 & 0xC7) == 0x42) || ((op2 & 0xC7) == 0x44) ? 2 : 0;
+		}
+		op = ((op1 == 0xDD) ? 0x300 : 0x400) | op2;
+		unsigned len;
+		switch (op2) {
+		case 0x09: case 0x19: case 0x29: case 0x39: // add ix,ss
+		case 0x23: case 0x2B:                       // inc/dec ix
+		case 0x24: case 0x25: case 0x2C: case 0x2D: // inc/dec ixh/ixl
+		case 0xF9:                                  // ld sp,ix
+			len = 2; break;
+		case 0x26: case 0x2E:                       // ld ixh/ixl,n
+			len = 3; break;
+		case 0x21:                                  // ld ix,nn
+			len = 4; break;
+		default:
+			if ((0x40 <= op2) && (op2 < 0x80)) {
+				// ld r,r' with ixh/ixl (but not ld ixh,ixh or ld
+				// ixl,ixl), no (ix+d)
+				unsigned dst = (op2 >> 3) & 7;
+				unsigned src = op2 & 7;
+				bool ixy = (dst == 4) || (dst == 5) ||
+				           (src == 4) || (src == 5);
+				len = (ixy && (dst != 6) && (src != 6) &&
+				       (op2 != 0x64) && (op2 != 0x6D)) ? 2 : 0;
+			} else if ((0x80 <= op2) && (op2 < 0xC0)) {
+				// alu ixh/ixl
+				len = (((op2 & 7) == 4) || ((op2 & 7) == 5)) ? 2 : 0;
+			} else {
+				len = 0;
+			}
+		}
+		return (len <= avail) ? len : 0;
+	}
+	default:
+		break;
+	}
+	op = op1;
+	unsigned len;
+	if (op1 < 0x40) {
+		switch (op1 & 0x0F) {
+		case 0x00: len = (op1 == 0x00) ? 1 : 0; break; // nop, not djnz/jr
+		case 0x08: len = (op1 == 0x08) ? 1 : 0; break; // ex af,af'
+		case 0x01: len = 3; break;                     // ld ss,nn
+		case 0x03: case 0x0B:                          // inc/dec ss
+		case 0x09:                                     // add hl,ss
+		case 0x07: case 0x0F:                          // rotates, daa cpl scf ccf
+			len = 1; break;
+		case 0x04: case 0x05: case 0x0C: case 0x0D:    // inc/dec r
+			len = ((op1 & 0xF0) != 0x30) || (op1 & 0x08) ? 1 : 0;
+			break;
+		case 0x06: case 0x0E:                          // ld r,n
+			len = (op1 != 0x36) ? 2 : 0;
+			break;
+		default:                                       // memory access
+			len = 0;
+		}
+	} else if (op1 < 0x80) {
+		// ld r,r', but not with (hl) and not halt
+		len = (((op1 & 7) != 6) && ((op1 & 0x38) != 0x30)) ? 1 : 0;
+	} else if (op1 < 0xC0) {
+		len = ((op1 & 7) != 6) ? 1 : 0; // alu r
+	} else if ((op1 & 7) == 6) {
+		len = 2;                         // alu n
+	} else {
+		len = ((op1 == 0xD9) || (op1 == 0xEB) || (op1 == 0xF9)) ? 1 : 0;
+	}
+	return (len <= avail) ? len : 0;
+}
+
+template<class T> bool CPUCore<T>::decodeBlock(
+	Block& block, const byte* code, unsigned size)
+{
+	if (size > Block::MAX_SIZE) size = Block::MAX_SIZE;
+	unsigned pos = 0;
+	unsigned num = 0;
+	while (pos < size) {
+		unsigned op;
+		unsigned len = blockInstruction(&code[pos], size - pos, op);
+		if (len == 0) break;
+		block.ops[num++] = op;
+		pos += len;
+	}
+	if (num < 2) return false; // a single instruction isn't worth it
+	memcpy(block.code, code, pos);
+	block.size = pos;
+	block.num = num;
+	return true;
+}
+
+// Same as the corresponding cases in executeInstructions().
+template<class T> ALWAYS_INLINE int CPUCore<T>::executeBlockInstruction(unsigned op)
+{
+#define MAIN(X) case 0x0##X:
+#define CB(X)   case 0x1##X:
+#define ED(X)   case 0x2##X:
+#define DD(X)   case 0x3##X:
+#define FD(X)   case 0x4##X:
+	switch (op) {
+	MAIN(00) return nop();
+	MAIN(01) return ld_SS_word<BC,0>();
+	MAIN(03) return inc_SS<BC,0>();
+	MAIN(04) return inc_R<B,0>();
+	MAIN(05) return dec_R<B,0>();
+	MAIN(06) return ld_R_byte<B,0>();
+	MAIN(07) return rlca();
+	MAIN(08) return ex_af_af();
+	MAIN(09) return add_SS_TT<HL,BC,0>();
+	MAIN(0B) return dec_SS<BC,0>();
+	MAIN(0C) return inc_R<C,0>();
+	MAIN(0D) return dec_R<C,0>();
+	MAIN(0E) return ld_R_byte<C,0>();
+	MAIN(0F) return rrca();
+	MAIN(11) return ld_SS_word<DE,0>();
+	MAIN(13) return inc_SS<DE,0>();
+	MAIN(14) return inc_R<D,0>();
+	MAIN(15) return dec_R<D,0>();
+	MAIN(16) return ld_R_byte<D,0>();
+	MAIN(17) return rla();
+	MAIN(19) return add_SS_TT<HL,DE,0>();
+	MAIN(1B) return dec_SS<DE,0>();
+	MAIN(1C) return inc_R<E,0>();
+	MAIN(1D) return dec_R<E,0>();
+	MAIN(1E) return ld_R_byte<E,0>();
+	MAIN(1F) return rra();
+	MAIN(21) return ld_SS_word<HL,0>();
+	MAIN(23) return inc_SS<HL,0>();
+	MAIN(24) return inc_R<H,0>();
+	MAIN(25) return dec_R<H,0>();
+	MAIN(26) return ld_R_byte<H,0>();
+	MAIN(27) return daa();
+	MAIN(29) return add_SS_SS<HL,0>();
+	MAIN(2B) return dec_SS<HL,0>();
+	MAIN(2C) return inc_R<L,0>();
+	MAIN(2D) return dec_R<L,0>();
+	MAIN(2E) return ld_R_byte<L,0>();
+	MAIN(2F) return cpl();
+	MAIN(31) return ld_SS_word<SP,0>();
+	MAIN(33) return inc_SS<SP,0>();
+	MAIN(37) return scf();
+	MAIN(39) return add_SS_TT<HL,SP,0>();
+	MAIN(3B) return dec_SS<SP,0>();
+	MAIN(3C) return inc_R<A,0>();
+	MAIN(3D) return dec_R<A,0>();
+	MAIN(3E) return ld_R_byte<A,0>();
+	MAIN(3F) return ccf();
+	MAIN(40) return nop();
+	MAIN(41) return ld_R_R<B,C,0>();
+	MAIN(42) return ld_R_R<B,D,0>();
+	MAIN(43) return ld_R_R<B,E,0>();
+	MAIN(44) return ld_R_R<B,H,0>();
+	MAIN(45) return ld_R_R<B,L,0>();
+	MAIN(47) return ld_R_R<B,A,0>();
+	MAIN(48) return ld_R_R<C,B,0>();
+	MAIN(49) return nop();
+	MAIN(4A) return ld_R_R<C,D,0>();
+	MAIN(4B) return ld_R_R<C,E,0>();
+	MAIN(4C) return ld_R_R<C,H,0>();
+	MAIN(4D) return ld_R_R<C,L,0>();
+	MAIN(4F) return ld_R_R<C,A,0>();
+	MAIN(50) return ld_R_R<D,B,0>();
+	MAIN(51) return ld_R_R<D,C,0>();
+	MAIN(52) return nop();
+	MAIN(53) return ld_R_R<D,E,0>();
+	MAIN(54) return ld_R_R<D,H,0>();
+	MAIN(55) return ld_R_R<D,L,0>();
+	MAIN(57) return ld_R_R<D,A,0>();
+	MAIN(58) return ld_R_R<E,B,0>();
+	MAIN(59) return ld_R_R<E,C,0>();
+	MAIN(5A) return ld_R_R<E,D,0>();
+	MAIN(5B) return nop();
+	MAIN(5C) return ld_R_R<E,H,0>();
+	MAIN(5D) return ld_R_R<E,L,0>();
+	MAIN(5F) return ld_R_R<E,A,0>();
+	MAIN(60) return ld_R_R<H,B,0>();
+	MAIN(61) return ld_R_R<H,C,0>();
+	MAIN(62) return ld_R_R<H,D,0>();
+	MAIN(63) return ld_R_R<H,E,0>();
+	MAIN(64) return nop();
+	MAIN(65) return ld_R_R<H,L,0>();
+	MAIN(67) return ld_R_R<H,A,0>();
+	MAIN(68) return ld_R_R<L,B,0>();
+	MAIN(69) return ld_R_R<L,C,0>();
+	MAIN(6A) return ld_R_R<L,D,0>();
+	MAIN(6B) return ld_R_R<L,E,0>();
+	MAIN(6C) return ld_R_R<L,H,0>();
+	MAIN(6D) return nop();
+	MAIN(6F) return ld_R_R<L,A,0>();
+	MAIN(78) return ld_R_R<A,B,0>();
+	MAIN(79) return ld_R_R<A,C,0>();
+	MAIN(7A) return ld_R_R<A,D,0>();
+	MAIN(7B) return ld_R_R<A,E,0>();
+	MAIN(7C) return ld_R_R<A,H,0>();
+	MAIN(7D) return ld_R_R<A,L,0>();
+	MAIN(7F) return nop();
+	MAIN(80) return add_a_R<B,0>();
+	MAIN(81) return add_a_R<C,0>();
+	MAIN(82) return add_a_R<D,0>();
+	MAIN(83) return add_a_R<E,0>();
+	MAIN(84) return add_a_R<H,0>();
+	MAIN(85) return add_a_R<L,0>();
+	MAIN(87) return add_a_a();
+	MAIN(88) return adc_a_R<B,0>();
+	MAIN(89) return adc_a_R<C,0>();
+	MAIN(8A) return adc_a_R<D,0>();
+	MAIN(8B) return adc_a_R<E,0>();
+	MAIN(8C) return adc_a_R<H,0>();
+	MAIN(8D) return adc_a_R<L,0>();
+	MAIN(8F) return adc_a_a();
+	MAIN(90) return sub_R<B,0>();
+	MAIN(91) return sub_R<C,0>();
+	MAIN(92) return sub_R<D,0>();
+	MAIN(93) return sub_R<E,0>();
+	MAIN(94) return sub_R<H,0>();
+	MAIN(95) return sub_R<L,0>();
+	MAIN(97) return sub_a();
+	MAIN(98) return sbc_a_R<B,0>();
+	MAIN(99) return sbc_a_R<C,0>();
+	MAIN(9A) return sbc_a_R<D,0>();
+	MAIN(9B) return sbc_a_R<E,0>();
+	MAIN(9C) return sbc_a_R<H,0>();
+	MAIN(9D) return sbc_a_R<L,0>();
+	MAIN(9F) return sbc_a_a();
+	MAIN(A0) return and_R<B,0>();
+	MAIN(A1) return and_R<C,0>();
+	MAIN(A2) return and_R<D,0>();
+	MAIN(A3) return and_R<E,0>();
+	MAIN(A4) return and_R<H,0>();
+	MAIN(A5) return and_R<L,0>();
+	MAIN(A7) return and_a();
+	MAIN(A8) return xor_R<B,0>();
+	MAIN(A9) return xor_R<C,0>();
+	MAIN(AA) return xor_R<D,0>();
+	MAIN(AB) return xor_R<E,0>();
+	MAIN(AC) return xor_R<H,0>();
+	MAIN(AD) return xor_R<L,0>();
+	MAIN(AF) return xor_a();
+	MAIN(B0) return or_R<B,0>();
+	MAIN(B1) return or_R<C,0>();
+	MAIN(B2) return or_R<D,0>();
+	MAIN(B3) return or_R<E,0>();
+	MAIN(B4) return or_R<H,0>();
+	MAIN(B5) return or_R<L,0>();
+	MAIN(B7) return or_a();
+	MAIN(B8) return cp_R<B,0>();
+	MAIN(B9) return cp_R<C,0>();
+	MAIN(BA) return cp_R<D,0>();
+	MAIN(BB) return cp_R<E,0>();
+	MAIN(BC) return cp_R<H,0>();
+	MAIN(BD) return cp_R<L,0>();
+	MAIN(BF) return cp_a();
+	MAIN(C6) return add_a_byte();
+	MAIN(CE) return adc_a_byte();
+	MAIN(D6) return sub_byte();
+	MAIN(D9) return exx();
+	MAIN(DE) return sbc_a_byte();
+	MAIN(E6) return and_byte();
+	MAIN(EB) return ex_de_hl();
+	MAIN(EE) return xor_byte();
+	MAIN(F6) return or_byte();
+	MAIN(F9) return ld_sp_SS<HL,0>();
+	MAIN(FE) return cp_byte();
+
+	CB(00) return rlc_R<B>();
+	CB(01) return rlc_R<C>();
+	CB(02) return rlc_R<D>();
+	CB(03) return rlc_R<E>();
+	CB(04) return rlc_R<H>();
+	CB(05) return rlc_R<L>();
+	CB(07) return rlc_R<A>();
+	CB(08) return rrc_R<B>();
+	CB(09) return rrc_R<C>();
+	CB(0A) return rrc_R<D>();
+	CB(0B) return rrc_R<E>();
+	CB(0C) return rrc_R<H>();
+	CB(0D) return rrc_R<L>();
+	CB(0F) return rrc_R<A>();
+	CB(10) return rl_R<B>();
+	CB(11) return rl_R<C>();
+	CB(12) return rl_R<D>();
+	CB(13) return rl_R<E>();
+	CB(14) return rl_R<H>();
+	CB(15) return rl_R<L>();
+	CB(17) return rl_R<A>();
+	CB(18) return rr_R<B>();
+	CB(19) return rr_R<C>();
+	CB(1A) return rr_R<D>();
+	CB(1B) return rr_R<E>();
+	CB(1C) return rr_R<H>();
+	CB(1D) return rr_R<L>();
+	CB(1F) return rr_R<A>();
+	CB(20) return sla_R<B>();
+	CB(21) return sla_R<C>();
+	CB(22) return sla_R<D>();
+	CB(23) return sla_R<E>();
+	CB(24) return sla_R<H>();
+	CB(25) return sla_R<L>();
+	CB(27) return sla_R<A>();
+	CB(28) return sra_R<B>();
+	CB(29) return sra_R<C>();
+	CB(2A) return sra_R<D>();
+	CB(2B) return sra_R<E>();
+	CB(2C) return sra_R<H>();
+	CB(2D) return sra_R<L>();
+	CB(2F) return sra_R<A>();
+	CB(30) return T::isR800() ? sla_R<B>() : sll_R<B>();
+	CB(31) return T::isR800() ? sla_R<C>() : sll_R<C>();
+	CB(32) return T::isR800() ? sla_R<D>() : sll_R<D>();
+	CB(33) return T::isR800() ? sla_R<E>() : sll_R<E>();
+	CB(34) return T::isR800() ? sla_R<H>() : sll_R<H>();
+	CB(35) return T::isR800() ? sla_R<L>() : sll_R<L>();
+	CB(37) return T::isR800() ? sla_R<A>() : sll_R<A>();
+	CB(38) return srl_R<B>();
+	CB(39) return srl_R<C>();
+	CB(3A) return srl_R<D>();
+	CB(3B) return srl_R<E>();
+	CB(3C) return srl_R<H>();
+	CB(3D) return srl_R<L>();
+	CB(3F) return srl_R<A>();
+	CB(40) return bit_N_R<0,B>();
+	CB(41) return bit_N_R<0,C>();
+	CB(42) return bit_N_R<0,D>();
+	CB(43) return bit_N_R<0,E>();
+	CB(44) return bit_N_R<0,H>();
+	CB(45) return bit_N_R<0,L>();
+	CB(47) return bit_N_R<0,A>();
+	CB(48) return bit_N_R<1,B>();
+	CB(49) return bit_N_R<1,C>();
+	CB(4A) return bit_N_R<1,D>();
+	CB(4B) return bit_N_R<1,E>();
+	CB(4C) return bit_N_R<1,H>();
+	CB(4D) return bit_N_R<1,L>();
+	CB(4F) return bit_N_R<1,A>();
+	CB(50) return bit_N_R<2,B>();
+	CB(51) return bit_N_R<2,C>();
+	CB(52) return bit_N_R<2,D>();
+	CB(53) return bit_N_R<2,E>();
+	CB(54) return bit_N_R<2,H>();
+	CB(55) return bit_N_R<2,L>();
+	CB(57) return bit_N_R<2,A>();
+	CB(58) return bit_N_R<3,B>();
+	CB(59) return bit_N_R<3,C>();
+	CB(5A) return bit_N_R<3,D>();
+	CB(5B) return bit_N_R<3,E>();
+	CB(5C) return bit_N_R<3,H>();
+	CB(5D) return bit_N_R<3,L>();
+	CB(5F) return bit_N_R<3,A>();
+	CB(60) return bit_N_R<4,B>();
+	CB(61) return bit_N_R<4,C>();
+	CB(62) return bit_N_R<4,D>();
+	CB(63) return bit_N_R<4,E>();
+	CB(64) return bit_N_R<4,H>();
+	CB(65) return bit_N_R<4,L>();
+	CB(67) return bit_N_R<4,A>();
+	CB(68) return bit_N_R<5,B>();
+	CB(69) return bit_N_R<5,C>();
+	CB(6A) return bit_N_R<5,D>();
+	CB(6B) return bit_N_R<5,E>();
+	CB(6C) return bit_N_R<5,H>();
+	CB(6D) return bit_N_R<5,L>();
+	CB(6F) return bit_N_R<5,A>();
+	CB(70) return bit_N_R<6,B>();
+	CB(71) return bit_N_R<6,C>();
+	CB(72) return bit_N_R<6,D>();
+	CB(73) return bit_N_R<6,E>();
+	CB(74) return bit_N_R<6,H>();
+	CB(75) return bit_N_R<6,L>();
+	CB(77) return bit_N_R<6,A>();
+	CB(78) return bit_N_R<7,B>();
+	CB(79) return bit_N_R<7,C>();
+	CB(7A) return bit_N_R<7,D>();
+	CB(7B) return bit_N_R<7,E>();
+	CB(7C) return bit_N_R<7,H>();
+	CB(7D) return bit_N_R<7,L>();
+	CB(7F) return bit_N_R<7,A>();
+	CB(80) return res_N_R<0,B>();
+	CB(81) return res_N_R<0,C>();
+	CB(82) return res_N_R<0,D>();
+	CB(83) return res_N_R<0,E>();
+	CB(84) return res_N_R<0,H>();
+	CB(85) return res_N_R<0,L>();
+	CB(87) return res_N_R<0,A>();
+	CB(88) return res_N_R<1,B>();
+	CB(89) return res_N_R<1,C>();
+	CB(8A) return res_N_R<1,D>();
+	CB(8B) return res_N_R<1,E>();
+	CB(8C) return res_N_R<1,H>();
+	CB(8D) return res_N_R<1,L>();
+	CB(8F) return res_N_R<1,A>();
+	CB(90) return res_N_R<2,B>();
+	CB(91) return res_N_R<2,C>();
+	CB(92) return res_N_R<2,D>();
+	CB(93) return res_N_R<2,E>();
+	CB(94) return res_N_R<2,H>();
+	CB(95) return res_N_R<2,L>();
+	CB(97) return res_N_R<2,A>();
+	CB(98) return res_N_R<3,B>();
+	CB(99) return res_N_R<3,C>();
+	CB(9A) return res_N_R<3,D>();
+	CB(9B) return res_N_R<3,E>();
+	CB(9C) return res_N_R<3,H>();
+	CB(9D) return res_N_R<3,L>();
+	CB(9F) return res_N_R<3,A>();
+	CB(A0) return res_N_R<4,B>();
+	CB(A1) return res_N_R<4,C>();
+	CB(A2) return res_N_R<4,D>();
+	CB(A3) return res_N_R<4,E>();
+	CB(A4) return res_N_R<4,H>();
+	CB(A5) return res_N_R<4,L>();
+	CB(A7) return res_N_R<4,A>();
+	CB(A8) return res_N_R<5,B>();
+	CB(A9) return res_N_R<5,C>();
+	CB(AA) return res_N_R<5,D>();
+	CB(AB) return res_N_R<5,E>();
+	CB(AC) return res_N_R<5,H>();
+	CB(AD) return res_N_R<5,L>();
+	CB(AF) return res_N_R<5,A>();
+	CB(B0) return res_N_R<6,B>();
+	CB(B1) return res_N_R<6,C>();
+	CB(B2) return res_N_R<6,D>();
+	CB(B3) return res_N_R<6,E>();
+	CB(B4) return res_N_R<6,H>();
+	CB(B5) return res_N_R<6,L>();
+	CB(B7) return res_N_R<6,A>();
+	CB(B8) return res_N_R<7,B>();
+	CB(B9) return res_N_R<7,C>();
+	CB(BA) return res_N_R<7,D>();
+	CB(BB) return res_N_R<7,E>();
+	CB(BC) return res_N_R<7,H>();
+	CB(BD) return res_N_R<7,L>();
+	CB(BF) return res_N_R<7,A>();
+	CB(C0) return set_N_R<0,B>();
+	CB(C1) return set_N_R<0,C>();
+	CB(C2) return set_N_R<0,D>();
+	CB(C3) return set_N_R<0,E>();
+	CB(C4) return set_N_R<0,H>();
+	CB(C5) return set_N_R<0,L>();
+	CB(C7) return set_N_R<0,A>();
+	CB(C8) return set_N_R<1,B>();
+	CB(C9) return set_N_R<1,C>();
+	CB(CA) return set_N_R<1,D>();
+	CB(CB) return set_N_R<1,E>();
+	CB(CC) return set_N_R<1,H>();
+	CB(CD) return set_N_R<1,L>();
+	CB(CF) return set_N_R<1,A>();
+	CB(D0) return set_N_R<2,B>();
+	CB(D1) return set_N_R<2,C>();
+	CB(D2) return set_N_R<2,D>();
+	CB(D3) return set_N_R<2,E>();
+	CB(D4) return set_N_R<2,H>();
+	CB(D5) return set_N_R<2,L>();
+	CB(D7) return set_N_R<2,A>();
+	CB(D8) return set_N_R<3,B>();
+	CB(D9) return set_N_R<3,C>();
+	CB(DA) return set_N_R<3,D>();
+	CB(DB) return set_N_R<3,E>();
+	CB(DC) return set_N_R<3,H>();
+	CB(DD) return set_N_R<3,L>();
+	CB(DF) return set_N_R<3,A>();
+	CB(E0) return set_N_R<4,B>();
+	CB(E1) return set_N_R<4,C>();
+	CB(E2) return set_N_R<4,D>();
+	CB(E3) return set_N_R<4,E>();
+	CB(E4) return set_N_R<4,H>();
+	CB(E5) return set_N_R<4,L>();
+	CB(E7) return set_N_R<4,A>();
+	CB(E8) return set_N_R<5,B>();
+	CB(E9) return set_N_R<5,C>();
+	CB(EA) return set_N_R<5,D>();
+	CB(EB) return set_N_R<5,E>();
+	CB(EC) return set_N_R<5,H>();
+	CB(ED) return set_N_R<5,L>();
+	CB(EF) return set_N_R<5,A>();
+	CB(F0) return set_N_R<6,B>();
+	CB(F1) return set_N_R<6,C>();
+	CB(F2) return set_N_R<6,D>();
+	CB(F3) return set_N_R<6,E>();
+	CB(F4) return set_N_R<6,H>();
+	CB(F5) return set_N_R<6,L>();
+	CB(F7) return set_N_R<6,A>();
+	CB(F8) return set_N_R<7,B>();
+	CB(F9) return set_N_R<7,C>();
+	CB(FA) return set_N_R<7,D>();
+	CB(FB) return set_N_R<7,E>();
+	CB(FC) return set_N_R<7,H>();
+	CB(FD) return set_N_R<7,L>();
+	CB(FF) return set_N_R<7,A>();
+
+	ED(42) return sbc_hl_SS<BC>();
+	ED(44) return neg();
+	ED(4A) return adc_hl_SS<BC>();
+	ED(4C) return neg();
+	ED(52) return sbc_hl_SS<DE>();
+	ED(54) return neg();
+	ED(5A) return adc_hl_SS<DE>();
+	ED(5C) return neg();
+	ED(62) return sbc_hl_hl();
+	ED(64) return neg();
+	ED(6A) return adc_hl_hl();
+	ED(6C) return neg();
+	ED(72) return sbc_hl_SS<SP>();
+	ED(74) return neg();
+	ED(7A) return adc_hl_SS<SP>();
+	ED(7C) return neg();
+
+	DD(09) return add_SS_TT<IX,BC,T::CC_DD>();
+	DD(19) return add_SS_TT<IX,DE,T::CC_DD>();
+	DD(21) return ld_SS_word<IX,T::CC_DD>();
+	DD(23) return inc_SS<IX,T::CC_DD>();
+	DD(24) return inc_R<IXH,T::CC_DD>();
+	DD(25) return dec_R<IXH,T::CC_DD>();
+	DD(26) return ld_R_byte<IXH,T::CC_DD>();
+	DD(29) return add_SS_SS<IX,T::CC_DD>();
+	DD(2B) return dec_SS<IX,T::CC_DD>();
+	DD(2C) return inc_R<IXL,T::CC_DD>();
+	DD(2D) return dec_R<IXL,T::CC_DD>();
+	DD(2E) return ld_R_byte<IXL,T::CC_DD>();
+	DD(39) return add_SS_TT<IX,SP,T::CC_DD>();
+	DD(44) return ld_R_R<B,IXH,T::CC_DD>();
+	DD(45) return ld_R_R<B,IXL,T::CC_DD>();
+	DD(4C) return ld_R_R<C,IXH,T::CC_DD>();
+	DD(4D) return ld_R_R<C,IXL,T::CC_DD>();
+	DD(54) return ld_R_R<D,IXH,T::CC_DD>();
+	DD(55) return ld_R_R<D,IXL,T::CC_DD>();
+	DD(5C) return ld_R_R<E,IXH,T::CC_DD>();
+	DD(5D) return ld_R_R<E,IXL,T::CC_DD>();
+	DD(60) return ld_R_R<IXH,B,T::CC_DD>();
+	DD(61) return ld_R_R<IXH,C,T::CC_DD>();
+	DD(62) return ld_R_R<IXH,D,T::CC_DD>();
+	DD(63) return ld_R_R<IXH,E,T::CC_DD>();
+	DD(65) return ld_R_R<IXH,IXL,T::CC_DD>();
+	DD(67) return ld_R_R<IXH,A,T::CC_DD>();
+	DD(68) return ld_R_R<IXL,B,T::CC_DD>();
+	DD(69) return ld_R_R<IXL,C,T::CC_DD>();
+	DD(6A) return ld_R_R<IXL,D,T::CC_DD>();
+	DD(6B) return ld_R_R<IXL,E,T::CC_DD>();
+	DD(6C) return ld_R_R<IXL,IXH,T::CC_DD>();
+	DD(6F) return ld_R_R<IXL,A,T::CC_DD>();
+	DD(7C) return ld_R_R<A,IXH,T::CC_DD>();
+	DD(7D) return ld_R_R<A,IXL,T::CC_DD>();
+	DD(84) return add_a_R<IXH,T::CC_DD>();
+	DD(85) return add_a_R<IXL,T::CC_DD>();
+	DD(8C) return adc_a_R<IXH,T::CC_DD>();
+	DD(8D) return adc_a_R<IXL,T::CC_DD>();
+	DD(94) return sub_R<IXH,T::CC_DD>();
+	DD(95) return sub_R<IXL,T::CC_DD>();
+	DD(9C) return sbc_a_R<IXH,T::CC_DD>();
+	DD(9D) return sbc_a_R<IXL,T::CC_DD>();
+	DD(A4) return and_R<IXH,T::CC_DD>();
+	DD(A5) return and_R<IXL,T::CC_DD>();
+	DD(AC) return xor_R<IXH,T::CC_DD>();
+	DD(AD) return xor_R<IXL,T::CC_DD>();
+	DD(B4) return or_R<IXH,T::CC_DD>();
+	DD(B5) return or_R<IXL,T::CC_DD>();
+	DD(BC) return cp_R<IXH,T::CC_DD>();
+	DD(BD) return cp_R<IXL,T::CC_DD>();
+	DD(F9) return ld_sp_SS<IX,T::CC_DD>();
+
+	FD(09) return add_SS_TT<IY,BC,T::CC_DD>();
+	FD(19) return add_SS_TT<IY,DE,T::CC_DD>();
+	FD(21) return ld_SS_word<IY,T::CC_DD>();
+	FD(23) return inc_SS<IY,T::CC_DD>();
+	FD(24) return inc_R<IYH,T::CC_DD>();
+	FD(25) return dec_R<IYH,T::CC_DD>();
+	FD(26) return ld_R_byte<IYH,T::CC_DD>();
+	FD(29) return add_SS_SS<IY,T::CC_DD>();
+	FD(2B) return dec_SS<IY,T::CC_DD>();
+	FD(2C) return inc_R<IYL,T::CC_DD>();
+	FD(2D) return dec_R<IYL,T::CC_DD>();
+	FD(2E) return ld_R_byte<IYL,T::CC_DD>();
+	FD(39) return add_SS_TT<IY,SP,T::CC_DD>();
+	FD(44) return ld_R_R<B,IYH,T::CC_DD>();
+	FD(45) return ld_R_R<B,IYL,T::CC_DD>();
+	FD(4C) return ld_R_R<C,IYH,T::CC_DD>();
+	FD(4D) return ld_R_R<C,IYL,T::CC_DD>();
+	FD(54) return ld_R_R<D,IYH,T::CC_DD>();
+	FD(55) return ld_R_R<D,IYL,T::CC_DD>();
+	FD(5C) return ld_R_R<E,IYH,T::CC_DD>();
+	FD(5D) return ld_R_R<E,IYL,T::CC_DD>();
+	FD(60) return ld_R_R<IYH,B,T::CC_DD>();
+	FD(61) return ld_R_R<IYH,C,T::CC_DD>();
+	FD(62) return ld_R_R<IYH,D,T::CC_DD>();
+	FD(63) return ld_R_R<IYH,E,T::CC_DD>();
+	FD(65) return ld_R_R<IYH,IYL,T::CC_DD>();
+	FD(67) return ld_R_R<IYH,A,T::CC_DD>();
+	FD(68) return ld_R_R<IYL,B,T::CC_DD>();
+	FD(69) return ld_R_R<IYL,C,T::CC_DD>();
+	FD(6A) return ld_R_R<IYL,D,T::CC_DD>();
+	FD(6B) return ld_R_R<IYL,E,T::CC_DD>();
+	FD(6C) return ld_R_R<IYL,IYH,T::CC_DD>();
+	FD(6F) return ld_R_R<IYL,A,T::CC_DD>();
+	FD(7C) return ld_R_R<A,IYH,T::CC_DD>();
+	FD(7D) return ld_R_R<A,IYL,T::CC_DD>();
+	FD(84) return add_a_R<IYH,T::CC_DD>();
+	FD(85) return add_a_R<IYL,T::CC_DD>();
+	FD(8C) return adc_a_R<IYH,T::CC_DD>();
+	FD(8D) return adc_a_R<IYL,T::CC_DD>();
+	FD(94) return sub_R<IYH,T::CC_DD>();
+	FD(95) return sub_R<IYL,T::CC_DD>();
+	FD(9C) return sbc_a_R<IYH,T::CC_DD>();
+	FD(9D) return sbc_a_R<IYL,T::CC_DD>();
+	FD(A4) return and_R<IYH,T::CC_DD>();
+	FD(A5) return and_R<IYL,T::CC_DD>();
+	FD(AC) return xor_R<IYH,T::CC_DD>();
+	FD(AD) return xor_R<IYL,T::CC_DD>();
+	FD(B4) return or_R<IYH,T::CC_DD>();
+	FD(B5) return or_R<IYL,T::CC_DD>();
+	FD(BC) return cp_R<IYH,T::CC_DD>();
+	FD(BD) return cp_R<IYL,T::CC_DD>();
+	FD(F9) return ld_sp_SS<IY,T::CC_DD>();
+	default: UNREACHABLE; return 0;
+	}
+#undef MAIN
+#undef CB
+#undef ED
+#undef DD
+#undef FD
+}
+
 template<class T> void CPUCore<T>::setSlowInstructions()
 {
 	slowInstructions = 2;
@@ -549,8 +1507,15 @@ template<class T> void CPUCore<T>::update(const Setting& setting)
 		doSetFreq();
 	} else if (&setting == &freqValue) {
 		doSetFreq();
-	} else if (&setting == &traceSetting) {
-		tracingEnabled = traceSetting.getBoolean();
+	} else if ((&setting == &traceSetting) ||
+	           (&setting == &traceBuffer.getSizeSetting())) {
+		printTrace = traceSetting.getBoolean();
+		recordTrace = traceBuffer.getSizeSetting().getInt() != 0;
+	} else if (&setting == &blockCacheSetting) {
+		useBlockCache = !T::isR800() && blockCacheSetting.getBoolean();
+		if (useBlockCache && blockLines.empty()) {
+			blockLines.resize(CacheLine::NUM);
+		}
 	}
 }
 
@@ -594,7 +1559,8 @@ NEVER_INLINE byte CPUCore<T>::RDMEMslow(unsigned address, unsigned cc)
 {
 	// not cached
 	unsigned high = address >> CacheLine::BITS;
-	if (!readCacheTried[high]) {
+	if (!readCacheTried[high] &&
+	    !MSXCPUInterface::isBreakPointLine(high)) {
 		// try to cache now
 		unsigned addrBase = address & CacheLine::HIGH;
 		if (const byte* line = interface->getReadCacheLine(addrBase)) {
@@ -604,9 +1570,20 @@ NEVER_INLINE byte CPUCore<T>::RDMEMslow(unsigned address, unsigned cc)
 			readCacheLine[high] = line - addrBase;
 			return readCacheLine[high][address];
 		}
+		// Only uncacheable because of a watchpoint? Then we can still
+		// bypass the device for the non-watched bytes in this line.
+		if (const byte* line = interface->getWatchedReadCacheLine(addrBase)) {
+			readWatchedLine[high] = line - addrBase;
+		}
 	}
-	// uncacheable
 	readCacheTried[high] = true;
+	if (readWatchedLine[high] && !interface->isReadWatched(address)) {
+		T::template PRE_MEM<PRE_PB, POST_PB>(address);
+		T::template POST_MEM<       POST_PB>(address);
+		return readWatchedLine[high][address];
+	}
+	// uncacheable
+	++uncachedReads;
 	T::template PRE_MEM<PRE_PB, POST_PB>(address);
 	EmuTime time = T::getTimeFast(cc);
 	scheduler.schedule(time);
@@ -701,9 +1678,19 @@ NEVER_INLINE void CPUCore<T>::WRMEMslow(unsigned address, byte value, unsigned c
 			writeCacheLine[high][address] = value;
 			return;
 		}
+		// see RDMEMslow()
+		if (byte* line = interface->getWatchedWriteCacheLine(addrBase)) {
+			writeWatchedLine[high] = line - addrBase;
+		}
 	}
-	// uncacheable
 	writeCacheTried[high] = true;
+	if (writeWatchedLine[high] && !interface->isWriteWatched(address)) {
+		T::template PRE_MEM<PRE_PB, POST_PB>(address);
+		T::template POST_MEM<       POST_PB>(address);
+		writeWatchedLine[high][address] = value;
+		return;
+	}
+	// uncacheable
 	T::template PRE_MEM<PRE_PB, POST_PB>(address);
 	EmuTime time = T::getTimeFast(cc);
 	scheduler.schedule(time);
@@ -850,6 +1837,9 @@ template<class T>
 void CPUCore<T>::executeInstructions()
 {
 	checkNoCurrentFlags();
+	if (unlikely(recordTrace)) {
+		cpuTraceFetch();
+	}
 #ifdef USE_COMPUTED_GOTO
 	// Addresses of all main-opcode routines,
 	// Note that 40/49/53/5B/64/6D/7F is replaced by 00 (ld r,r == nop)
@@ -892,12 +1882,14 @@ void CPUCore<T>::executeInstructions()
 // fetch and execute next instruction.
 #define NEXT \
 	T::add(c); \
+	cpuTraceRecord(); \
 	T::R800Refresh(*this); \
 	if (likely(!T::limitReached())) { \
-		incR(1); \
+		if (!T::isR800() && unlikely(useBlockCache)) goto start; \
 		unsigned address = getPC(); \
 		const byte* line = readCacheLine[address >> CacheLine::BITS]; \
 		if (likely(line != nullptr)) { \
+			incR(1); \
 			setPC(address + 1); \
 			T::template PRE_MEM<false, false>(address); \
 			T::template POST_MEM<      false>(address); \
@@ -912,12 +1904,14 @@ void CPUCore<T>::executeInstructions()
 // After some instructions we must always exit the CPU loop (ei, halt, retn)
 #define NEXT_STOP \
 	T::add(c); \
+	cpuTraceRecord(); \
 	T::R800Refresh(*this); \
 	assert(T::limitReached()); \
 	return;
 
 #define NEXT_EI \
 	T::add(c); \
+	cpuTraceRecord(); \
 	/* !! NO T::R800Refresh(*this); !! */ \
 	assert(T::limitReached()); \
 	return;
@@ -929,20 +1923,23 @@ void CPUCore<T>::executeInstructions()
 
 #define NEXT \
 	T::add(c); \
+	cpuTraceRecord(); \
 	T::R800Refresh(*this); \
-	if (likely(!T::limitReached())) { \
+	if (likely(!T::limitReached()) && likely(!isBreakLine(getPC()))) { \
 		goto start; \
 	} \
 	return;
 
 #define NEXT_STOP \
 	T::add(c); \
+	cpuTraceRecord(); \
 	T::R800Refresh(*this); \
 	assert(T::limitReached()); \
 	return;
 
 #define NEXT_EI \
 	T::add(c); \
+	cpuTraceRecord(); \
 	/* !! NO T::R800Refresh(*this); !! */ \
 	assert(T::limitReached()); \
 	return;
@@ -951,9 +1948,11 @@ void CPUCore<T>::executeInstructions()
 
 #endif // USE_COMPUTED_GOTO
 
-#ifndef USE_COMPUTED_GOTO
 start:
-#endif
+	if (!T::isR800() && unlikely(useBlockCache) && executeBlock()) {
+		// the next instruction can be in a different cache line
+		if (T::limitReached() || isBreakLine(getPC())) return;
+	}
 	unsigned ixy; // for dd_cb/fd_cb
 	byte opcodeMain = RDMEM_OPCODE(T::CC_MAIN);
 	incR(1);
@@ -962,6 +1961,8 @@ start:
 
 fetchSlow: {
 	unsigned address = getPC();
+	if (unlikely(isBreakLine(address))) return;
+	incR(1);
 	setPC(address + 1);
 	byte opcodeSlow = RDMEMslow<false, false>(address, T::CC_MAIN);
 	goto *(opcodeTable[opcodeSlow]);
@@ -2437,7 +3438,7 @@ template<class T> inline void CPUCore<T>::cpuTracePre()
 }
 template<class T> inline void CPUCore<T>::cpuTracePost()
 {
-	if (unlikely(tracingEnabled)) {
+	if (unlikely(printTrace)) {
 		cpuTracePost_slow();
 	}
 }
@@ -2458,6 +3459,31 @@ template<class T> void CPUCore<T>::cpuTracePost_slow()
 	     << std::endl << std::dec;
 }
 
+template<class T> inline void CPUCore<T>::cpuTraceRecord()
+{
+	if (unlikely(recordTrace)) {
+		cpuTraceRecord_slow();
+	}
+}
+template<class T> void CPUCore<T>::cpuTraceRecord_slow()
+{
+	traceBuffer.record(*this, recordPc, recordOpcode, T::isR800(),
+	                   *interface, T::getTimeFast());
+	cpuTraceFetch(); // start of the next instruction
+}
+template<class T> void CPUCore<T>::cpuTraceFetch()
+{
+	// Take the opcode from the read cache when possible, that's a lot
+	// cheaper than peekMem().
+	recordPc = getPC();
+	for (unsigned i = 0; i < 4; ++i) {
+		unsigned address = (recordPc + i) & 0xFFFF;
+		const byte* line = readCacheLine[address >> CacheLine::BITS];
+		recordOpcode[i] = line ? line[address]
+		                       : interface->peekMem(address, T::getTimeFast());
+	}
+}
+
 template<class T> void CPUCore<T>::executeSlow()
 {
 	if (unlikely(false && nmiEdge)) {
@@ -2548,7 +3574,13 @@ template<class T> void CPUCore<T>::execute2(bool fastForward)
 	scheduler.schedule(T::getTime());
 	setSlowInstructions();
 
-	if (!fastForward && (interface->isContinue() || interface->isStep())) {
+	// Breakpoints, conditions and the break state are shared by all
+	// machines. Only the active machine checks them (other machines only
+	// execute when 'run_all_machines' is enabled).
+	bool active = motherboard.isActive();
+
+	if (!fastForward && active &&
+	    (interface->isContinue() || interface->isStep())) {
 		// at least one instruction
 		interface->setContinue(false);
 		executeSlow();
@@ -2561,11 +3593,13 @@ template<class T> void CPUCore<T>::execute2(bool fastForward)
 		}
 	}
 
+	syncBreakLines();
+
 	// Note: we call scheduler _after_ executing the instruction and before
 	// deciding between executeFast() and executeSlow() (because a
 	// SyncPoint could set an IRQ and then we must choose executeSlow())
 	if (fastForward ||
-	    (!interface->anyBreakPoints() && !tracingEnabled)) {
+	    ((!interface->anyBreakPoints() || !active) && !printTrace)) {
 		// fast path, no breakpoints, no tracing
 		while (!needExitCPULoop()) {
 			if (slowInstructions) {
@@ -2577,6 +3611,7 @@ template<class T> void CPUCore<T>::execute2(bool fastForward)
 					T::enableLimit(); // does CPUClock::sync()
 					if (likely(!T::limitReached())) {
 						// multiple instructions
+						resetPollingLoop();
 						executeInstructions();
 						// note: pipeline only shifted one
 						// step for multiple instructions
@@ -2587,12 +3622,43 @@ template<class T> void CPUCore<T>::execute2(bool fastForward)
 				}
 			}
 		}
-	} else {
+	} else if (!interface->anyConditions() && !printTrace) {
+		// Only breakpoints, no conditions. Each breakpoint is tied to a
+		// single address, so only the instructions fetched from a cache
+		// line that contains a breakpoint need to be checked. Those
+		// lines are never cached, so executeInstructions() can run
+		// multiple instructions and only needs to test for a
+		// breakpoint line on the (already slow) uncached fetch path.
+		checkBreakLines = true;
 		while (!needExitCPULoop()) {
+			syncBreakLines(); // a Tcl callback could have changed them
 			if (interface->checkBreakPoints(getPC(), motherboard)) {
 				assert(interface->isBreaked());
 				break;
 			}
+			if (slowInstructions) {
+				--slowInstructions;
+				executeSlow();
+			} else {
+				T::enableLimit(); // does CPUClock::sync()
+				if (likely(!T::limitReached())) {
+					// multiple instructions, stops early
+					// in front of a breakpoint line
+					resetPollingLoop();
+					executeInstructions();
+					endInstruction();
+				}
+			}
+			scheduler.schedule(T::getTime());
+		}
+		checkBreakLines = false;
+	} else {
+		while (!needExitCPULoop()) {
+			if (active &&
+			    interface->checkBreakPoints(getPC(), motherboard)) {
+				assert(interface->isBreaked());
+				break;
+			}
 			if (slowInstructions == 0) {
 				cpuTracePre();
 				assert(T::limitReached()); // only one instruction
@@ -3894,8 +4960,10 @@ template<class T> template<typename COND> int CPUCore<T>::jp(COND cond) {
 	unsigned addr = RD_WORD_PC(T::CC_JP_1);
 	T::setMemPtr(addr);
 	if (cond(getF())) {
+		unsigned end = getPC();
 		setPC(addr);
 		T::R800ForcePageBreak();
+		if (addr < end) backwardBranch(end);
 		return T::CC_JP_A;
 	} else {
 		return T::CC_JP_B;
@@ -3936,8 +5004,10 @@ template<class T> template<typename COND> int CPUCore<T>::jr(COND cond) {
 			// See doc/r800-djnz.txt for more details.
 			T::R800ForcePageBreak();
 		}
-		setPC((getPC() + ofst) & 0xFFFF);
+		unsigned end = getPC();
+		setPC((end + ofst) & 0xFFFF);
 		T::setMemPtr(getPC());
+		if (ofst < 0) backwardBranch(end);
 		return T::CC_JR_A;
 	} else {
 		return T::CC_JR_B;
@@ -13,10 +13,12 @@
 #include <atomic>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace openmsx {
 
 class MSXCPUInterface;
+class CPUTraceBuffer;
 class Scheduler;
 class MSXMotherBoard;
 class TclCallback;
@@ -33,6 +35,8 @@ class CPUCore final : public CPUBase, public CPURegs, public CPU_POLICY
 public:
 	CPUCore(MSXMotherBoard& motherboard, const std::string& name,
 	        const BooleanSetting& traceSetting,
+	        const BooleanSetting& blockCacheSetting,
+	        CPUTraceBuffer& traceBuffer,
 	        TclCallback& diHaltCallback, EmuTime::param time);
 
 	void setInterface(MSXCPUInterface* interf) { interface = interf; }
@@ -62,6 +66,7 @@ public:
 	EmuTime waitCycles(EmuTime::param time, unsigned cycles);
 	void setNextSyncPoint(EmuTime::param time);
 	void invalidateMemCache(unsigned start, unsigned size);
+	void fillReadCache(unsigned start, unsigned size, const byte* data);
 	bool isM1Cycle(unsigned address) const;
 
 	void disasmCommand(Interpreter& interp,
@@ -103,6 +108,18 @@ public:
 private:
 	void execute2(bool fastForward);
 	bool needExitCPULoop();
+	inline bool isBreakLine(unsigned address) const;
+	inline void syncBreakLines();
+	inline void resetPollingLoop();
+	inline void backwardBranch(unsigned branchEnd);
+	void pollingLoop(unsigned branchEnd);
+	bool isPollingLoopBody(unsigned start, unsigned end) const;
+	inline bool executeBlock();
+	struct BlockLine;
+	bool runBlock(BlockLine& blockLine, unsigned address);
+	struct Block;
+	static bool decodeBlock(Block& block, const byte* code, unsigned size);
+	inline int executeBlockInstruction(unsigned op);
 	void setSlowInstructions();
 	void doSetFreq();
 
@@ -114,12 +131,19 @@ private:
 	byte* writeCacheLine[CacheLine::NUM];
 	bool readCacheTried [CacheLine::NUM];
 	bool writeCacheTried[CacheLine::NUM];
+	// Lines that are only uncacheable because they contain a memory
+	// watchpoint. Accesses to the other bytes in such a line don't need
+	// to go via MSXCPUInterface (see RDMEMslow() and WRMEMslow()).
+	const byte* readWatchedLine[CacheLine::NUM];
+	byte* writeWatchedLine[CacheLine::NUM];
 
 	MSXMotherBoard& motherboard;
 	Scheduler& scheduler;
 	MSXCPUInterface* interface;
 
 	const BooleanSetting& traceSetting;
+	const BooleanSetting& blockCacheSetting;
+	CPUTraceBuffer& traceBuffer;
 	TclCallback& diHaltCallback;
 
 	Probe<int> IRQStatus;
@@ -144,7 +168,66 @@ private:
 	std::atomic<bool> exitLoop;
 
 	/** In sync with traceSetting.getBoolean(). */
-	bool tracingEnabled;
+	bool printTrace;
+	/** The trace buffer is enabled (its size is not zero). Unlike
+	  * printTrace this doesn't force execute2() onto the slow path,
+	  * executeInstructions() records each instruction itself, see
+	  * cpuTraceRecord(). */
+	bool recordTrace;
+	/** Address of the instruction that's currently being recorded. */
+	unsigned recordPc;
+	/** Its opcode bytes, read before the instruction executes so that
+	  * self-modifying code is recorded as it was fetched. */
+	byte recordOpcode[4];
+
+	/** When true, executeInstructions() stops before fetching an
+	  * instruction from a cache line that contains a breakpoint, so that
+	  * execute2() can check it. See MSXCPUInterface::isBreakPointLine().
+	  */
+	bool checkBreakLines;
+	/** MSXCPUInterface::getBreakPointLinesVersion() at the time the
+	  * memory cache was last flushed. */
+	unsigned breakLinesVersion;
+
+	/** Polling loop detection, see pollingLoop(). */
+	enum PollingLoopState { LOOP_NEW, LOOP_CANDIDATE, LOOP_REJECTED };
+	struct LoopRegs {
+		unsigned af, bc, de, hl, af2, bc2, de2, hl2, ix, iy, sp, i;
+	};
+	inline LoopRegs getLoopRegs() const;
+	LoopRegs loopRegs;      // registers at the previous iteration (except R)
+	byte loopR;             // R at the previous iteration
+	unsigned loopBranch;    // end address of the last taken backward branch
+	int loopTicks;          // T::getTicksTillLimit() at previous iteration
+	unsigned loopUncached;  // uncachedReads at previous iteration
+	PollingLoopState loopState;
+	/** Number of memory reads that were not served from the cache. */
+	unsigned uncachedReads;
+
+	/** Block cache, see executeBlock(). A block is a run of instructions
+	  * that only use registers and immediate operands. */
+	struct Block {
+		static const unsigned MAX_SIZE = 16;
+		byte code[MAX_SIZE]; // the bytes it was decoded from
+		word ops[MAX_SIZE];  // prefix and opcode, see blockInstruction()
+		byte size;           // number of bytes in 'code'
+		byte num;            // number of instructions in 'ops'
+	};
+	enum { BLOCK_UNKNOWN, BLOCK_NONE, BLOCK_FIRST };
+	struct BlockLine {
+		BlockLine() : line(nullptr) {}
+		/** The readCacheLine[] entry the blocks were decoded from,
+		  * nullptr when invalidated. */
+		const byte* line;
+		/** For each start address BLOCK_UNKNOWN, BLOCK_NONE or
+		  * BLOCK_FIRST + the position in 'blocks'. */
+		byte index[CacheLine::SIZE];
+		std::vector<Block> blocks;
+	};
+	std::vector<BlockLine> blockLines; // one per cache line, or empty
+	/** In sync with blockCacheSetting.getBoolean(), always false on the
+	  * R800. */
+	bool useBlockCache;
 
 	/** 'normal' Z80 and Z80 in a turboR behave slightly different */
 	const bool isTurboR;
@@ -153,6 +236,9 @@ private:
 	inline void cpuTracePre();
 	inline void cpuTracePost();
 	void cpuTracePost_slow();
+	inline void cpuTraceRecord();
+	void cpuTraceRecord_slow();
+	void cpuTraceFetch();
 
 	inline byte READ_PORT(unsigned port, unsigned cc);
 	inline void WRITE_PORT(unsigned port, byte value, unsigned cc);
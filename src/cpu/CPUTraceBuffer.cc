@@ -0,0 +1,269 @@
+#include "CPUTraceBuffer.hh"
+#include "CPURegs.hh"
+#include "MSXCPUInterface.hh"
+#include "Dasm.hh"
+#include "CommandException.hh"
+#include "FileException.hh"
+#include "CommandController.hh"
+#include "CliComm.hh"
+#include "FileOperations.hh"
+#include "FileContext.hh"
+#include "TclObject.hh"
+#include "memory.hh"
+#include "outer.hh"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cassert>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+static_assert(sizeof(CPUTraceBuffer::Record) == 32,
+              "stream file format depends on this");
+
+CPUTraceBuffer::CPUTraceBuffer(CommandController& commandController)
+	: cmd(commandController)
+	, sizeSetting(commandController, "cputrace_buffer_size",
+		"number of executed CPU instructions that are remembered in "
+		"the trace buffer, 0 disables the buffer",
+		0, 0, 50000000)
+	, head(0), count(0), frozen(false)
+{
+	resize(sizeSetting.getInt());
+	sizeSetting.attach(*this);
+}
+
+CPUTraceBuffer::~CPUTraceBuffer()
+{
+	sizeSetting.detach(*this);
+}
+
+void CPUTraceBuffer::update(const Setting& setting)
+{
+	(void)setting;
+	assert(&setting == &sizeSetting);
+	resize(sizeSetting.getInt());
+}
+
+void CPUTraceBuffer::resize(unsigned size)
+{
+	// Keep the most recent records.
+	vector<Record> newBuffer(size);
+	unsigned n = std::min(count, size);
+	for (unsigned i = 0; i < n; ++i) {
+		newBuffer[i] = get(count - n + i);
+	}
+	buffer.swap(newBuffer);
+	count = n;
+	head = size ? (n % size) : 0;
+}
+
+void CPUTraceBuffer::clear()
+{
+	head = 0;
+	count = 0;
+}
+
+const CPUTraceBuffer::Record& CPUTraceBuffer::get(unsigned i) const
+{
+	assert(i < count);
+	auto size = unsigned(buffer.size());
+	unsigned pos = head + size - count + i;
+	if (pos >= size) pos -= size;
+	return buffer[pos];
+}
+
+void CPUTraceBuffer::record(const CPURegs& regs, word startPc,
+                            const byte* opcode, bool isR800,
+                            const MSXCPUInterface& interface,
+                            EmuTime::param time)
+{
+	if (frozen || buffer.empty()) return;
+
+	Record r;
+	r.time = (time - EmuTime::zero).length();
+	r.pc = startPc;
+	r.af = regs.getAF();
+	r.bc = regs.getBC();
+	r.de = regs.getDE();
+	r.hl = regs.getHL();
+	r.ix = regs.getIX();
+	r.iy = regs.getIY();
+	r.sp = regs.getSP();
+	memcpy(r.opcode, opcode, sizeof(r.opcode));
+	int page = startPc >> 14;
+	int ps = interface.getPrimarySlot(page);
+	r.slot = ps | (interface.getSecondarySlot(page) << 2) |
+	         (interface.isExpanded(ps) ? 0x40 : 0) |
+	         (isR800 ? 0x80 : 0);
+	memset(r.pad, 0, sizeof(r.pad));
+
+	buffer[head] = r;
+	if (++head == buffer.size()) head = 0;
+	if (count < buffer.size()) ++count;
+	if (stream) {
+		try {
+			stream->write(&r, sizeof(r));
+		} catch (FileException& e) {
+			// Called from within the CPU emulation loop, so don't
+			// let this propagate.
+			stream.reset();
+			cmd.getCommandController().getCliComm().printWarning(
+				"CPU trace streaming stopped with error: " +
+				e.getMessage());
+		}
+	}
+}
+
+unsigned CPUTraceBuffer::selectCount(array_ref<TclObject> tokens,
+                                     unsigned pos) const
+{
+	if (tokens.size() <= pos) return count;
+	if (tokens.size() != (pos + 1)) throw SyntaxError();
+	int num = tokens[pos].getInt(cmd.getInterpreter());
+	if (num <= 0) {
+		throw CommandException("Count must be positive");
+	}
+	return std::min(unsigned(num), count);
+}
+
+void CPUTraceBuffer::printRecord(std::ostream& os, const Record& r) const
+{
+	// Same format as 'cputrace' (so registers are the values _after_
+	// executing the instruction), but prefixed with time and slot.
+	string dasmOutput;
+	dasm(r.opcode, r.pc, dasmOutput);
+	os << std::fixed << std::setprecision(9)
+	   << EmuDuration(r.time).toDouble() << ' '
+	   << (r.slot & 3);
+	if (r.slot & 0x40) os << '-' << ((r.slot >> 2) & 3);
+	os << ' ' << std::setfill('0') << std::hex << std::setw(4) << r.pc
+	   << " : " << dasmOutput
+	   << " AF=" << std::setw(4) << r.af
+	   << " BC=" << std::setw(4) << r.bc
+	   << " DE=" << std::setw(4) << r.de
+	   << " HL=" << std::setw(4) << r.hl
+	   << " IX=" << std::setw(4) << r.ix
+	   << " IY=" << std::setw(4) << r.iy
+	   << " SP=" << std::setw(4) << r.sp
+	   << std::dec << '\n';
+}
+
+string CPUTraceBuffer::dump(unsigned num) const
+{
+	std::ostringstream os;
+	for (unsigned i = count - num; i < count; ++i) {
+		printRecord(os, get(i));
+	}
+	return os.str();
+}
+
+void CPUTraceBuffer::saveText(string_ref filename, unsigned num) const
+{
+	std::ofstream file;
+	FileOperations::openofstream(file, FileOperations::expandTilde(filename));
+	if (!file.is_open()) {
+		throw CommandException("Couldn't open file: " + filename);
+	}
+	for (unsigned i = count - num; i < count; ++i) {
+		printRecord(file, get(i));
+	}
+	if (file.fail()) {
+		throw CommandException("Error while writing to file: " + filename);
+	}
+}
+
+void CPUTraceBuffer::startStream(string_ref filename)
+{
+	if (buffer.empty()) {
+		throw CommandException(
+			"The trace buffer is disabled, first set "
+			"'cputrace_buffer_size'.");
+	}
+	stream = make_unique<File>(FileOperations::expandTilde(filename),
+	                           File::TRUNCATE);
+}
+
+
+// class Cmd
+
+CPUTraceBuffer::Cmd::Cmd(CommandController& commandController_)
+	: Command(commandController_, "cputrace_buffer")
+{
+}
+
+void CPUTraceBuffer::Cmd::execute(array_ref<TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() < 2) {
+		throw CommandException("Missing subcommand");
+	}
+	auto& trace = OUTER(CPUTraceBuffer, cmd);
+	string_ref subcommand = tokens[1].getString();
+	if (subcommand == "freeze") {
+		trace.frozen = true;
+	} else if (subcommand == "unfreeze") {
+		trace.frozen = false;
+	} else if (subcommand == "clear") {
+		trace.clear();
+	} else if (subcommand == "status") {
+		result.addListElement("size");
+		result.addListElement(int(trace.buffer.size()));
+		result.addListElement("count");
+		result.addListElement(int(trace.count));
+		result.addListElement("frozen");
+		result.addListElement(trace.frozen);
+		result.addListElement("streaming");
+		result.addListElement(trace.stream != nullptr);
+	} else if (subcommand == "dump") {
+		result.setString(trace.dump(trace.selectCount(tokens, 2)));
+	} else if (subcommand == "save") {
+		if (tokens.size() < 3) throw SyntaxError();
+		trace.saveText(tokens[2].getString(),
+		               trace.selectCount(tokens, 3));
+	} else if (subcommand == "stream") {
+		if (tokens.size() != 3) throw SyntaxError();
+		if (tokens[2].getString() == "off") {
+			trace.stream.reset();
+		} else {
+			trace.startStream(tokens[2].getString());
+		}
+	} else {
+		throw CommandException("Invalid subcommand: " + subcommand);
+	}
+}
+
+string CPUTraceBuffer::Cmd::help(const vector<string>& /*tokens*/) const
+{
+	return "Inspect the CPU trace buffer, see also the "
+	       "'cputrace_buffer_size' setting.\n"
+	       "cputrace_buffer freeze               stop recording\n"
+	       "cputrace_buffer unfreeze             resume recording\n"
+	       "cputrace_buffer clear                remove all recorded instructions\n"
+	       "cputrace_buffer status               show size and state of the buffer\n"
+	       "cputrace_buffer dump [<n>]           disassemble the last <n> (default all) instructions\n"
+	       "cputrace_buffer save <file> [<n>]    like 'dump', but write to a text file\n"
+	       "cputrace_buffer stream <file>|off    (stop) write all future instructions in binary format to a file\n"
+	       "Each line shows: time, slot, pc, "
+	       "instruction, registers (after the instruction).\n";
+}
+
+void CPUTraceBuffer::Cmd::tabCompletion(vector<string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static const char* const subCommands[] = {
+			"freeze", "unfreeze", "clear", "status",
+			"dump", "save", "stream",
+		};
+		completeString(tokens, subCommands);
+	} else if ((tokens.size() == 3) &&
+	           ((tokens[1] == "save") || (tokens[1] == "stream"))) {
+		completeFileName(tokens, userFileContext());
+	}
+}
+
+} // namespace openmsx
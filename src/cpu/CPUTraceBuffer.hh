@@ -0,0 +1,93 @@
+#ifndef CPUTRACEBUFFER_HH
+#define CPUTRACEBUFFER_HH
+
+#include "Command.hh"
+#include "IntegerSetting.hh"
+#include "Observer.hh"
+#include "EmuTime.hh"
+#include "File.hh"
+#include "openmsx.hh"
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace openmsx {
+
+class CommandController;
+class CPURegs;
+class MSXCPUInterface;
+
+/** Binary in-memory history of the last N executed CPU instructions.
+ *
+ * The 'cputrace' setting disassembles and prints every instruction, that's
+ * way too slow to keep enabled for a longer time. Instead this class only
+ * copies the raw data (time, registers, opcode bytes, slot selection) into a
+ * fixed-size ring buffer. Disassembling only happens when the content is
+ * exported (via the 'cputrace_buffer' command).
+ *
+ * Records are only written from the CPU emulation loop (single producer) and
+ * only read from the same (main) thread, so no locking is needed.
+ */
+class CPUTraceBuffer final : private Observer<Setting>
+{
+public:
+	/** On-disk format of the 'stream' subcommand: a sequence of these
+	  * records in host byte order, no header. */
+	struct Record {
+		uint64_t time; // EmuTime ticks, see EmuTime::MAIN_FREQ
+		word pc; // address of the instruction
+		word af, bc, de, hl, ix, iy, sp; // values after the instruction
+		byte opcode[4];
+		byte slot; // bit 0-1: primary slot, bit 2-3: secondary slot,
+		           // bit 6: slot is expanded, bit 7: R800
+		byte pad[3];
+	};
+
+	explicit CPUTraceBuffer(CommandController& commandController);
+	~CPUTraceBuffer();
+
+	/** Buffer size as configured by the user, CPUCore observes this to
+	  * know whether it should call record(). */
+	IntegerSetting& getSizeSetting() { return sizeSetting; }
+
+	/** Store the state after executing the instruction that started at
+	  * the given address. 'opcode' are the (4) bytes at that address,
+	  * as they were when the instruction was fetched.
+	  * Does nothing when the buffer is disabled or frozen. A write error
+	  * on the 'stream' file stops streaming and prints a warning. */
+	void record(const CPURegs& regs, word startPc, const byte* opcode,
+	            bool isR800, const MSXCPUInterface& interface,
+	            EmuTime::param time);
+
+private:
+	void resize(unsigned size);
+	void clear();
+	const Record& get(unsigned i) const; // 0 is oldest
+	unsigned selectCount(array_ref<TclObject> tokens, unsigned pos) const;
+	void printRecord(std::ostream& os, const Record& r) const;
+	std::string dump(unsigned num) const;
+	void saveText(string_ref filename, unsigned num) const;
+	void startStream(string_ref filename);
+
+	// Observer<Setting>
+	void update(const Setting& setting) override;
+
+	struct Cmd final : Command {
+		explicit Cmd(CommandController& commandController_);
+		void execute(array_ref<TclObject> tokens,
+		             TclObject& result) override;
+		std::string help(const std::vector<std::string>& tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} cmd;
+
+	IntegerSetting sizeSetting;
+	std::vector<Record> buffer;
+	std::unique_ptr<File> stream;
+	unsigned head;  // position where the next record will be written
+	unsigned count; // number of valid records
+	bool frozen;
+};
+
+} // namespace openmsx
+
+#endif
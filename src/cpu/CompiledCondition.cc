@@ -0,0 +1,329 @@
+#include "CompiledCondition.hh"
+#include "CPURegs.hh"
+#include "StringOp.hh"
+#include "unreachable.hh"
+#include <cctype>
+#include <cstring>
+#include <cassert>
+
+using std::vector;
+
+namespace openmsx {
+
+// The register names accepted by the 'reg' proc.
+enum RegName {
+	REG_A, REG_F, REG_B, REG_C, REG_D, REG_E, REG_H, REG_L,
+	REG_A2, REG_F2, REG_B2, REG_C2, REG_D2, REG_E2, REG_H2, REG_L2,
+	REG_IXH, REG_IXL, REG_IYH, REG_IYL, REG_PCH, REG_PCL, REG_SPH, REG_SPL,
+	REG_I, REG_R, REG_IM,
+	REG_AF, REG_BC, REG_DE, REG_HL, REG_AF2, REG_BC2, REG_DE2, REG_HL2,
+	REG_IX, REG_IY, REG_PC, REG_SP
+};
+static const char* const regNames[] = {
+	"A", "F", "B", "C", "D", "E", "H", "L",
+	"A2", "F2", "B2", "C2", "D2", "E2", "H2", "L2",
+	"IXH", "IXL", "IYH", "IYL", "PCH", "PCL", "SPH", "SPL",
+	"I", "R", "IM",
+	"AF", "BC", "DE", "HL", "AF2", "BC2", "DE2", "HL2",
+	"IX", "IY", "PC", "SP"
+};
+
+unsigned CompiledCondition::readReg(const CPURegs& regs, int64_t reg)
+{
+	switch (reg) {
+	case REG_A:   return regs.getA();
+	case REG_F:   return regs.getF();
+	case REG_B:   return regs.getB();
+	case REG_C:   return regs.getC();
+	case REG_D:   return regs.getD();
+	case REG_E:   return regs.getE();
+	case REG_H:   return regs.getH();
+	case REG_L:   return regs.getL();
+	case REG_A2:  return regs.getA2();
+	case REG_F2:  return regs.getF2();
+	case REG_B2:  return regs.getB2();
+	case REG_C2:  return regs.getC2();
+	case REG_D2:  return regs.getD2();
+	case REG_E2:  return regs.getE2();
+	case REG_H2:  return regs.getH2();
+	case REG_L2:  return regs.getL2();
+	case REG_IXH: return regs.getIXh();
+	case REG_IXL: return regs.getIXl();
+	case REG_IYH: return regs.getIYh();
+	case REG_IYL: return regs.getIYl();
+	case REG_PCH: return regs.getPCh();
+	case REG_PCL: return regs.getPCl();
+	case REG_SPH: return regs.getSPh();
+	case REG_SPL: return regs.getSPl();
+	case REG_I:   return regs.getI();
+	case REG_R:   return regs.getR();
+	case REG_IM:  return regs.getIM();
+	case REG_AF:  return regs.getAF();
+	case REG_BC:  return regs.getBC();
+	case REG_DE:  return regs.getDE();
+	case REG_HL:  return regs.getHL();
+	case REG_AF2: return regs.getAF2();
+	case REG_BC2: return regs.getBC2();
+	case REG_DE2: return regs.getDE2();
+	case REG_HL2: return regs.getHL2();
+	case REG_IX:  return regs.getIX();
+	case REG_IY:  return regs.getIY();
+	case REG_PC:  return regs.getPC();
+	case REG_SP:  return regs.getSP();
+	default: UNREACHABLE; return 0;
+	}
+}
+
+
+// Recursive descent parser that follows the Tcl operator precedence. Any
+// parse error (or unsupported construct) simply results in 'false', the
+// Tcl interpreter will then report the actual error (if any).
+class ConditionParser
+{
+public:
+	explicit ConditionParser(string_ref expr_)
+		: expr(expr_), depth(0), maxDepth(0) {}
+
+	bool parse(vector<CompiledCondition::Op>& result);
+
+private:
+	using OpCode = CompiledCondition::OpCode;
+
+	void skipSpace();
+	bool match(string_ref token);
+	bool parseBinary(int level);
+	bool parseUnary();
+	bool parsePrimary();
+	bool parseCommand();
+	bool parseNumber(int64_t& result);
+	string_ref parseWord();
+	void emit(OpCode code, int64_t arg = 0);
+
+	string_ref expr;
+	vector<CompiledCondition::Op> ops;
+	unsigned depth;
+	unsigned maxDepth;
+};
+
+bool ConditionParser::parse(vector<CompiledCondition::Op>& result)
+{
+	if (!parseBinary(0)) return false;
+	skipSpace();
+	if (!expr.empty()) return false;
+	if (maxDepth > CompiledCondition::MAX_STACK) return false;
+	assert(depth == 1);
+	result = std::move(ops);
+	return true;
+}
+
+void ConditionParser::skipSpace()
+{
+	while (!expr.empty() && isspace(expr.front())) {
+		expr.remove_prefix(1);
+	}
+}
+
+bool ConditionParser::match(string_ref token)
+{
+	skipSpace();
+	if (!expr.starts_with(token)) return false;
+	expr.remove_prefix(token.size());
+	return true;
+}
+
+void ConditionParser::emit(OpCode code, int64_t arg)
+{
+	CompiledCondition::Op op = { code, arg };
+	ops.push_back(op);
+	if (code <= CompiledCondition::PC_IN_SLOT) {
+		// operand, pushes one value
+		++depth;
+		maxDepth = std::max(maxDepth, depth);
+	} else if (code >= CompiledCondition::MUL) {
+		// binary operator, pops two values, pushes one
+		--depth;
+	}
+}
+
+// Binary operators, from lowest to highest precedence. Operators that are a
+// prefix of an other operator on the same (or a lower) level must come last.
+struct BinOp {
+	const char* token;
+	CompiledCondition::OpCode code;
+};
+static const BinOp level0[] = { {"||", CompiledCondition::LOG_OR}, {nullptr, CompiledCondition::NUMBER} };
+static const BinOp level1[] = { {"&&", CompiledCondition::LOG_AND}, {nullptr, CompiledCondition::NUMBER} };
+static const BinOp level2[] = { {"|", CompiledCondition::BIT_OR}, {nullptr, CompiledCondition::NUMBER} };
+static const BinOp level3[] = { {"^", CompiledCondition::BIT_XOR}, {nullptr, CompiledCondition::NUMBER} };
+static const BinOp level4[] = { {"&", CompiledCondition::BIT_AND}, {nullptr, CompiledCondition::NUMBER} };
+static const BinOp level5[] = { {"==", CompiledCondition::EQ}, {"!=", CompiledCondition::NE}, {nullptr, CompiledCondition::NUMBER} };
+static const BinOp level6[] = { {"<=", CompiledCondition::LE}, {">=", CompiledCondition::GE},
+                                {"<", CompiledCondition::LT}, {">", CompiledCondition::GT}, {nullptr, CompiledCondition::NUMBER} };
+static const BinOp level7[] = { {"+", CompiledCondition::ADD}, {"-", CompiledCondition::SUB}, {nullptr, CompiledCondition::NUMBER} };
+static const BinOp level8[] = { {"*", CompiledCondition::MUL}, {nullptr, CompiledCondition::NUMBER} };
+static const BinOp* const levels[] = {
+	level0, level1, level2, level3, level4, level5, level6, level7, level8
+};
+static const int NUM_LEVELS = sizeof(levels) / sizeof(levels[0]);
+
+bool ConditionParser::parseBinary(int level)
+{
+	if (level == NUM_LEVELS) return parseUnary();
+
+	if (!parseBinary(level + 1)) return false;
+	while (true) {
+		skipSpace();
+		// Operators that are not supported at all ('<<', '/', '?', ...)
+		// are left in the input and cause the parse to fail.
+		if (expr.starts_with("<<") || expr.starts_with(">>") ||
+		    expr.starts_with("**")) {
+			return false;
+		}
+		const BinOp* op = levels[level];
+		for (; op->token; ++op) {
+			string_ref token = op->token;
+			if (!expr.starts_with(token)) continue;
+			// don't confuse '|' with '||' and '&' with '&&'
+			if ((token.size() == 1) && (expr.size() > 1) &&
+			    (expr[1] == token[0])) continue;
+			break;
+		}
+		if (!op->token) return true;
+		expr.remove_prefix(strlen(op->token));
+		if (!parseBinary(level + 1)) return false;
+		emit(op->code);
+	}
+}
+
+bool ConditionParser::parseUnary()
+{
+	skipSpace();
+	if (match("-")) {
+		if (!parseUnary()) return false;
+		emit(CompiledCondition::NEG);
+		return true;
+	} else if (match("~")) {
+		if (!parseUnary()) return false;
+		emit(CompiledCondition::BIT_NOT);
+		return true;
+	} else if (!expr.starts_with("!=") && match("!")) {
+		if (!parseUnary()) return false;
+		emit(CompiledCondition::LOG_NOT);
+		return true;
+	} else if (match("+")) {
+		return parseUnary();
+	}
+	return parsePrimary();
+}
+
+bool ConditionParser::parsePrimary()
+{
+	skipSpace();
+	if (match("(")) {
+		if (!parseBinary(0)) return false;
+		return match(")");
+	} else if (match("[")) {
+		if (!parseCommand()) return false;
+		return match("]");
+	}
+	int64_t value;
+	if (!parseNumber(value)) return false;
+	emit(CompiledCondition::NUMBER, value);
+	return true;
+}
+
+string_ref ConditionParser::parseWord()
+{
+	skipSpace();
+	auto it = expr.begin();
+	while ((it != expr.end()) && (isalnum(*it) || (*it == '_'))) ++it;
+	string_ref result(expr.begin(), it);
+	expr.remove_prefix(result.size());
+	return result;
+}
+
+bool ConditionParser::parseNumber(int64_t& result)
+{
+	skipSpace();
+	string_ref token = parseWord();
+	if (token.empty()) return false;
+	int base = 10;
+	if ((token.size() > 2) && (token[0] == '0') &&
+	    ((token[1] == 'x') || (token[1] == 'X'))) {
+		base = 16;
+		token.remove_prefix(2);
+	} else if ((token.size() > 1) && (token[0] == '0')) {
+		// Octal or decimal depends on the Tcl version, let Tcl decide.
+		return false;
+	}
+	int64_t value = 0;
+	for (char c : token) {
+		int digit;
+		if (('0' <= c) && (c <= '9')) {
+			digit = c - '0';
+		} else if ((base == 16) && isxdigit(c)) {
+			digit = tolower(c) - 'a' + 10;
+		} else {
+			return false;
+		}
+		value = value * base + digit;
+		if (value > 0xFFFFFFFF) return false; // keep it simple
+	}
+	result = value;
+	return true;
+}
+
+bool ConditionParser::parseCommand()
+{
+	string_ref cmd = parseWord();
+	if (cmd == "reg") {
+		string_ref name = parseWord();
+		for (unsigned i = 0; i < sizeof(regNames) / sizeof(regNames[0]); ++i) {
+			if (StringOp::casecmp()(name, regNames[i])) {
+				emit(CompiledCondition::REG, i);
+				return true;
+			}
+		}
+		return false;
+	} else if ((cmd == "peek") || (cmd == "peek8") || (cmd == "peek_u8") ||
+	           (cmd == "peek16") || (cmd == "peek_u16")) {
+		int64_t addr;
+		if (!parseNumber(addr) || (addr > 0xFFFF)) return false;
+		emit(cmd.ends_with("16") ? CompiledCondition::PEEK16
+		                         : CompiledCondition::PEEK, addr);
+		return true;
+	} else if (cmd == "pc_in_slot") {
+		int64_t ps;
+		if (!parseNumber(ps) || (ps > 3)) return false;
+		int64_t ss = -1;
+		skipSpace();
+		if (!expr.starts_with("]")) {
+			if (match("X")) {
+				// same as not specified
+			} else if (!parseNumber(ss) || (ss > 3)) {
+				return false;
+			}
+			// mapper block is not supported
+		}
+		emit(CompiledCondition::PC_IN_SLOT, ps * 16 + (ss & 15));
+		return true;
+	}
+	return false;
+}
+
+
+std::unique_ptr<CompiledCondition> CompiledCondition::compile(string_ref expr)
+{
+	vector<Op> ops;
+	ConditionParser parser(expr);
+	if (!parser.parse(ops)) return nullptr;
+	return std::unique_ptr<CompiledCondition>(
+		new CompiledCondition(std::move(ops)));
+}
+
+CompiledCondition::CompiledCondition(vector<Op> ops_)
+	: ops(std::move(ops_))
+{
+}
+
+} // namespace openmsx
@@ -0,0 +1,130 @@
+#ifndef COMPILEDCONDITION_HH
+#define COMPILEDCONDITION_HH
+
+#include "CPURegs.hh"
+#include "EmuTime.hh"
+#include "string_ref.hh"
+#include "unreachable.hh"
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cassert>
+
+namespace openmsx {
+
+/** A debug condition (see BreakPointBase) translated to native code.
+ *
+ * Evaluating a condition via Tcl costs a lot compared to emulating a single
+ * Z80 instruction, and conditions are evaluated after every instruction. So
+ * for the most common forms we bypass Tcl. Only a subset of the Tcl 'expr'
+ * syntax is recognized:
+ *  - decimal and hexadecimal (0x) integer literals
+ *  - [reg <name>]                     (see share/scripts/_cpuregs.tcl)
+ *  - [peek <addr>], [peek16 <addr>]   (address must be a literal)
+ *  - [pc_in_slot <ps> ?<ss>?]
+ *  - unary  - ~ !
+ *  - binary * + - < > <= >= == != & ^ | && ||
+ *  - parentheses
+ * Everything else (variables, other commands, ...) makes compile() fail,
+ * those conditions keep on being evaluated by Tcl.
+ */
+class CompiledCondition
+{
+public:
+	/** Try to compile the given Tcl expression.
+	  * @return The compiled condition or nullptr if the expression uses
+	  *         constructs that are not supported.
+	  */
+	static std::unique_ptr<CompiledCondition> compile(string_ref expr);
+
+	/** 'Interface' is MSXCPUInterface, only its peekMem() and slot
+	  * selection getters are used (the unittest passes a mock). */
+	template<typename Interface>
+	bool evaluate(const CPURegs& regs, const Interface& interface,
+	              EmuTime::param time) const;
+
+	// for the parser only
+	enum OpCode {
+		NUMBER, REG, PEEK, PEEK16, PC_IN_SLOT,
+		NEG, BIT_NOT, LOG_NOT,
+		MUL, ADD, SUB, LT, GT, LE, GE, EQ, NE,
+		BIT_AND, BIT_XOR, BIT_OR, LOG_AND, LOG_OR
+	};
+	struct Op {
+		OpCode code;
+		int64_t arg;
+	};
+	static const unsigned MAX_STACK = 16;
+
+private:
+	explicit CompiledCondition(std::vector<Op> ops);
+	static unsigned readReg(const CPURegs& regs, int64_t reg);
+
+	const std::vector<Op> ops; // in reverse polish notation
+};
+
+template<typename Interface>
+bool CompiledCondition::evaluate(
+	const CPURegs& regs, const Interface& interface,
+	EmuTime::param time) const
+{
+	int64_t stack[MAX_STACK];
+	int64_t* sp = stack; // points to first free slot
+	for (auto& op : ops) {
+		switch (op.code) {
+		case NUMBER:
+			*sp++ = op.arg;
+			break;
+		case REG:
+			*sp++ = readReg(regs, op.arg);
+			break;
+		case PEEK:
+			*sp++ = interface.peekMem(op.arg, time);
+			break;
+		case PEEK16:
+			*sp++ =        interface.peekMem( op.arg,               time) +
+			        256 * interface.peekMem((op.arg + 1) & 0xFFFF, time);
+			break;
+		case PC_IN_SLOT: {
+			int page = regs.getPC() >> 14;
+			int ps = interface.getPrimarySlot(page);
+			int wantPs = op.arg >> 4;
+			int wantSs = op.arg & 15; // 15 -> don't care
+			*sp++ = (ps == wantPs) &&
+			        ((wantSs == 15) || !interface.isExpanded(ps) ||
+			         (interface.getSecondarySlot(page) == wantSs));
+			break;
+		}
+		case NEG:     sp[-1] = -sp[-1]; break;
+		case BIT_NOT: sp[-1] = ~sp[-1]; break;
+		case LOG_NOT: sp[-1] = !sp[-1]; break;
+		default: {
+			int64_t b = *--sp;
+			int64_t& a = sp[-1];
+			switch (op.code) {
+			case MUL:     a = a * b; break;
+			case ADD:     a = a + b; break;
+			case SUB:     a = a - b; break;
+			case LT:      a = a <  b; break;
+			case GT:      a = a >  b; break;
+			case LE:      a = a <= b; break;
+			case GE:      a = a >= b; break;
+			case EQ:      a = a == b; break;
+			case NE:      a = a != b; break;
+			case BIT_AND: a = a & b; break;
+			case BIT_XOR: a = a ^ b; break;
+			case BIT_OR:  a = a | b; break;
+			case LOG_AND: a = a && b; break;
+			case LOG_OR:  a = a || b; break;
+			default: UNREACHABLE;
+			}
+		}
+		}
+	}
+	assert(sp == (stack + 1));
+	return stack[0] != 0;
+}
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,238 @@
+#include "CompiledCondition.hh"
+#include "CPURegs.hh"
+#include <string>
+#include <cstring>
+#include <cassert>
+
+using namespace openmsx;
+
+// Only the parts of MSXCPUInterface that CompiledCondition uses.
+struct MockInterface
+{
+	MockInterface()
+	{
+		memset(mem, 0, sizeof(mem));
+		for (int i = 0; i < 4; ++i) {
+			primary[i] = secondary[i] = 0;
+			expanded[i] = false;
+		}
+	}
+	byte peekMem(word address, EmuTime::param /*time*/) const
+	{
+		return mem[address];
+	}
+	int getPrimarySlot  (int page) const { return primary  [page]; }
+	int getSecondarySlot(int page) const { return secondary[page]; }
+	bool isExpanded(int ps) const { return expanded[ps]; }
+
+	byte mem[0x10000];
+	int primary[4];
+	int secondary[4];
+	bool expanded[4];
+};
+
+static CPURegs regs(false);
+static MockInterface interface;
+
+static bool compiles(const std::string& expr)
+{
+	return CompiledCondition::compile(expr) != nullptr;
+}
+
+static bool eval(const std::string& expr)
+{
+	auto cond = CompiledCondition::compile(expr);
+	assert(cond);
+	return cond->evaluate(regs, interface, EmuTime::zero);
+}
+
+static void testPrecedence()
+{
+	assert( eval("2 + 3 * 4 == 14"));
+	assert( eval("(2 + 3) * 4 == 20"));
+	assert( eval("10 - 3 - 2 == 5")); // left associative
+	assert( eval("-2 * 3 == -6"));
+	assert( eval("- -5 == 5"));
+	assert( eval("+7 == 7"));
+	assert( eval("~0 == -1"));
+	assert( eval("!0 == 1"));
+	assert( eval("!5 == 0"));
+	assert( eval("1 < 2 == 1"));   // (1 < 2) == 1
+	assert(!eval("6 & 3 == 3"));   // 6 & (3 == 3)
+	assert( eval("(6 & 3) == 2"));
+	assert( eval("(5 ^ 1) == 4"));
+	assert( eval("(1 | 2 ^ 3 & 4) == 3")); // 1 | (2 ^ (3 & 4))
+	assert(!eval("0 || 1 && 0"));  // 0 || (1 && 0)
+	assert( eval("1 || 0 && 0"));
+	assert( eval("1 && 2"));       // not confused with '&'
+	assert( eval("1 || 0"));       // not confused with '|'
+	assert( eval("3 <= 3"));
+	assert(!eval("3 >= 4"));
+	assert( eval("3 != 4"));
+	assert( eval("!(3 == 4)"));
+	assert( eval("4 > 3 && 3 < 4"));
+	assert( eval(" ( 1+2 )*3==9 "));
+}
+
+static void testNumbers()
+{
+	assert( eval("255 == 0xff"));
+	assert( eval("0x1F == 31"));
+	assert( eval("0X1f == 31"));
+	assert( eval("0 == 0"));
+	assert( eval("4294967295 == 0xFFFFFFFF"));
+
+	// These are valid Tcl, but are left to Tcl: octal or decimal
+	// depends on the Tcl version, '$' is a variable, the others are
+	// simply not supported.
+	assert(!compiles("0377"));
+	assert(!compiles("$ff"));
+	assert(!compiles("$ff == 255"));
+	assert(!compiles("#ff"));
+	assert(!compiles("0b101"));
+	assert(!compiles("1.5"));
+	assert(!compiles("1e3"));
+	assert(!compiles("4294967296")); // too large
+	assert(!compiles("0x"));
+}
+
+static void testRegisters()
+{
+	regs.setAF (0x0102); regs.setBC (0x0304);
+	regs.setDE (0x0506); regs.setHL (0x0708);
+	regs.setAF2(0x090A); regs.setBC2(0x0B0C);
+	regs.setDE2(0x0D0E); regs.setHL2(0x0F10);
+	regs.setIX (0x1112); regs.setIY (0x1314);
+	regs.setPC (0x4116); regs.setSP (0x1718);
+	regs.setI(0x19); regs.setR(0x1A); regs.setIM(2);
+
+	assert(eval("[reg A]   == 0x01"));
+	assert(eval("[reg F]   == 0x02"));
+	assert(eval("[reg B]   == 0x03"));
+	assert(eval("[reg C]   == 0x04"));
+	assert(eval("[reg D]   == 0x05"));
+	assert(eval("[reg E]   == 0x06"));
+	assert(eval("[reg H]   == 0x07"));
+	assert(eval("[reg L]   == 0x08"));
+	assert(eval("[reg A2]  == 0x09"));
+	assert(eval("[reg F2]  == 0x0A"));
+	assert(eval("[reg B2]  == 0x0B"));
+	assert(eval("[reg C2]  == 0x0C"));
+	assert(eval("[reg D2]  == 0x0D"));
+	assert(eval("[reg E2]  == 0x0E"));
+	assert(eval("[reg H2]  == 0x0F"));
+	assert(eval("[reg L2]  == 0x10"));
+	assert(eval("[reg IXH] == 0x11"));
+	assert(eval("[reg IXL] == 0x12"));
+	assert(eval("[reg IYH] == 0x13"));
+	assert(eval("[reg IYL] == 0x14"));
+	assert(eval("[reg PCH] == 0x41"));
+	assert(eval("[reg PCL] == 0x16"));
+	assert(eval("[reg SPH] == 0x17"));
+	assert(eval("[reg SPL] == 0x18"));
+	assert(eval("[reg I]   == 0x19"));
+	assert(eval("[reg R]   == 0x1A"));
+	assert(eval("[reg IM]  == 2"));
+	assert(eval("[reg AF]  == 0x0102"));
+	assert(eval("[reg BC]  == 0x0304"));
+	assert(eval("[reg DE]  == 0x0506"));
+	assert(eval("[reg HL]  == 0x0708"));
+	assert(eval("[reg AF2] == 0x090A"));
+	assert(eval("[reg BC2] == 0x0B0C"));
+	assert(eval("[reg DE2] == 0x0D0E"));
+	assert(eval("[reg HL2] == 0x0F10"));
+	assert(eval("[reg IX]  == 0x1112"));
+	assert(eval("[reg IY]  == 0x1314"));
+	assert(eval("[reg PC]  == 0x4116"));
+	assert(eval("[reg SP]  == 0x1718"));
+	assert(eval("[reg hl]  == 0x0708")); // case insensitive
+	assert(eval("[ reg  de ] == 0x0506"));
+	assert(eval("[reg hl] + [reg de] == 0x0C0E"));
+
+	// flags: S Z - H - P/V N C
+	regs.setF(0x41); // Z and C set
+	assert(!eval("[reg F] & 0x80")); // S
+	assert( eval("[reg F] & 0x40")); // Z
+	assert(!eval("[reg F] & 0x10")); // H
+	assert(!eval("[reg F] & 0x04")); // P/V
+	assert(!eval("[reg F] & 0x02")); // N
+	assert( eval("[reg F] & 0x01")); // C
+	assert( eval("([reg F] & 0x41) == 0x41"));
+	regs.setF2(0x84); // S and P/V set in the shadow flags
+	assert( eval("[reg F2] & 0x80"));
+	assert( eval("[reg F2] & 0x04"));
+	assert(!eval("[reg F2] & 0x40"));
+
+	assert(!compiles("[reg XYZ]"));
+	assert(!compiles("[reg]"));
+	assert(!compiles("[reg A"));
+}
+
+static void testMemoryAndSlots()
+{
+	interface.mem[0x1234] = 0x56;
+	interface.mem[0x1235] = 0x78;
+	interface.mem[0xFFFF] = 0x12;
+	interface.mem[0x0000] = 0x34;
+	assert(eval("[peek 0x1234] == 0x56"));
+	assert(eval("[peek8 4660] == 0x56"));
+	assert(eval("[peek_u8 0x1234] == 0x56"));
+	assert(eval("[peek16 0x1234] == 0x7856"));
+	assert(eval("[peek_u16 0x1234] == 0x7856"));
+	assert(eval("[peek16 0xFFFF] == 0x3412")); // wraps around
+	assert(!compiles("[peek 0x10000]"));
+	assert(!compiles("[peek [reg HL]]"));
+	assert(!compiles("[peek $addr]"));
+	assert(!compiles("[peek_s8 0]"));
+
+	// PC (0x4116) is in page 1
+	interface.primary[1] = 2;
+	interface.secondary[1] = 3;
+	interface.expanded[2] = true;
+	assert( eval("[pc_in_slot 2]"));
+	assert( eval("[pc_in_slot 2 X]"));
+	assert( eval("[pc_in_slot 2 3]"));
+	assert(!eval("[pc_in_slot 2 1]"));
+	assert(!eval("[pc_in_slot 1]"));
+	interface.expanded[2] = false;
+	assert( eval("[pc_in_slot 2 1]")); // not expanded, ss is ignored
+	assert(!compiles("[pc_in_slot 4]"));
+	assert(!compiles("[pc_in_slot 0 4]"));
+	assert(!compiles("[pc_in_slot 0 0 1]")); // mapper block
+}
+
+static void testRejected()
+{
+	assert(!compiles(""));
+	assert(!compiles("1 +"));
+	assert(!compiles("(1"));
+	assert(!compiles("1)"));
+	assert(!compiles("1 2"));
+	assert(!compiles("1 / 2"));
+	assert(!compiles("5 % 2"));
+	assert(!compiles("1 << 2"));
+	assert(!compiles("4 >> 1"));
+	assert(!compiles("2 ** 3"));
+	assert(!compiles("1 ? 2 : 3"));
+	assert(!compiles("$x == 1"));
+	assert(!compiles("[debug read memory 0] == 0"));
+	assert(!compiles("[reg A] eq 1"));
+	assert(!compiles("{1}"));
+
+	// The evaluation stack has a fixed size.
+	std::string expr = "1";
+	for (unsigned i = 1; i < CompiledCondition::MAX_STACK; ++i) {
+		expr = "1 + (" + expr + ")";
+	}
+	assert(compiles(expr));
+	assert(!compiles("1 + (" + expr + ")"));
+}
+
+int main()
+{
+	testPrecedence();
+	testNumbers();
+	testRegisters();
+	testMemoryAndSlots();
+	testRejected();
+}
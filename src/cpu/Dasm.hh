@@ -21,6 +21,15 @@ class MSXCPUInterface;
 unsigned dasm(const MSXCPUInterface& interf, word pc, byte buf[4],
               std::string& dest, EmuTime::param time);
 
+/** Disassemble an instruction of which the bytes were already read before
+  * (e.g. they were recorded in a CPUTraceBuffer).
+  * @param opcode The bytes that form this opcode (max 4)
+  * @param pc The address of the first byte of the opcode
+  * @param dest String representation of the disassembled opcode
+  * @return Length of the disassembled opcode in bytes
+  */
+unsigned dasm(const byte opcode[4], word pc, std::string& dest);
+
 } // namespace openmsx
 
 #endif
@@ -23,16 +23,21 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 	, traceSetting(
 		motherboard.getCommandController(), "cputrace",
 		"CPU tracing on/off", false, Setting::DONT_SAVE)
+	, blockCacheSetting(
+		motherboard.getCommandController(), "z80_block_cache",
+		"decode runs of Z80 instructions that only use registers in "
+		"advance", false)
+	, traceBuffer(motherboard.getCommandController())
 	, diHaltCallback(
 		motherboard.getCommandController(), "di_halt_callback",
 		"Tcl proc called when the CPU executed a DI/HALT sequence")
 	, z80(make_unique<CPUCore<Z80TYPE>>(
-		motherboard, "z80", traceSetting,
-		diHaltCallback, EmuTime::zero))
+		motherboard, "z80", traceSetting, blockCacheSetting,
+		traceBuffer, diHaltCallback, EmuTime::zero))
 	, r800(motherboard.isTurboR()
 		? make_unique<CPUCore<R800TYPE>>(
-			motherboard, "r800", traceSetting,
-			diHaltCallback, EmuTime::zero)
+			motherboard, "r800", traceSetting, blockCacheSetting,
+			traceBuffer, diHaltCallback, EmuTime::zero)
 		: nullptr)
 	, timeInfo(motherboard.getMachineInfoCommand())
 	, z80FreqInfo(motherboard.getMachineInfoCommand(), "z80_freq", *z80)
@@ -49,6 +54,8 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 	motherboard.getDebugger().setCPU(this);
 	motherboard.getScheduler().setCPU(this);
 	traceSetting.attach(*this);
+	blockCacheSetting.attach(*this);
+	traceBuffer.getSizeSetting().attach(*this);
 
 	z80->freqLocked.attach(*this);
 	z80->freqValue.attach(*this);
@@ -61,6 +68,8 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 MSXCPU::~MSXCPU()
 {
 	traceSetting.detach(*this);
+	blockCacheSetting.detach(*this);
+	traceBuffer.getSizeSetting().detach(*this);
 	z80->freqLocked.detach(*this);
 	z80->freqValue.detach(*this);
 	if (r800) {
@@ -150,6 +159,12 @@ void MSXCPU::invalidateMemCache(word start, unsigned size)
 	          : r800->invalidateMemCache(start, size);
 }
 
+void MSXCPU::fillReadCache(word start, unsigned size, const byte* data)
+{
+	z80Active ? z80 ->fillReadCache(start, size, data)
+	          : r800->fillReadCache(start, size, data);
+}
+
 void MSXCPU::raiseIRQ()
 {
 	          z80 ->raiseIRQ();
@@ -7,6 +7,7 @@
 #include "BooleanSetting.hh"
 #include "EmuTime.hh"
 #include "TclCallback.hh"
+#include "CPUTraceBuffer.hh"
 #include "serialize_meta.hh"
 #include "openmsx.hh"
 #include "array_ref.hh"
@@ -53,6 +54,11 @@ public:
 	  * method when a 'memory switch' occurs. */
 	void invalidateMemCache(word start, unsigned size);
 
+	/** Like invalidateMemCache(), but directly fill in the read cache for
+	  * the interval [start, start + size) with the given (linear) buffer.
+	  * Normally called via MSXCPUInterface::fillReadCache(). */
+	void fillReadCache(word start, unsigned size, const byte* data);
+
 	/** This method raises a maskable interrupt. A device may call this
 	  * method more than once. If the device wants to lower the
 	  * interrupt again it must call the lowerIRQ() method exactly as
@@ -135,6 +141,8 @@ private:
 
 	MSXMotherBoard& motherboard;
 	BooleanSetting traceSetting;
+	BooleanSetting blockCacheSetting;
+	CPUTraceBuffer traceBuffer;
 	TclCallback diHaltCallback;
 	const std::unique_ptr<CPUCore<Z80TYPE>> z80;
 	const std::unique_ptr<CPUCore<R800TYPE>> r800; // can be nullptr
@@ -43,6 +43,8 @@ bool MSXCPUInterface::breaked = false;
 bool MSXCPUInterface::continued = false;
 bool MSXCPUInterface::step = false;
 MSXCPUInterface::BreakPoints MSXCPUInterface::breakPoints;
+unsigned MSXCPUInterface::breakPointLines[CacheLine::NUM];
+unsigned MSXCPUInterface::breakPointLinesVersion = 0;
 //TODO watchpoints
 MSXCPUInterface::Conditions  MSXCPUInterface::conditions;
 
@@ -189,6 +191,22 @@ byte MSXCPUInterface::readMemSlow(word address, EmuTime::param time)
 	}
 }
 
+const byte* MSXCPUInterface::getWatchedReadCacheLine(word start) const
+{
+	if (disallowReadCache[start >> CacheLine::BITS] != MEMORY_WATCH_BIT) {
+		return nullptr;
+	}
+	return visibleDevices[start >> 14]->getReadCacheLine(start);
+}
+
+byte* MSXCPUInterface::getWatchedWriteCacheLine(word start) const
+{
+	if (disallowWriteCache[start >> CacheLine::BITS] != MEMORY_WATCH_BIT) {
+		return nullptr;
+	}
+	return visibleDevices[start >> 14]->getWriteCacheLine(start);
+}
+
 void MSXCPUInterface::writeMemSlow(word address, byte value, EmuTime::param time)
 {
 	if (unlikely((address == 0xFFFF) && isExpanded(primarySlotState[3]))) {
@@ -549,6 +567,31 @@ void MSXCPUInterface::unregisterGlobalWrite(MSXDevice& device, word address)
 	msxcpu.invalidateMemCache(address & CacheLine::HIGH, 0x100);
 }
 
+void MSXCPUInterface::fillReadCache(const MSXDevice& device, word start,
+                                    unsigned size, const byte* data)
+{
+	assert((start & CacheLine::LOW) == 0);
+	assert((size  & CacheLine::LOW) == 0);
+	int page = start >> 14;
+	assert(((start + size - 1) >> 14) == unsigned(page));
+	if (visibleDevices[page] != &device) {
+		// Not visible or only indirectly (e.g. via MSXMultiMemDevice).
+		msxcpu.invalidateMemCache(start, size);
+		return;
+	}
+	msxcpu.fillReadCache(start, size, data);
+	// Some lines may not be cached at all, see getReadCacheLine() and
+	// CPUCore::RDMEMslow().
+	unsigned first = start >> CacheLine::BITS;
+	unsigned last = first + (size >> CacheLine::BITS);
+	for (unsigned line = first; line < last; ++line) {
+		if (disallowReadCache[line] || isBreakPointLine(line)) {
+			msxcpu.invalidateMemCache(line << CacheLine::BITS,
+			                          CacheLine::SIZE);
+		}
+	}
+}
+
 ALWAYS_INLINE void MSXCPUInterface::updateVisible(int page, int ps, int ss)
 {
 	MSXDevice* newDevice = slotLayout[ps][ss][page];
@@ -702,14 +745,25 @@ void MSXCPUInterface::insertBreakPoint(const BreakPoint& bp)
 	auto it = upper_bound(begin(breakPoints), end(breakPoints),
 	                      bp, CompareBreakpoints());
 	breakPoints.insert(it, bp);
+
+	unsigned line = bp.getAddress() >> CacheLine::BITS;
+	if (breakPointLines[line]++ == 0) {
+		++breakPointLinesVersion;
+	}
 }
 
 void MSXCPUInterface::removeBreakPoint(const BreakPoint& bp)
 {
+	unsigned line = bp.getAddress() >> CacheLine::BITS;
 	auto range = equal_range(begin(breakPoints), end(breakPoints),
 	                         bp.getAddress(), CompareBreakpoints());
 	breakPoints.erase(find_if_unguarded(range.first, range.second,
 		[&](const BreakPoint& i) { return &i == &bp; }));
+
+	assert(breakPointLines[line] != 0);
+	if (--breakPointLines[line] == 0) {
+		++breakPointLinesVersion;
+	}
 }
 
 void MSXCPUInterface::checkBreakPoints(
@@ -717,6 +771,20 @@ void MSXCPUInterface::checkBreakPoints(
 	          BreakPoints::const_iterator> range,
 	MSXMotherBoard& motherBoard)
 {
+	// First try without the Tcl interpreter: when all conditions are
+	// compiled to native code and none of them is true, there's nothing
+	// to do. This is by far the most common case.
+	auto& interface = motherBoard.getCPUInterface();
+	auto& regs      = motherBoard.getCPU().getRegisters();
+	EmuTime::param time = motherBoard.getCurrentTime();
+	auto isFalse = [&](const BreakPointBase& b) {
+		return b.isCompiledFalse(regs, interface, time);
+	};
+	if (std::all_of(range.first, range.second, isFalse) &&
+	    std::all_of(begin(conditions), end(conditions), isFalse)) {
+		return;
+	}
+
 	// create copy for the case that breakpoint/condition removes itself
 	//  - keeps object alive by holding a shared_ptr to it
 	//  - avoids iterating over a changing collection
@@ -941,6 +1009,8 @@ void MSXCPUInterface::cleanup()
 	//      global objects.
 	breakPoints.clear();
 	conditions.clear();
+	memset(breakPointLines, 0, sizeof(breakPointLines));
+	++breakPointLinesVersion;
 }
 
 
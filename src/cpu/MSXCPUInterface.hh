@@ -177,6 +177,38 @@ public:
 		return visibleDevices[start >> 14]->getWriteCacheLine(start);
 	}
 
+	/** Like getReadCacheLine(), but for a line that is only uncacheable
+	  * because it contains a read watchpoint (and nothing else special).
+	  * The CPU may then read the non-watched bytes directly from the
+	  * returned buffer, see isReadWatched().
+	  */
+	const byte* getWatchedReadCacheLine(word start) const;
+	/** Like getWatchedReadCacheLine(), but for write watchpoints. */
+	byte* getWatchedWriteCacheLine(word start) const;
+
+	/** Is there a read/write watchpoint on this specific address? */
+	inline bool isReadWatched(word address) const {
+		return readWatchSet[address >> CacheLine::BITS]
+		                   [address &  CacheLine::LOW];
+	}
+	inline bool isWriteWatched(word address) const {
+		return writeWatchSet[address >> CacheLine::BITS]
+		                    [address &  CacheLine::LOW];
+	}
+
+	/** The device that is (directly) visible in the given 16kB page of
+	  * the CPU address space. */
+	const MSXDevice* getVisibleDevice(int page) const {
+		return visibleDevices[page];
+	}
+
+	/** See MSXDevice::fillReadCache(). Only has an effect when 'device'
+	  * is directly visible in the CPU address space, otherwise this is the
+	  * same as MSXCPU::invalidateMemCache().
+	  */
+	void fillReadCache(const MSXDevice& device, word start, unsigned size,
+	                   const byte* data);
+
 	/**
 	 * CPU uses this method to read 'extra' data from the databus
 	 * used in interrupt routines. In MSX this returns always 255.
@@ -203,6 +235,10 @@ public:
 	void unsetExpanded(int ps);
 	void testUnsetExpanded(int ps, std::vector<MSXDevice*> allowed) const;
 	inline bool isExpanded(int ps) const { return expanded[ps] != 0; }
+	/** The currently selected (primary/secondary) slot for a page.
+	  * The secondary slot is only meaningful for an expanded slot. */
+	int getPrimarySlot  (int page) const { return primarySlotState  [page]; }
+	int getSecondarySlot(int page) const { return secondarySlotState[page]; }
 	void changeExpanded(bool isExpanded);
 
 	DummyDevice& getDummyDevice() { return *dummyDevice; }
@@ -239,6 +275,26 @@ public:
 	{
 		return !breakPoints.empty() || !conditions.empty();
 	}
+	static bool anyConditions()
+	{
+		return !conditions.empty();
+	}
+	/** Is there a breakpoint on any address within the given cache line?
+	  * CPUCore never caches such a line. That way the instructions
+	  * fetched from it (and only those) can be checked for breakpoints,
+	  * all other code keeps running in the fast path.
+	  */
+	static bool isBreakPointLine(unsigned line)
+	{
+		return breakPointLines[line] != 0;
+	}
+	/** Changes each time a cache line becomes a breakpoint line or stops
+	  * being one. CPUCore uses this to know when to flush its cache.
+	  */
+	static unsigned getBreakPointLinesVersion()
+	{
+		return breakPointLinesVersion;
+	}
 	static bool checkBreakPoints(unsigned pc, MSXMotherBoard& motherBoard)
 	{
 		auto range = equal_range(begin(breakPoints), end(breakPoints),
@@ -396,6 +452,8 @@ private:
 
 	//  All CPUs (Z80 and R800) of all MSX machines share this state.
 	static BreakPoints breakPoints; // sorted on address
+	static unsigned breakPointLines[CacheLine::NUM]; // #bp per cache line
+	static unsigned breakPointLinesVersion;
 	WatchPoints watchPoints; // ordered in creation order,  TODO must also be static
 	static Conditions conditions; // ordered in creation order
 	static bool breaked;
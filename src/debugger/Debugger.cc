@@ -5,6 +5,7 @@
 #include "Reactor.hh"
 #include "MSXCPU.hh"
 #include "MSXCPUInterface.hh"
+#include "Scheduler.hh"
 #include "BreakPoint.hh"
 #include "DebugCondition.hh"
 #include "MSXWatchIODevice.hh"
@@ -272,6 +273,8 @@ void Debugger::Cmd::execute(
 		listConditions(tokens, result);
 	} else if (subCmd == "probe") {
 		probe(tokens, result);
+	} else if (subCmd == "scheduler_stats") {
+		schedulerStats(tokens, result);
 	} else {
 		throw SyntaxError();
 	}
@@ -755,6 +758,31 @@ void Debugger::Cmd::probeListBreakPoints(
 	result.setString(res);
 }
 
+void Debugger::Cmd::schedulerStats(
+	array_ref<TclObject> tokens, TclObject& result)
+{
+	auto& sched = debugger().motherBoard.getScheduler();
+	if (tokens.size() == 2) {
+		result.setString(sched.getStatsReport());
+		return;
+	}
+	if (tokens.size() != 3) {
+		throw SyntaxError();
+	}
+	string_ref subCmd = tokens[2].getString();
+	if (subCmd == "start") {
+		sched.setStatsEnabled(true);
+	} else if (subCmd == "stop") {
+		sched.setStatsEnabled(false);
+	} else if (subCmd == "clear") {
+		sched.clearStats();
+	} else if (subCmd == "enabled") {
+		result.setBoolean(sched.isStatsEnabled());
+	} else {
+		throw SyntaxError();
+	}
+}
+
 string Debugger::Cmd::help(const vector<string>& tokens) const
 {
 	static const string generalHelp =
@@ -782,6 +810,7 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		"    break             break CPU at current position\n"
 		"    breaked           query CPU breaked status\n"
 		"    disasm            disassemble instructions\n"
+		"    scheduler_stats   show which devices interrupt the CPU emulation\n"
 		"  The arguments are specific for each subcommand.\n"
 		"  Type 'help debug <subcommand>' for help about a specific subcommand.\n";
 
@@ -940,6 +969,19 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		"instruction).\n"
 		"  Note that openMSX comes with a 'disasm' Tcl script that is much "
 		"more convenient to use than this subcommand.";
+	static const string schedulerStatsHelp =
+		"debug scheduler_stats [start|stop|clear|enabled]\n"
+		"  Statistics about the synchronization points of the emulated "
+		"devices. Each time such a sync point fires, the CPU emulation "
+		"loop is interrupted. Collecting these statistics slows down "
+		"emulation a bit, so it must be explicitly started.\n"
+		"    (no argument)  show a table with, per type of device, the "
+		"number of sync points that were set, removed before they fired "
+		"and that fired, and the host time spent handling them\n"
+		"    start          start collecting statistics\n"
+		"    stop           stop collecting statistics\n"
+		"    clear          reset all counters to zero\n"
+		"    enabled        query whether statistics are being collected\n";
 	static const string unknownHelp =
 		"Unknown subcommand, use 'help debug' to see a list of valid "
 		"subcommands.\n";
@@ -990,6 +1032,8 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		return breakedHelp;
 	} else if (tokens[1] == "disasm") {
 		return disasmHelp;
+	} else if (tokens[1] == "scheduler_stats") {
+		return schedulerStatsHelp;
 	} else {
 		return unknownHelp;
 	}
@@ -1036,7 +1080,7 @@ void Debugger::Cmd::tabCompletion(vector<string>& tokens) const
 	static const char* const otherCmds[] = {
 		"disasm", "set_bp", "remove_bp", "set_watchpoint",
 		"remove_watchpoint", "set_condition", "remove_condition",
-		"probe",
+		"probe", "scheduler_stats",
 	};
 	switch (tokens.size()) {
 	case 2: {
@@ -1074,6 +1118,11 @@ void Debugger::Cmd::tabCompletion(vector<string>& tokens) const
 					"remove_bp", "list_bp",
 				};
 				completeString(tokens, subCmds);
+			} else if (tokens[1] == "scheduler_stats") {
+				static const char* const subCmds[] = {
+					"start", "stop", "clear", "enabled",
+				};
+				completeString(tokens, subCmds);
 			}
 		}
 		break;
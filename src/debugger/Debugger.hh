@@ -99,6 +99,7 @@ private:
 		void probeSetBreakPoint(array_ref<TclObject> tokens, TclObject& result);
 		void probeRemoveBreakPoint(array_ref<TclObject> tokens, TclObject& result);
 		void probeListBreakPoints(array_ref<TclObject> tokens, TclObject& result);
+		void schedulerStats(array_ref<TclObject> tokens, TclObject& result);
 	} cmd;
 
 	struct NameFromProbe {
@@ -25,6 +25,9 @@ CheckedRam::CheckedRam(const DeviceConfig& config, const std::string& name,
 	, umrCallback(config.getGlobalSettings().getUMRCallBackSetting())
 {
 	umrCallback.getSetting().attach(*this);
+	// All writes go via write() or via the pointers handed out by
+	// getWriteCacheLine(), so we can track them (see DirtyPages).
+	ram.getDirtyPages().enableTracking(true);
 	init();
 }
 
@@ -50,10 +53,26 @@ const byte* CheckedRam::getReadCacheLine(unsigned addr) const
 	     ? &ram[addr] : nullptr;
 }
 
+const byte* CheckedRam::getReadCacheBlock(unsigned addr, unsigned size) const
+{
+	unsigned first = addr >> CacheLine::BITS;
+	unsigned last = (addr + size - 1) >> CacheLine::BITS;
+	for (unsigned line = first; line <= last; ++line) {
+		if (!completely_initialized_cacheline[line]) return nullptr;
+	}
+	return &ram[addr];
+}
+
 byte* CheckedRam::getWriteCacheLine(unsigned addr) const
 {
-	return (completely_initialized_cacheline[addr >> CacheLine::BITS])
-	     ? const_cast<byte*>(&ram[addr]) : nullptr;
+	if (!completely_initialized_cacheline[addr >> CacheLine::BITS]) {
+		return nullptr;
+	}
+	// The CPU may write via this pointer until its cache is invalidated,
+	// ReverseManager does that after each snapshot.
+	auto& r = const_cast<Ram&>(ram);
+	r.getDirtyPages().mark(addr);
+	return &r[addr];
 }
 
 void CheckedRam::write(unsigned addr, const byte value)
@@ -68,6 +87,7 @@ void CheckedRam::write(unsigned addr, const byte value)
 		}
 	}
 	ram[addr] = value;
+	ram.getDirtyPages().mark(addr);
 }
 
 void CheckedRam::clear()
@@ -36,6 +36,10 @@ public:
 	void write(unsigned addr, const byte value);
 
 	const byte* getReadCacheLine(unsigned addr) const;
+	/** Like getReadCacheLine(), but for all cache lines in the range
+	  * [addr, addr + size) at once. Returns nullptr if any of them is not
+	  * cacheable. */
+	const byte* getReadCacheBlock(unsigned addr, unsigned size) const;
 	byte* getWriteCacheLine(unsigned addr) const;
 
 	unsigned getSize() const { return ram.getSize(); }
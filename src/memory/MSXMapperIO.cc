@@ -1,4 +1,5 @@
 #include "MSXMapperIO.hh"
+#include "MSXMemoryMapper.hh"
 #include "MSXMotherBoard.hh"
 #include "HardwareConfig.hh"
 #include "XMLElement.hh"
@@ -39,16 +40,18 @@ void MSXMapperIO::updateMask()
 	mask = ((256 - Math::powerOfTwo(largest)) & 255) | engineMask;
 }
 
-void MSXMapperIO::registerMapper(unsigned blocks)
+void MSXMapperIO::registerMapper(MSXMemoryMapper& mapper, unsigned blocks)
 {
 	auto it = upper_bound(begin(mapperSizes), end(mapperSizes), blocks);
 	mapperSizes.insert(it, blocks);
+	mappers.push_back(&mapper);
 	updateMask();
 }
 
-void MSXMapperIO::unregisterMapper(unsigned blocks)
+void MSXMapperIO::unregisterMapper(MSXMemoryMapper& mapper, unsigned blocks)
 {
 	mapperSizes.erase(rfind_unguarded(mapperSizes, blocks));
+	mappers.erase(rfind_unguarded(mappers, &mapper));
 	updateMask();
 }
 
@@ -80,6 +83,11 @@ void MSXMapperIO::writeIO(word port, byte value, EmuTime::param /*time*/)
 void MSXMapperIO::write(unsigned address, byte value)
 {
 	registers[address] = value;
+	// Typically one of the mappers is visible in this page, then it can
+	// fill in the CPU cache for the new segment in one go.
+	for (auto* mapper : mappers) {
+		if (mapper->fillPageCache(address)) return;
+	}
 	invalidateMemCache(0x4000 * address, 0x4000);
 }
 
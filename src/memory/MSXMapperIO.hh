@@ -7,6 +7,8 @@
 
 namespace openmsx {
 
+class MSXMemoryMapper;
+
 class MSXMapperIO final : public MSXDevice
 {
 public:
@@ -18,11 +20,12 @@ public:
 	void writeIO(word port, byte value, EmuTime::param time) override;
 
 	/**
-	 * Every MSXMemoryMapper must (un)register its size.
-	 * This is used to influence the result returned in readIO().
+	 * Every MSXMemoryMapper must (un)register itself and its size.
+	 * The size is used to influence the result returned in readIO(), the
+	 * mapper is asked to fill in the CPU cache after a segment switch.
 	 */
-	void registerMapper(unsigned blocks);
-	void unregisterMapper(unsigned blocks);
+	void registerMapper(MSXMemoryMapper& mapper, unsigned blocks);
+	void unregisterMapper(MSXMemoryMapper& mapper, unsigned blocks);
 
 	/**
 	 * Returns the actual selected page for the given bank.
@@ -47,6 +50,7 @@ private:
 	} debuggable;
 
 	std::vector<unsigned> mapperSizes; // sorted
+	std::vector<MSXMemoryMapper*> mappers;
 	byte registers[4];
 
 	/**
@@ -1,6 +1,7 @@
 #include "MSXMemoryMapper.hh"
 #include "MSXMapperIO.hh"
 #include "MSXMotherBoard.hh"
+#include "MSXCPUInterface.hh"
 #include "StringOp.hh"
 #include "MSXException.hh"
 #include "serialize.hh"
@@ -25,13 +26,13 @@ MSXMemoryMapper::MSXMemoryMapper(const DeviceConfig& config)
 	, mapperIO(*getMotherBoard().createMapperIO())
 {
 	unsigned nbBlocks = checkedRam.getSize() / 0x4000;
-	mapperIO.registerMapper(nbBlocks);
+	mapperIO.registerMapper(*this, nbBlocks);
 }
 
 MSXMemoryMapper::~MSXMemoryMapper()
 {
 	unsigned nbBlocks = checkedRam.getSize() / 0x4000;
-	mapperIO.unregisterMapper(nbBlocks);
+	mapperIO.unregisterMapper(*this, nbBlocks);
 	getMotherBoard().destroyMapperIO();
 }
 
@@ -79,6 +80,16 @@ byte* MSXMemoryMapper::getWriteCacheLine(word start) const
 	return checkedRam.getWriteCacheLine(calcAddress(start));
 }
 
+bool MSXMemoryMapper::fillPageCache(byte page)
+{
+	if (getCPUInterface().getVisibleDevice(page) != this) return false;
+	word start = 0x4000 * page;
+	const byte* data = checkedRam.getReadCacheBlock(calcAddress(start), 0x4000);
+	if (!data) return false; // some lines are not initialized yet
+	fillReadCache(start, 0x4000, data);
+	return true;
+}
+
 template<typename Archive>
 void MSXMemoryMapper::serialize(Archive& ar, unsigned /*version*/)
 {
@@ -22,6 +22,14 @@ public:
 	byte* getWriteCacheLine(word start) const override;
 	byte peekMem(word address, EmuTime::param time) const override;
 
+	/** Called by MSXMapperIO after a new segment was selected for the
+	  * given page. When this mapper is directly visible in that page, the
+	  * CPU read cache is filled in for the whole segment.
+	  * @return Was the cache filled in? If not, the caller must
+	  *         invalidate it.
+	  */
+	bool fillPageCache(byte page);
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
@@ -40,6 +40,9 @@ void PanasonicMemory::registerRam(Ram& ram_)
 {
 	ram = &ram_[0];
 	ramSize = ram_.getSize();
+	// The ROM mapper can write to this RAM (in DRAM mode) without
+	// reporting it.
+	ram_.getDirtyPages().enableTracking(false);
 }
 
 const byte* PanasonicMemory::getRomBlock(unsigned block)
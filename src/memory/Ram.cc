@@ -32,6 +32,7 @@ Ram::Ram(const DeviceConfig& config, const string& name,
 	: xml(*config.getXML())
 	, ram(size_)
 	, size(size_)
+	, dirty(size_)
 	, debuggable(make_unique<RamDebuggable>(
 		config.getMotherBoard(), name, description, *this))
 {
@@ -42,6 +43,7 @@ Ram::Ram(const DeviceConfig& config, unsigned size_)
 	: xml(*config.getXML())
 	, ram(size_)
 	, size(size_)
+	, dirty(size_)
 {
 	clear();
 }
@@ -87,7 +89,7 @@ void Ram::clear(byte c)
 		// no init pattern specified
 		memset(ram.data(), c, size);
 	}
-
+	dirty.markAll();
 }
 
 const string& Ram::getName() const
@@ -111,13 +113,14 @@ byte RamDebuggable::read(unsigned address)
 void RamDebuggable::write(unsigned address, byte value)
 {
 	ram[address] = value;
+	ram.getDirtyPages().mark(address);
 }
 
 
 template<typename Archive>
 void Ram::serialize(Archive& ar, unsigned /*version*/)
 {
-	ar.serialize_blob("ram", ram.data(), size);
+	ar.serialize_blob("ram", ram.data(), size, dirty);
 }
 INSTANTIATE_SERIALIZE_METHODS(Ram);
 
@@ -2,6 +2,7 @@
 #define RAM_HH
 
 #include "MemBuffer.hh"
+#include "DirtyPages.hh"
 #include "openmsx.hh"
 #include <string>
 #include <memory>
@@ -37,6 +38,11 @@ public:
 	const std::string& getName() const;
 	void clear(byte c = 0xff);
 
+	/** Pages written since the last reverse snapshot. Tracking is off
+	  * by default, owners that see all writes can enable it, see
+	  * DirtyPages. */
+	DirtyPages& getDirtyPages() { return dirty; }
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
@@ -44,6 +50,7 @@ private:
 	const XMLElement& xml;
 	MemBuffer<byte> ram;
 	unsigned size; // must come before debuggable
+	DirtyPages dirty;
 	const std::unique_ptr<RamDebuggable> debuggable; // can be nullptr
 };
 
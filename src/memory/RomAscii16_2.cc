@@ -27,6 +27,7 @@ RomAscii16_2::RomAscii16_2(const DeviceConfig& config, Rom&& rom_, SubType subTy
 	unsigned size = (subType == ASCII16_8) ? 0x2000 // 8kB
 					       : 0x0800; // 2kB
 	sram = make_unique<SRAM>(getName() + " SRAM", size, config);
+	fillCacheRegions = 0; // getReadCacheLine() is overridden for SRAM
 	reset(EmuTime::dummy());
 }
 
@@ -17,6 +17,7 @@ namespace openmsx {
 RomAscii8kB::RomAscii8kB(const DeviceConfig& config, Rom&& rom_)
 	: Rom8kBBlocks(config, std::move(rom_))
 {
+	fillCacheRegions = ~0u; // getReadCacheLine() is not overridden
 	reset(EmuTime::dummy());
 }
 
@@ -17,6 +17,7 @@ RomBlocks<BANK_SIZE>::RomBlocks(
 		const DeviceConfig& config, Rom&& rom_,
 		unsigned debugBankSizeShift)
 	: MSXRom(config, std::move(rom_))
+	, fillCacheRegions(0)
 	, romBlockDebug(
 		*this,  blockNr, 0x0000, 0x10000,
 		log2<BANK_SIZE>::value, debugBankSizeShift)
@@ -66,7 +67,11 @@ void RomBlocks<BANK_SIZE>::setBank(byte region, const byte* adr, int block)
 	        ((extraMem <= adr) && (adr <= &extraMem[extraSize - 1]))));
 	bankPtr[region] = adr;
 	blockNr[region] = block; // only for debuggable
-	invalidateMemCache(region * BANK_SIZE, BANK_SIZE);
+	if (fillCacheRegions & (1 << region)) {
+		fillReadCache(region * BANK_SIZE, BANK_SIZE, adr);
+	} else {
+		invalidateMemCache(region * BANK_SIZE, BANK_SIZE);
+	}
 }
 
 template <unsigned BANK_SIZE>
@@ -81,6 +81,15 @@ protected:
 	std::unique_ptr<SRAM> sram; // can be nullptr
 	byte blockNr[NUM_BANKS];
 
+	/** Bitmask of the regions for which setBank() may directly fill the
+	  * CPU read cache (see MSXDevice::fillReadCache()) instead of only
+	  * invalidating it. This is only allowed when getReadCacheLine()
+	  * returns the bankPtr[] memory for that whole region, so a subclass
+	  * that overrides getReadCacheLine() must take care when setting this.
+	  * Default is 0 (always invalidate).
+	  */
+	unsigned fillCacheRegions;
+
 private:
 	RomBlockDebuggable romBlockDebug;
 	const byte* extraMem;
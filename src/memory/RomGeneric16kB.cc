@@ -6,6 +6,7 @@ namespace openmsx {
 RomGeneric16kB::RomGeneric16kB(const DeviceConfig& config, Rom&& rom_)
 	: Rom16kBBlocks(config, std::move(rom_))
 {
+	fillCacheRegions = ~0u; // getReadCacheLine() is not overridden
 	reset(EmuTime::dummy());
 }
 
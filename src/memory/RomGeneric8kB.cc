@@ -6,6 +6,7 @@ namespace openmsx {
 RomGeneric8kB::RomGeneric8kB(const DeviceConfig& config, Rom&& rom_)
 	: Rom8kBBlocks(config, std::move(rom_))
 {
+	fillCacheRegions = ~0u; // getReadCacheLine() is not overridden
 	reset(EmuTime::dummy());
 }
 
@@ -19,6 +19,7 @@ namespace openmsx {
 RomKonami::RomKonami(const DeviceConfig& config, Rom&& rom_)
 	: Rom8kBBlocks(config, std::move(rom_))
 {
+	fillCacheRegions = ~0u; // getReadCacheLine() is not overridden
 	// Konami mapper is 256kB in size, even if ROM is smaller.
 	setBlockMask(31);
 
@@ -46,6 +46,7 @@ void RomKonamiSCC::powerUp(EmuTime::param time)
 
 void RomKonamiSCC::reset(EmuTime::param time)
 {
+	setSCCEnabled(false);
 	setUnmapped(0);
 	setUnmapped(1);
 	for (int i = 2; i < 6; i++) {
@@ -54,10 +55,17 @@ void RomKonamiSCC::reset(EmuTime::param time)
 	setUnmapped(6);
 	setUnmapped(7);
 
-	sccEnabled = false;
 	scc.reset(time);
 }
 
+void RomKonamiSCC::setSCCEnabled(bool enabled)
+{
+	sccEnabled = enabled;
+	// The SCC registers (0x9800-0x9FFF) are in region 4, only there
+	// getReadCacheLine() differs from the base class.
+	fillCacheRegions = sccEnabled ? ~(1u << 4) : ~0u;
+}
+
 byte RomKonamiSCC::peekMem(word address, EmuTime::param time) const
 {
 	if (sccEnabled && (0x9800 <= address) && (address < 0xA000)) {
@@ -98,7 +106,7 @@ void RomKonamiSCC::writeMem(word address, byte value, EmuTime::param time)
 	}
 	if ((address & 0xF800) == 0x9000) {
 		// SCC enable/disable
-		sccEnabled = ((value & 0x3F) == 0x3F);
+		setSCCEnabled((value & 0x3F) == 0x3F);
 		invalidateMemCache(0x9800, 0x0800);
 	}
 	if ((address & 0x1800) == 0x1000) {
@@ -131,6 +139,9 @@ void RomKonamiSCC::serialize(Archive& ar, unsigned /*version*/)
 	ar.template serializeBase<Rom8kBBlocks>(*this);
 	ar.serialize("scc", scc);
 	ar.serialize("sccEnabled", sccEnabled);
+	if (ar.isLoader()) {
+		setSCCEnabled(sccEnabled);
+	}
 }
 INSTANTIATE_SERIALIZE_METHODS(RomKonamiSCC);
 REGISTER_MSXDEVICE(RomKonamiSCC, "RomKonamiSCC");
@@ -23,6 +23,8 @@ public:
 	void serialize(Archive& ar, unsigned version);
 
 private:
+	void setSCCEnabled(bool enabled);
+
 	SCC scc;
 	bool sccEnabled;
 };
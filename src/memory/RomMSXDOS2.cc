@@ -13,6 +13,7 @@ RomMSXDOS2::RomMSXDOS2(const DeviceConfig& config, Rom&& rom_)
 	if ((range != 0x00) && (range != 0x60) && (range != 0x7f)) {
 		throw MSXException("Invalid rom for MSXDOS2 mapper");
 	}
+	fillCacheRegions = ~0u; // getReadCacheLine() is not overridden
 	reset(EmuTime::dummy());
 }
 
@@ -1,4 +1,6 @@
 #include "serialize.hh"
+#include "DeltaBlock.hh"
+#include "SerializeProfile.hh"
 #include "Base64.hh"
 #include "HexDump.hh"
 #include "XMLLoader.hh"
@@ -8,12 +10,17 @@
 #include "snappy.hh"
 #include "MemBuffer.hh"
 #include "StringOp.hh"
+#include "File.hh"
 #include "FileOperations.hh"
 #include "Version.hh"
 #include "Date.hh"
+#include "ThreadPool.hh"
+#include "memory.hh"
 #include "cstdiop.hh" // for dup()
 #include <cstring>
 #include <limits>
+#include <mutex>
+#include <condition_variable>
 
 using std::string;
 
@@ -26,6 +33,7 @@ void ArchiveBase<Derived>::attribute(const char* name, const char* value)
 	self().attribute(name, valueStr);
 }
 template class ArchiveBase<MemOutputArchive>;
+template class ArchiveBase<BinaryOutputArchive>;
 template class ArchiveBase<XmlOutputArchive>;
 
 ////
@@ -60,6 +68,13 @@ unsigned OutputArchiveBase2::generateID2(
 	return lastId;
 }
 
+void OutputArchiveBase2::resetIds()
+{
+	idMap.clear();
+	polyIdMap.clear();
+	lastId = 0;
+}
+
 unsigned OutputArchiveBase2::getID1(const void* p)
 {
 	auto it = polyIdMap.find(p);
@@ -109,6 +124,7 @@ void OutputArchiveBase<Derived>::serialize_blob(
 }
 
 template class OutputArchiveBase<MemOutputArchive>;
+template class OutputArchiveBase<BinaryOutputArchive>;
 template class OutputArchiveBase<XmlOutputArchive>;
 
 ////
@@ -168,6 +184,7 @@ void InputArchiveBase<Derived>::serialize_blob(
 }
 
 template class InputArchiveBase<MemInputArchive>;
+template class InputArchiveBase<BinaryInputArchive>;
 template class InputArchiveBase<XmlInputArchive>;
 
 ////
@@ -178,6 +195,17 @@ void MemOutputArchive::save(const std::string& s)
 	byte* buf = buffer.allocate(sizeof(size) + size);
 	memcpy(buf, &size, sizeof(size));
 	memcpy(buf + sizeof(size), s.data(), size);
+	if (unlikely(profile != nullptr)) profile->stringValue(s);
+}
+
+void MemOutputArchive::profileBeginTag(const char* tag)
+{
+	profile->beginTag(tag, buffer.getPosition());
+}
+
+void MemOutputArchive::profileEndTag()
+{
+	profile->endTag(buffer.getPosition());
 }
 
 MemBuffer<byte> MemOutputArchive::releaseBuffer(size_t& size)
@@ -214,7 +242,34 @@ string_ref MemInputArchive::loadStr()
 // only made it >= 52 so that the (incompressible) RP5C01 registers won't be
 // compressed.
 static const size_t SMALL_SIZE = 100;
-void MemOutputArchive::serialize_blob(const char*, const void* data, size_t len)
+void MemOutputArchive::serialize_blob(const char* tag, const void* data, size_t len)
+{
+	serializeBlobImpl(tag, data, len, nullptr);
+}
+
+void MemOutputArchive::serialize_blob(const char* tag, const void* data, size_t len,
+                                      DirtyPages& dirty)
+{
+	serializeBlobImpl(tag, data, len, &dirty);
+}
+
+void MemOutputArchive::serializeBlobImpl(const char* tag, const void* data,
+                                         size_t len, DirtyPages* dirty)
+{
+	if (likely(!profile)) {
+		storeBlob(data, len, dirty);
+	} else {
+		profile->beginTag(tag, buffer.getPosition());
+		size_t before = buffer.getPosition();
+		storeBlob(data, len, dirty);
+		// Large blobs in reverse snapshots are stored separately (see
+		// DeltaBlock), those are not included in the stored size.
+		profile->blob(len, buffer.getPosition() - before);
+		profile->endTag(buffer.getPosition());
+	}
+}
+
+void MemOutputArchive::storeBlob(const void* data, size_t len, DirtyPages* dirty)
 {
 	// Compress in-memory blobs:
 	//
@@ -229,7 +284,14 @@ void MemOutputArchive::serialize_blob(const char*, const void* data, size_t len)
 	//
 	// Later I compared 'lzo' with 'snappy', lzo compresses 6-25% better,
 	// but 'snappy' is about twice as fast. So I switched to 'snappy'.
-	if (len >= SMALL_SIZE) {
+	//
+	// For reverse snapshots large blobs (RAM, VRAM, ...) are delta encoded
+	// against the previous snapshot, see DeltaBlock. When the owner of the
+	// blob tracks its writes, only the dirty pages need to be looked at.
+	if (deltaBlocks && (len >= DeltaBlock::PAGE_SIZE)) {
+		deltaBlocks->push_back(lastDeltaBlocks->createNew(
+			data, static_cast<const uint8_t*>(data), len, dirty));
+	} else if (len >= SMALL_SIZE) {
 		size_t dstLen = snappy::maxCompressedLength(len);
 		byte* buf = buffer.allocate(sizeof(dstLen) + dstLen);
 		snappy::compress(static_cast<const char*>(data), len,
@@ -245,7 +307,11 @@ void MemOutputArchive::serialize_blob(const char*, const void* data, size_t len)
 
 void MemInputArchive::serialize_blob(const char*, void* data, size_t len)
 {
-	if (len >= SMALL_SIZE) {
+	if (deltaBlocks && (len >= DeltaBlock::PAGE_SIZE)) {
+		assert(deltaBlockIdx < deltaBlocks->size());
+		(*deltaBlocks)[deltaBlockIdx++]->apply(
+			static_cast<uint8_t*>(data), len);
+	} else if (len >= SMALL_SIZE) {
 		size_t srcLen; load(srcLen);
 		snappy::uncompress(reinterpret_cast<const char*>(buffer.getCurrentPos()),
 		                   srcLen, reinterpret_cast<char*>(data), len);
@@ -258,6 +324,418 @@ void MemInputArchive::serialize_blob(const char*, void* data, size_t len)
 
 ////
 
+static const char BINARY_MAGIC[8] = { 'o', 'M', 'S', 'X', 'b', 'i', 'n', 0 };
+static const unsigned BINARY_CONTAINER_VERSION = 1;
+static const size_t SECTION_ALIGNMENT = 16;
+static const size_t BLOB_ALIGNMENT = 8;
+
+// blob encodings
+static const unsigned BLOB_RAW    = 0;
+static const unsigned BLOB_SNAPPY = 1;
+
+static void appendLE(std::vector<uint8_t>& buf, uint64_t v, int bytes)
+{
+	for (int i = 0; i < bytes; ++i) {
+		buf.push_back(uint8_t(v >> (8 * i)));
+	}
+}
+static uint64_t readLE(const uint8_t* p, int bytes)
+{
+	uint64_t result = 0;
+	for (int i = 0; i < bytes; ++i) {
+		result |= uint64_t(p[i]) << (8 * i);
+	}
+	return result;
+}
+
+// Blobs of at least this size are compressed on the worker pool (if one is
+// given). For smaller blobs the copy and the task overhead are not worth it.
+static const size_t PARALLEL_BLOB_SIZE = 64 * 1024;
+// Maximum number of blobs waiting for compression. Each of them holds a copy
+// of the original data: the owner may already be gone by the time the blob
+// gets compressed (e.g. the temporary machines of 'reverse savereplay').
+static const unsigned MAX_PENDING_BLOBS = 32;
+// The placeholder of a blob reference: the encoding (1 byte) followed by the
+// offset and the size, both as varints padded to 8 bytes (56 bits).
+static const int PADDED_VARINT_SIZE = 8;
+static const size_t PLACEHOLDER_SIZE = 1 + 2 * PADDED_VARINT_SIZE;
+
+static void writePaddedVarint(uint8_t* p, uint64_t v)
+{
+	assert(v < (uint64_t(1) << (7 * PADDED_VARINT_SIZE)));
+	for (int i = 0; i < PADDED_VARINT_SIZE - 1; ++i) {
+		p[i] = uint8_t(v | 0x80);
+		v >>= 7;
+	}
+	p[PADDED_VARINT_SIZE - 1] = uint8_t(v);
+}
+
+// Compress with snappy: the compression ratio is lower than zlib, but
+// decompression is many times faster and that's what matters most. The
+// result is appended to 'dst', returns the used encoding.
+static unsigned encodeBlob(const void* src, size_t len, std::vector<uint8_t>& dst)
+{
+	size_t offset = dst.size();
+	size_t dstLen = snappy::maxCompressedLength(len);
+	dst.resize(offset + dstLen);
+	snappy::compress(static_cast<const char*>(src), len,
+	                 reinterpret_cast<char*>(&dst[offset]), dstLen);
+	unsigned encoding = BLOB_SNAPPY;
+	if (dstLen >= len) {
+		memcpy(&dst[offset], src, len);
+		dstLen = len;
+		encoding = BLOB_RAW;
+	}
+	dst.resize(offset + dstLen);
+	return encoding;
+}
+
+struct BinaryOutputArchive::BlobJobs
+{
+	struct Job {
+		MemBuffer<uint8_t> input; // freed once compressed
+		size_t len;
+		std::vector<uint8_t> output;
+		unsigned encoding;
+		size_t placeholder; // position in 'data'
+	};
+	std::vector<std::unique_ptr<Job>> jobs; // in stream order
+	std::mutex mutex; // protects 'pending'
+	std::condition_variable jobDone;
+	unsigned pending = 0;
+};
+
+BinaryOutputArchive::BinaryOutputArchive(
+		const string& filename, ThreadPool* compressor_)
+	: compressor(compressor_)
+{
+	if (compressor) {
+		blobJobs = make_unique<BlobJobs>();
+	}
+	// Remove the old file instead of truncating it, it might still be
+	// memory mapped by a BinaryInputArchive (e.g. the not yet loaded
+	// snapshots of a replay). Errors are ignored, if the file can't be
+	// removed the constructor of File will complain.
+	FileOperations::unlink(filename);
+	file = make_unique<File>(filename, File::TRUNCATE);
+}
+
+BinaryOutputArchive::~BinaryOutputArchive()
+{
+	assert(openSections.empty());
+	finishBlobJobs();
+
+	StringOp::Builder info;
+	info << "openmsx_version" << '\0' << Version::full() << '\0'
+	     << "date_time" << '\0' << Date::toString(time(nullptr)) << '\0'
+	     << "platform" << '\0' << TARGET_PLATFORM << '\0';
+	string infoStr = info;
+
+	struct Section {
+		const char* name;
+		const uint8_t* data;
+		size_t size;
+	};
+	std::vector<Section> sections = {
+		{ "INFO", reinterpret_cast<const uint8_t*>(infoStr.data()), infoStr.size() },
+		{ "DATA", data.data(), data.size() },
+		{ "BLOB", blobs.data(), blobs.size() },
+	};
+	for (auto& extra : extraSections) {
+		sections.push_back({extra.first.data(), extra.second.data(),
+		                    extra.second.size()});
+	}
+	auto NUM_SECTIONS = unsigned(sections.size());
+	auto align = [](size_t x) {
+		return (x + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+	};
+
+	std::vector<uint8_t> header(BINARY_MAGIC, BINARY_MAGIC + sizeof(BINARY_MAGIC));
+	appendLE(header, BINARY_CONTAINER_VERSION, 4);
+	appendLE(header, NUM_SECTIONS, 4);
+	size_t offset = align(header.size() + NUM_SECTIONS * (4 + 8 + 8));
+	for (auto& sec : sections) {
+		header.insert(header.end(), sec.name, sec.name + 4);
+		appendLE(header, offset, 8);
+		appendLE(header, sec.size, 8);
+		offset = align(offset + sec.size);
+	}
+
+	// Like XmlOutputArchive, errors while writing are ignored (can't
+	// throw from a destructor).
+	try {
+		static const uint8_t zeros[SECTION_ALIGNMENT] = {};
+		file->write(header.data(), header.size());
+		size_t pos = header.size();
+		for (auto& sec : sections) {
+			file->write(zeros, align(pos) - pos);
+			file->write(sec.data, sec.size);
+			pos = align(pos) + sec.size;
+		}
+	} catch (MSXException&) {
+		// ignore
+	}
+}
+
+uint64_t BinaryOutputArchive::encode(float f)
+{
+	uint32_t i;
+	memcpy(&i, &f, sizeof(i));
+	return i;
+}
+uint64_t BinaryOutputArchive::encode(double d)
+{
+	uint64_t i;
+	memcpy(&i, &d, sizeof(i));
+	return i;
+}
+
+void BinaryOutputArchive::saveVarint(uint64_t v)
+{
+	while (v >= 0x80) {
+		data.push_back(uint8_t(v | 0x80));
+		v >>= 7;
+	}
+	data.push_back(uint8_t(v));
+}
+
+void BinaryOutputArchive::save(const string& s)
+{
+	saveVarint(s.size());
+	data.insert(data.end(), s.begin(), s.end());
+}
+
+void BinaryOutputArchive::serialize_blob(const char*, const void* data_, size_t len)
+{
+	if (!compressor || (len < PARALLEL_BLOB_SIZE)) {
+		blobs.resize((blobs.size() + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1));
+		size_t offset = blobs.size();
+		unsigned encoding = encodeBlob(data_, len, blobs);
+		saveVarint(encoding);
+		saveVarint(offset);
+		saveVarint(blobs.size() - offset);
+		return;
+	}
+
+	// Compress on the worker pool, reserve a placeholder in the stream
+	// that's filled in by finishBlobJobs().
+	auto& bj = *blobJobs;
+	{
+		std::unique_lock<std::mutex> lock(bj.mutex);
+		bj.jobDone.wait(lock, [&] { return bj.pending < MAX_PENDING_BLOBS; });
+		++bj.pending;
+	}
+	auto job = make_unique<BlobJobs::Job>();
+	job->input.resize(len);
+	memcpy(job->input.data(), data_, len);
+	job->len = len;
+	job->encoding = BLOB_RAW;
+	job->placeholder = data.size();
+	data.insert(data.end(), PLACEHOLDER_SIZE, 0);
+
+	auto* j = job.get();
+	bj.jobs.push_back(std::move(job));
+	compressor->addTask([&bj, j] {
+		j->encoding = encodeBlob(j->input.data(), j->len, j->output);
+		j->input.clear();
+		std::lock_guard<std::mutex> lock(bj.mutex);
+		--bj.pending;
+		bj.jobDone.notify_all();
+	});
+}
+
+void BinaryOutputArchive::finishBlobJobs()
+{
+	if (!blobJobs) return;
+	auto& bj = *blobJobs;
+	{
+		std::unique_lock<std::mutex> lock(bj.mutex);
+		bj.jobDone.wait(lock, [&] { return bj.pending == 0; });
+	}
+	for (auto& job : bj.jobs) {
+		blobs.resize((blobs.size() + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1));
+		size_t offset = blobs.size();
+		blobs.insert(blobs.end(), job->output.begin(), job->output.end());
+
+		uint8_t* p = &data[job->placeholder];
+		p[0] = uint8_t(job->encoding);
+		writePaddedVarint(p + 1, offset);
+		writePaddedVarint(p + 1 + PADDED_VARINT_SIZE, job->output.size());
+	}
+	bj.jobs.clear();
+}
+
+void BinaryOutputArchive::beginSection()
+{
+	// fixed size, so that it can be filled in later
+	openSections.push_back(data.size());
+	appendLE(data, 0, 8);
+}
+
+void BinaryOutputArchive::addSection(const char* name, std::vector<uint8_t> content)
+{
+	assert(strlen(name) == 4);
+	extraSections.emplace_back(name, std::move(content));
+}
+
+void BinaryOutputArchive::endSection()
+{
+	assert(!openSections.empty());
+	size_t beginPos = openSections.back();
+	openSections.pop_back();
+	uint64_t skip = data.size() - (beginPos + 8);
+	for (int i = 0; i < 8; ++i) {
+		data[beginPos + i] = uint8_t(skip >> (8 * i));
+	}
+}
+
+////
+
+static void binaryFormatError()
+{
+	throw MSXException("Corrupt binary savestate file.");
+}
+
+BinaryInputArchive::BinaryInputArchive(const string& filename)
+	: BinaryInputArchive(std::make_shared<File>(filename))
+{
+}
+
+BinaryInputArchive::BinaryInputArchive(std::shared_ptr<File> file_, size_t position)
+	: file(std::move(file_))
+{
+	base = file->mmap(fileSize);
+	if ((fileSize < 16) ||
+	    (memcmp(base, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0)) {
+		binaryFormatError();
+	}
+	auto version = readLE(base + 8, 4);
+	if (version > BINARY_CONTAINER_VERSION) {
+		throw MSXException(StringOp::Builder() <<
+			"Binary savestate file has version " << version <<
+			", while this openMSX installation only supports up to "
+			"version " << BINARY_CONTAINER_VERSION << '.');
+	}
+	numSections = unsigned(readLE(base + 12, 4));
+	if (numSections > (fileSize - 16) / 20) binaryFormatError();
+
+	size_t dataSize;
+	if (!getSection("DATA", data, dataSize)) binaryFormatError();
+	if (position > dataSize) binaryFormatError();
+	dataEnd = data + dataSize;
+	data += position;
+	if (!getSection("BLOB", blobs, blobsSize)) {
+		blobs = nullptr;
+		blobsSize = 0;
+	}
+	// other sections (e.g. "INFO") are ignored
+}
+
+bool BinaryInputArchive::getSection(
+	const char* name, const uint8_t*& sectionData, size_t& sectionSize) const
+{
+	for (unsigned i = 0; i < numSections; ++i) {
+		const uint8_t* entry = base + 16 + 20 * i;
+		if (memcmp(entry, name, 4) != 0) continue;
+		auto offset  = readLE(entry + 4,  8);
+		auto secSize = readLE(entry + 12, 8);
+		if ((offset > fileSize) || (secSize > (fileSize - offset))) {
+			binaryFormatError();
+		}
+		sectionData = base + offset;
+		sectionSize = secSize;
+		return true;
+	}
+	return false;
+}
+
+BinaryInputArchive::~BinaryInputArchive()
+{
+}
+
+bool BinaryInputArchive::isBinaryArchive(const string& filename)
+{
+	File f(filename);
+	if (f.getSize() < sizeof(BINARY_MAGIC)) return false;
+	char buf[sizeof(BINARY_MAGIC)];
+	f.read(buf, sizeof(buf));
+	return memcmp(buf, BINARY_MAGIC, sizeof(buf)) == 0;
+}
+
+void BinaryInputArchive::decode(uint64_t v, float& f)
+{
+	auto i = uint32_t(v);
+	memcpy(&f, &i, sizeof(f));
+}
+void BinaryInputArchive::decode(uint64_t v, double& d)
+{
+	memcpy(&d, &v, sizeof(d));
+}
+
+const uint8_t* BinaryInputArchive::get(size_t len)
+{
+	if (len > size_t(dataEnd - data)) binaryFormatError();
+	auto* result = data;
+	data += len;
+	return result;
+}
+
+uint64_t BinaryInputArchive::loadVarint()
+{
+	uint64_t result = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		uint8_t b = *get(1);
+		result |= uint64_t(b & 0x7F) << shift;
+		if (!(b & 0x80)) return result;
+	}
+	binaryFormatError();
+	return 0; // not reached
+}
+
+void BinaryInputArchive::load(string& s)
+{
+	s = loadStr().str();
+}
+
+string_ref BinaryInputArchive::loadStr()
+{
+	size_t length = loadVarint();
+	auto* p = get(length);
+	return string_ref(reinterpret_cast<const char*>(p), length);
+}
+
+void BinaryInputArchive::serialize_blob(const char*, void* data_, size_t len)
+{
+	auto encoding = loadVarint();
+	auto offset   = loadVarint();
+	auto srcLen   = loadVarint();
+	if ((offset > blobsSize) || (srcLen > (blobsSize - offset))) {
+		binaryFormatError();
+	}
+	const auto* src = blobs + offset;
+	if (encoding == BLOB_RAW) {
+		if (srcLen != len) binaryFormatError();
+		memcpy(data_, src, len);
+	} else if (encoding == BLOB_SNAPPY) {
+		// the file may be corrupt, so use the checked decoder
+		if (!snappy::uncompressChecked(
+				reinterpret_cast<const char*>(src), srcLen,
+				static_cast<char*>(data_), len)) {
+			binaryFormatError();
+		}
+	} else {
+		throw MSXException("Unsupported blob encoding in binary savestate.");
+	}
+}
+
+void BinaryInputArchive::skipSection(bool skip)
+{
+	auto num = readLE(get(8), 8);
+	if (skip) get(num);
+}
+
+////
+
 XmlOutputArchive::XmlOutputArchive(const string& filename)
 	: root("serial")
 {
@@ -5,8 +5,10 @@
 #include "SerializeBuffer.hh"
 #include "XMLElement.hh"
 #include "MemBuffer.hh"
+#include "DirtyPages.hh"
 #include "StringOp.hh"
 #include "inline.hh"
+#include "likely.hh"
 #include "unreachable.hh"
 #include <zlib.h>
 #include <string>
@@ -20,6 +22,11 @@
 
 namespace openmsx {
 
+class DeltaBlock;
+class LastDeltaBlocks;
+class SerializeProfile;
+class File;
+class ThreadPool;
 template<typename T> struct SerializeClassVersion;
 
 // In this section, the archive classes are defined.
@@ -37,6 +44,13 @@ template<typename T> struct SerializeClassVersion;
 //      (e.g. integers are stored using native platform endianess).
 //      The main use case for this archive format is regular in memory
 //      snapshots, for example to support replay/rewind.
+//   - Binary
+//      Stores the stream in a compact binary file. Like XML there is version
+//      information in the stream and the files are portable (integers are
+//      stored in a variable length little endian encoding), but loading and
+//      saving is a lot faster and the files are smaller. Blobs are
+//      compressed individually and stored in a separate section of the file
+//      (see BinaryOutputArchive for the file layout).
 //   - XML
 //      Stores the stream in a XML file. These files are meant to be portable
 //      to different architectures (e.g. little/big endian, 32/64 bit system).
@@ -130,6 +144,13 @@ public:
 	//   or as a collection of bytes (IOW we cannot decide it based on the
 	//   type).
 	//
+	// void serialize_blob(const char* tag, const void* data, size_t len,
+	//                     DirtyPages& dirty)
+	//
+	//   Same as above, but 'dirty' records which pages of the blob were
+	//   written since the previous reverse snapshot. Saving in a reverse
+	//   snapshot uses (and resets) it, loading marks the whole blob dirty.
+	//
 	//
 	// template<typename T> void serialize(const char* tag, const T& t)
 	//
@@ -386,6 +407,12 @@ public:
 		}
 	}
 
+	// Forget all generated IDs. Objects serialized after this point
+	// can't refer to objects serialized before it, so that part of the
+	// stream can be loaded on its own. (This also allows to serialize
+	// an object that reuses the address of an already destroyed one.)
+	void resetIds();
+
 protected:
 	OutputArchiveBase2();
 
@@ -431,6 +458,11 @@ public:
 	// Default implementation is to base64-encode the blob and serialize
 	// the resulting string. But memory archives will memcpy the blob.
 	void serialize_blob(const char* tag, const void* data, size_t len);
+	void serialize_blob(const char* tag, const void* data, size_t len,
+	                    DirtyPages& /*dirty*/)
+	{
+		this->self().serialize_blob(tag, data, len);
+	}
 
 	template<typename T> void serialize(const char* tag, const T& t)
 	{
@@ -525,6 +557,12 @@ public:
 		doSerialize(tag, t, std::tuple<Args...>(args...));
 	}
 	void serialize_blob(const char* tag, void* data, size_t len);
+	void serialize_blob(const char* tag, void* data, size_t len,
+	                    DirtyPages& dirty)
+	{
+		this->self().serialize_blob(tag, data, len);
+		dirty.markAll();
+	}
 
 	template<typename T>
 	void serialize(const char* tag, T& t)
@@ -588,9 +626,47 @@ class MemOutputArchive final : public OutputArchiveBase<MemOutputArchive>
 {
 public:
 	MemOutputArchive()
+		: lastDeltaBlocks(nullptr)
+		, deltaBlocks(nullptr)
+		, profile(nullptr)
+		, omitNextType(false)
+		, omittedType(nullptr)
+	{
+	}
+
+	/** Large blobs are not stored in the buffer, instead a DeltaBlock is
+	  * created (relative to the previous snapshot) and appended to
+	  * 'deltaBlocks'. Use MemInputArchive with the same vector to restore.
+	  */
+	MemOutputArchive(LastDeltaBlocks& lastDeltaBlocks_,
+	                 std::vector<std::shared_ptr<DeltaBlock>>& deltaBlocks_)
+		: lastDeltaBlocks(&lastDeltaBlocks_)
+		, deltaBlocks(&deltaBlocks_)
+		, profile(nullptr)
+		, omitNextType(false)
+		, omittedType(nullptr)
+	{
+	}
+
+	/** A small archive that is meant to be reused (see clear()), e.g. for
+	  * serializing many small objects one by one. The buffer starts with
+	  * the given capacity (instead of an estimate based on the previous
+	  * snapshots).
+	  */
+	explicit MemOutputArchive(size_t initialSize)
+		: buffer(initialSize)
+		, lastDeltaBlocks(nullptr)
+		, deltaBlocks(nullptr)
+		, profile(nullptr)
+		, omitNextType(false)
+		, omittedType(nullptr)
 	{
 	}
 
+	/** Measure the size and serialization time of the individual
+	  * objects, see SerializeProfile. */
+	void setProfile(SerializeProfile* profile_) { profile = profile_; }
+
 	~MemOutputArchive()
 	{
 		assert(openSections.empty());
@@ -608,6 +684,8 @@ public:
 	}
 	void save(const std::string& s);
 	void serialize_blob(const char*, const void* data, size_t len);
+	void serialize_blob(const char*, const void* data, size_t len,
+	                    DirtyPages& dirty);
 
 	void beginSection()
 	{
@@ -629,6 +707,51 @@ public:
 
 	MemBuffer<byte> releaseBuffer(size_t& size);
 
+	/** Access the serialized data without releasing the buffer. */
+	const byte* getData() const { return buffer.getData(); }
+	size_t getSize() const { return buffer.getPosition(); }
+	/** Remove the serialized data (and forget the generated IDs), but
+	  * keep the buffer for the next object. */
+	void clear()
+	{
+		assert(openSections.empty());
+		buffer.clear();
+		resetIds();
+	}
+
+	/** Don't store the type name of the next (outermost) polymorphic
+	  * object. Instead the caller must remember it, see getOmittedType(),
+	  * and pass it again to MemInputArchive::setType() when loading.
+	  */
+	void omitType()
+	{
+		omitNextType = true;
+		omittedType = nullptr;
+	}
+	const char* getOmittedType() const { return omittedType; }
+
+//internal:
+	using OutputArchiveBase<MemOutputArchive>::attribute;
+	void attribute(const char* name, const char* value)
+	{
+		if (unlikely(omitNextType)) {
+			// this is the type of a polymorphic object
+			omitNextType = false;
+			omittedType = value;
+		} else {
+			OutputArchiveBase<MemOutputArchive>::attribute(name, value);
+		}
+	}
+
+	void beginTag(const char* tag)
+	{
+		if (unlikely(profile != nullptr)) profileBeginTag(tag);
+	}
+	void endTag(const char* /*tag*/)
+	{
+		if (unlikely(profile != nullptr)) profileEndTag();
+	}
+
 private:
 	void put(const void* data, size_t len)
 	{
@@ -636,19 +759,38 @@ private:
 			buffer.insert(data, len);
 		}
 	}
+	void profileBeginTag(const char* tag);
+	void profileEndTag();
+	void serializeBlobImpl(const char* tag, const void* data, size_t len,
+	                       DirtyPages* dirty);
+	void storeBlob(const void* data, size_t len, DirtyPages* dirty);
 
 	OutputBuffer buffer;
 	std::vector<size_t> openSections;
+	LastDeltaBlocks* lastDeltaBlocks;
+	std::vector<std::shared_ptr<DeltaBlock>>* deltaBlocks;
+	SerializeProfile* profile;
+	bool omitNextType;
+	const char* omittedType;
 };
 
 class MemInputArchive final : public InputArchiveBase<MemInputArchive>
 {
 public:
-	MemInputArchive(const byte* data, size_t size)
+	MemInputArchive(const byte* data, size_t size,
+	                const std::vector<std::shared_ptr<DeltaBlock>>* deltaBlocks_ = nullptr)
 		: buffer(data, size)
+		, deltaBlocks(deltaBlocks_)
+		, deltaBlockIdx(0)
+		, givenType(nullptr)
 	{
 	}
 
+	/** Counterpart of MemOutputArchive::omitType(): the data doesn't
+	  * contain the type name of the next polymorphic object, use the
+	  * given name instead. */
+	void setType(const char* type) { givenType = type; }
+
 	bool needVersion() const { return false; }
 	inline bool versionAtLeast(unsigned /*actual*/, unsigned /*required*/) const
 	{
@@ -669,8 +811,21 @@ public:
 	}
 	void load(std::string& s);
 	string_ref loadStr();
+	using InputArchiveBase<MemInputArchive>::serialize_blob;
 	void serialize_blob(const char*, void* data, size_t len);
 
+	using InputArchiveBase<MemInputArchive>::attribute;
+	void attribute(const char* name, std::string& t)
+	{
+		if (unlikely(givenType != nullptr)) {
+			// this is the type of a polymorphic object
+			t = givenType;
+			givenType = nullptr;
+		} else {
+			InputArchiveBase<MemInputArchive>::attribute(name, t);
+		}
+	}
+
 	void skipSection(bool skip)
 	{
 		size_t num;
@@ -689,6 +844,182 @@ private:
 	}
 
 	InputBuffer buffer;
+	const std::vector<std::shared_ptr<DeltaBlock>>* deltaBlocks;
+	size_t deltaBlockIdx;
+	const char* givenType;
+};
+
+////
+
+/** Layout of the binary savestate files:
+  *
+  *   header:  8 bytes      magic "oMSXbin\0"
+  *            4 bytes      container version (1)
+  *            4 bytes      number of sections N
+  *   section table, N times:
+  *            4 bytes      name ("INFO", "DATA" or "BLOB")
+  *            8 bytes      offset of the section (from start of file)
+  *            8 bytes      size of the section
+  *   sections (each one 16-byte aligned)
+  *
+  * All fixed size fields are little endian. The INFO section contains
+  * zero-terminated key/value strings (openMSX version, date, platform). The
+  * DATA section is the serialized stream itself. Each blob in the stream only
+  * refers to a (8-byte aligned) location in the BLOB section, so the file can
+  * be mmap()ed and every blob can be decompressed directly from that
+  * location, independent of the others.
+  *
+  * Large blobs can be compressed in parallel: the reference in the DATA
+  * section is then written as a placeholder (varints padded to a fixed
+  * length) and filled in once the compressed blob is placed in the BLOB
+  * section.
+  */
+class BinaryOutputArchive final : public OutputArchiveBase<BinaryOutputArchive>
+{
+public:
+	/** @param compressor When not null, large blobs are compressed in
+	  *                   parallel by this pool. */
+	explicit BinaryOutputArchive(const std::string& filename,
+	                             ThreadPool* compressor = nullptr);
+	~BinaryOutputArchive();
+
+	template<typename T> void save(const T& t)
+	{
+		static_assert(std::is_arithmetic<T>::value,
+		              "only arithmetic types and strings");
+		saveVarint(encode(t));
+	}
+	inline void saveChar(char c)
+	{
+		save(c);
+	}
+	void save(const std::string& s);
+	using OutputArchiveBase<BinaryOutputArchive>::serialize_blob;
+	void serialize_blob(const char*, const void* data, size_t len);
+
+	void beginSection();
+	void endSection();
+
+	/** Current position in the DATA section. A BinaryInputArchive can
+	  * later start loading from this position (as long as the stream from
+	  * there on doesn't refer back to objects serialized before it). */
+	size_t getPosition() const { return data.size(); }
+
+	/** Store an additional section in the file (e.g. an index into the
+	  * DATA section). The name must be 4 characters long. */
+	void addSection(const char* name, std::vector<uint8_t> content);
+
+//internal:
+	inline bool translateEnumToString() const { return true; }
+
+private:
+	template<typename T> static typename std::enable_if<
+		std::is_integral<T>::value && std::is_signed<T>::value, uint64_t>::type
+	encode(T t)
+	{
+		// zigzag encoding, keeps small negative numbers small
+		auto i = int64_t(t);
+		return (uint64_t(i) << 1) ^ uint64_t(i >> 63);
+	}
+	template<typename T> static typename std::enable_if<
+		std::is_integral<T>::value && !std::is_signed<T>::value, uint64_t>::type
+	encode(T t)
+	{
+		return uint64_t(t);
+	}
+	static uint64_t encode(char c) { return uint8_t(c); } // signedness differs per platform
+	static uint64_t encode(float f);
+	static uint64_t encode(double d);
+	void saveVarint(uint64_t v);
+	void finishBlobJobs();
+
+	std::unique_ptr<File> file;
+	std::vector<uint8_t> data;
+	std::vector<uint8_t> blobs;
+	ThreadPool* compressor;
+	struct BlobJobs;
+	std::unique_ptr<BlobJobs> blobJobs;
+	std::vector<size_t> openSections;
+	std::vector<std::pair<std::string, std::vector<uint8_t>>> extraSections;
+};
+
+class BinaryInputArchive final : public InputArchiveBase<BinaryInputArchive>
+{
+public:
+	explicit BinaryInputArchive(const std::string& filename);
+	/** Load from an already opened file, starting at the given position
+	  * in the DATA section (see BinaryOutputArchive::getPosition()). */
+	explicit BinaryInputArchive(std::shared_ptr<File> file,
+	                            size_t position = 0);
+	~BinaryInputArchive();
+
+	/** Does the given file start with the magic of a binary archive? */
+	static bool isBinaryArchive(const std::string& filename);
+
+	/** Locate a section in the file (see BinaryOutputArchive::addSection()).
+	  * Returns false when there's no such section. The returned data stays
+	  * valid as long as the File object is alive. */
+	bool getSection(const char* name, const uint8_t*& sectionData,
+	                size_t& sectionSize) const;
+
+	const std::shared_ptr<File>& getFile() const { return file; }
+
+	inline bool versionAtLeast(unsigned actual, unsigned required) const
+	{
+		return actual >= required;
+	}
+	inline bool versionBelow(unsigned actual, unsigned required) const
+	{
+		return actual < required;
+	}
+
+	template<typename T> void load(T& t)
+	{
+		static_assert(std::is_arithmetic<T>::value,
+		              "only arithmetic types and strings");
+		decode(loadVarint(), t);
+	}
+	inline void loadChar(char& c)
+	{
+		load(c);
+	}
+	void load(std::string& s);
+	string_ref loadStr();
+	using InputArchiveBase<BinaryInputArchive>::serialize_blob;
+	void serialize_blob(const char*, void* data, size_t len);
+
+	void skipSection(bool skip);
+
+//internal:
+	inline bool translateEnumToString() const { return true; }
+
+private:
+	template<typename T> static typename std::enable_if<
+		std::is_integral<T>::value && std::is_signed<T>::value>::type
+	decode(uint64_t v, T& t)
+	{
+		t = T(int64_t(v >> 1) ^ -int64_t(v & 1));
+	}
+	template<typename T> static typename std::enable_if<
+		std::is_integral<T>::value && !std::is_signed<T>::value>::type
+	decode(uint64_t v, T& t)
+	{
+		t = T(v);
+	}
+	static void decode(uint64_t v, char& c) { c = char(uint8_t(v)); }
+	static void decode(uint64_t v, float& f);
+	static void decode(uint64_t v, double& d);
+	uint64_t loadVarint();
+	const uint8_t* get(size_t len);
+
+	std::shared_ptr<File> file;
+	const uint8_t* base;
+	size_t fileSize;
+	unsigned numSections;
+	const uint8_t* data;
+	const uint8_t* dataEnd;
+	const uint8_t* blobs;
+	size_t blobsSize;
 };
 
 ////
@@ -817,6 +1148,8 @@ private:
 #define INSTANTIATE_SERIALIZE_METHODS(CLASS) \
 template void CLASS::serialize(MemInputArchive&,   unsigned); \
 template void CLASS::serialize(MemOutputArchive&,  unsigned); \
+template void CLASS::serialize(BinaryInputArchive&,  unsigned); \
+template void CLASS::serialize(BinaryOutputArchive&, unsigned); \
 template void CLASS::serialize(XmlInputArchive&,   unsigned); \
 template void CLASS::serialize(XmlOutputArchive&,  unsigned);
 
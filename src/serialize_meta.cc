@@ -66,6 +66,7 @@ void PolymorphicSaverRegistry<Archive>::save(
 }
 
 template class PolymorphicSaverRegistry<MemOutputArchive>;
+template class PolymorphicSaverRegistry<BinaryOutputArchive>;
 template class PolymorphicSaverRegistry<XmlOutputArchive>;
 
 ////
@@ -109,6 +110,7 @@ void* PolymorphicLoaderRegistry<Archive>::load(
 }
 
 template class PolymorphicLoaderRegistry<MemInputArchive>;
+template class PolymorphicLoaderRegistry<BinaryInputArchive>;
 template class PolymorphicLoaderRegistry<XmlInputArchive>;
 
 ////
@@ -165,6 +167,7 @@ void PolymorphicInitializerRegistry<Archive>::init(
 }
 
 template class PolymorphicInitializerRegistry<MemInputArchive>;
+template class PolymorphicInitializerRegistry<BinaryInputArchive>;
 template class PolymorphicInitializerRegistry<XmlInputArchive>;
 
 } // namespace openmsx
@@ -354,6 +354,8 @@ template<> struct PolymorphicConstructorArgs<C> \
 
 class MemInputArchive;
 class MemOutputArchive;
+class BinaryInputArchive;
+class BinaryOutputArchive;
 class XmlInputArchive;
 class XmlOutputArchive;
 
@@ -369,16 +371,20 @@ static RegisterSaverHelper <MemOutputArchive,  C> registerHelper6##C(N); \*/
 static_assert(std::is_base_of<B,C>::value, "must be base and sub class"); \
 static RegisterLoaderHelper<MemInputArchive,  C> registerHelper3##C(N); \
 static RegisterSaverHelper <MemOutputArchive, C> registerHelper4##C(N); \
-static RegisterLoaderHelper<XmlInputArchive,  C> registerHelper5##C(N); \
-static RegisterSaverHelper <XmlOutputArchive, C> registerHelper6##C(N); \
+static RegisterLoaderHelper<BinaryInputArchive,  C> registerHelper5##C(N); \
+static RegisterSaverHelper <BinaryOutputArchive, C> registerHelper6##C(N); \
+static RegisterLoaderHelper<XmlInputArchive,  C> registerHelper7##C(N); \
+static RegisterSaverHelper <XmlOutputArchive, C> registerHelper8##C(N); \
 template<> struct PolymorphicBaseClass<C> { using type = B; };
 
 #define REGISTER_POLYMORPHIC_INITIALIZER_HELPER(B,C,N) \
 static_assert(std::is_base_of<B,C>::value, "must be base and sub class"); \
 static RegisterInitializerHelper<MemInputArchive,  C> registerHelper3##C(N); \
 static RegisterSaverHelper      <MemOutputArchive, C> registerHelper4##C(N); \
-static RegisterInitializerHelper<XmlInputArchive,  C> registerHelper5##C(N); \
-static RegisterSaverHelper      <XmlOutputArchive, C> registerHelper6##C(N); \
+static RegisterInitializerHelper<BinaryInputArchive,  C> registerHelper5##C(N); \
+static RegisterSaverHelper      <BinaryOutputArchive, C> registerHelper6##C(N); \
+static RegisterInitializerHelper<XmlInputArchive,  C> registerHelper7##C(N); \
+static RegisterSaverHelper      <XmlOutputArchive, C> registerHelper8##C(N); \
 template<> struct PolymorphicBaseClass<C> { using type = B; };
 
 #define REGISTER_BASE_NAME_HELPER(B,N) \
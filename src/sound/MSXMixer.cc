@@ -13,6 +13,7 @@
 #include "AviRecorder.hh"
 #include "Filename.hh"
 #include "CliComm.hh"
+#include "HostTimeProfile.hh"
 #include "Math.hh"
 #include "StringOp.hh"
 #include "memory.hh"
@@ -170,13 +171,15 @@ void MSXMixer::updateStream(EmuTime::param time)
 #endif
 	};
 
+	HostTimeProfile::Scope profile(HostTimeProfile::SOUND);
 	unsigned count = prevTime.getTicksTill(time);
 	assert(count <= 8192);
 
 	// call generate() even if count==0 and even if muted
 	generate(mixBuffer, time, count);
 
-	if (!muteCount && fragmentSize) {
+	if (!muteCount && fragmentSize && motherBoard.isActive()) {
+		// only the active machine is audible
 		mixer.uploadBuffer(*this, mixBuffer, count);
 	}
 
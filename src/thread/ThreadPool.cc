@@ -0,0 +1,67 @@
+#include "ThreadPool.hh"
+#include "memory.hh"
+#include <cassert>
+
+namespace openmsx {
+
+ThreadPool::ThreadPool(unsigned numThreads)
+	: busy(0)
+	, stopping(false)
+{
+	assert(numThreads > 0);
+	for (unsigned i = 0; i < numThreads; ++i) {
+		threads.push_back(make_unique<Thread>(static_cast<Runnable*>(this)));
+		threads.back()->start();
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		tasks.clear();
+	}
+	taskCondition.notify_all();
+	for (auto& t : threads) {
+		t->join();
+	}
+}
+
+void ThreadPool::addTask(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	taskCondition.notify_one();
+}
+
+void ThreadPool::waitIdle()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idleCondition.wait(lock, [&] { return tasks.empty() && (busy == 0); });
+}
+
+void ThreadPool::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		taskCondition.wait(lock, [&] { return stopping || !tasks.empty(); });
+		if (stopping) return;
+
+		auto task = std::move(tasks.front());
+		tasks.pop_front();
+		++busy;
+		lock.unlock();
+		task();
+		task = nullptr; // destroy captured objects outside the lock
+		lock.lock();
+		--busy;
+		if (tasks.empty() && (busy == 0)) {
+			idleCondition.notify_all();
+		}
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,49 @@
+#ifndef THREADPOOL_HH
+#define THREADPOOL_HH
+
+#include "Thread.hh"
+#include <functional>
+#include <condition_variable>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <memory>
+
+namespace openmsx {
+
+/** A fixed number of worker threads that execute tasks from a shared queue.
+  *
+  * Tasks are executed in the order they were added, but (with more than one
+  * thread) several tasks can run at the same time. Tasks should not throw.
+  */
+class ThreadPool final : private Runnable
+{
+public:
+	explicit ThreadPool(unsigned numThreads);
+
+	/** Tasks that didn't start yet are discarded, running tasks are
+	  * finished. */
+	~ThreadPool();
+
+	/** Queue a task, it will be executed by one of the worker threads.
+	  * Can be called from any thread (also from a task). */
+	void addTask(std::function<void()> task);
+
+	/** Blocks until all tasks that were added so far are finished. */
+	void waitIdle();
+
+private:
+	void run() override;
+
+	std::vector<std::unique_ptr<Thread>> threads;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex; // protects 'tasks', 'busy' and 'stopping'
+	std::condition_variable taskCondition;
+	std::condition_variable idleCondition;
+	unsigned busy; // number of tasks currently executing
+	bool stopping;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,23 @@
+#include "HostCPU.hh"
+
+namespace openmsx {
+
+static bool detectAVX2()
+{
+#if ASM_AVX2
+	// Also checks that the OS saves the AVX registers.
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+bool HostCPU::avx2 = detectAVX2();
+
+void HostCPU::enableAVX2(bool enable)
+{
+	avx2 = enable && detectAVX2();
+}
+
+} // namespace openmsx
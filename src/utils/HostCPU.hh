@@ -0,0 +1,41 @@
+#ifndef HOSTCPU_HH
+#define HOSTCPU_HH
+
+// The pixel routines are selected at compile time (e.g. SSE2 on x86), so a
+// binary runs on every CPU of the target architecture. A few of the hottest
+// routines also have an AVX2 variant that is selected at run time. That
+// requires a compiler that can generate code for another instruction set
+// per function (and that has the AVX2 intrinsics available in such a
+// function).
+#if defined(__SSE2__) && !defined(_MSC_VER) && \
+    (defined(__clang__) || (__GNUC__ > 4) || \
+     ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+#define ASM_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ASM_AVX2 0
+#define TARGET_AVX2
+#endif
+
+namespace openmsx {
+
+/** Instruction set extensions of the host CPU that are detected at run time.
+  */
+class HostCPU
+{
+public:
+	/** Should the AVX2 variants of the pixel routines be used? */
+	static bool hasAVX2() { return avx2; }
+
+	/** Only meant to compare the speed of the different variants: disable
+	  * the AVX2 variants (or enable them again when the CPU supports it).
+	  */
+	static void enableAVX2(bool enable);
+
+private:
+	static bool avx2;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,59 @@
+#include "HostTimeProfile.hh"
+#include <chrono>
+#include <cassert>
+
+namespace openmsx {
+
+using Clock = std::chrono::steady_clock;
+
+bool HostTimeProfile::enabled = false;
+static HostTimeProfile::Category current = HostTimeProfile::OTHER;
+static Clock::time_point last;
+static Clock::duration totals[HostTimeProfile::NUM_CATEGORIES];
+
+void HostTimeProfile::start()
+{
+	for (auto& t : totals) t = Clock::duration::zero();
+	current = OTHER;
+	last = Clock::now();
+	enabled = true;
+}
+
+void HostTimeProfile::stop()
+{
+	if (!enabled) return;
+	switchTo(OTHER);
+	enabled = false;
+}
+
+HostTimeProfile::Category HostTimeProfile::switchTo(Category c)
+{
+	// Scopes that were entered before stop() still restore their previous
+	// category, but no longer accumulate time.
+	if (enabled) {
+		auto now = Clock::now();
+		totals[current] += now - last;
+		last = now;
+	}
+	auto prev = current;
+	current = c;
+	return prev;
+}
+
+uint64_t HostTimeProfile::get(Category c)
+{
+	assert(c < NUM_CATEGORIES);
+	using namespace std::chrono;
+	return duration_cast<microseconds>(totals[c]).count();
+}
+
+const char* HostTimeProfile::getName(Category c)
+{
+	static const char* const names[NUM_CATEGORIES] = {
+		"other", "cpu", "scheduler", "vdp", "postprocess", "sound", "tcl"
+	};
+	assert(c < NUM_CATEGORIES);
+	return names[c];
+}
+
+} // namespace openmsx
@@ -0,0 +1,70 @@
+#ifndef HOSTTIMEPROFILE_HH
+#define HOSTTIMEPROFILE_HH
+
+#include "likely.hh"
+#include <cstdint>
+
+namespace openmsx {
+
+/** Coarse breakdown of where the host time goes, used by the 'benchmark'
+  * command.
+  *
+  * At each moment exactly one category is 'current', all host time is
+  * charged to that category. A Scope temporarily makes another category
+  * current, so nested scopes give exclusive times (e.g. sound generation
+  * triggered from a sync point is not also counted as scheduler time).
+  *
+  * When disabled (the default) a Scope only costs a test of a global flag.
+  */
+class HostTimeProfile
+{
+public:
+	enum Category {
+		OTHER,        // main loop, event handling, ...
+		CPU,          // CPU emulation (MSXMotherBoard::execute())
+		SCHEDULER,    // sync point callbacks not listed below
+		VDP,          // VDP rendering
+		POSTPROCESS,  // scaling, post-processing and displaying a frame
+		SOUND,        // sound generation
+		TCL,          // Tcl commands and callbacks
+		NUM_CATEGORIES
+	};
+
+	class Scope
+	{
+	public:
+		explicit Scope(Category c)
+			: active(enabled)
+		{
+			if (unlikely(active)) prev = switchTo(c);
+		}
+		~Scope()
+		{
+			if (unlikely(active)) switchTo(prev);
+		}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		Category prev;
+		bool active;
+	};
+
+	/** Reset all counters and start measuring. */
+	static void start();
+	/** Stop measuring, counters keep their value. */
+	static void stop();
+	static bool isEnabled() { return enabled; }
+
+	/** Host time (in us) charged to the given category. */
+	static uint64_t get(Category c);
+	static const char* getName(Category c);
+
+private:
+	static Category switchTo(Category c);
+
+	static bool enabled;
+};
+
+} // namespace openmsx
+
+#endif
@@ -13,6 +13,7 @@ OutputBuffer::OutputBuffer()
 	: buf(lastSize)
 	, end(buf.data())
 	, finish(buf.data() + lastSize)
+	, trackSize(true)
 {
 	// We've allocated a buffer with an estimated initial size. This
 	// estimate is based on the largest intermediate size of the previously
@@ -30,6 +31,14 @@ OutputBuffer::OutputBuffer()
 	lastSize -= lastSize >> 7;
 }
 
+OutputBuffer::OutputBuffer(size_t initialSize)
+	: buf(initialSize)
+	, end(buf.data())
+	, finish(buf.data() + initialSize)
+	, trackSize(false)
+{
+}
+
 #ifdef __GNUC__
 template<size_t LEN> void OutputBuffer::insertN(const void* __restrict data)
 {
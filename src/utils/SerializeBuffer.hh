@@ -29,6 +29,13 @@ public:
 	 */
 	OutputBuffer();
 
+	/** Create an empty output buffer with the given initial capacity.
+	  * Unlike the constructor above this buffer neither uses nor updates
+	  * the size estimate of the (snapshot) buffers, so it's suited for
+	  * small buffers that get reused, see clear().
+	  */
+	explicit OutputBuffer(size_t initialSize);
+
 	/** Insert data at the end of this buffer.
 	  * This will automatically grow this buffer.
 	  */
@@ -77,8 +84,10 @@ public:
 		byte* newEnd = end + len;
 		// Make sure the next OutputBuffer will start with an initial size
 		// that can hold this much space plus some slack.
-		size_t newSize = newEnd - buf.data();
-		lastSize = std::max(lastSize, newSize + 1000);
+		if (trackSize) {
+			size_t newSize = newEnd - buf.data();
+			lastSize = std::max(lastSize, newSize + 1000);
+		}
 		if (newEnd <= finish) {
 			byte* result = end;
 			end = newEnd;
@@ -113,6 +122,21 @@ public:
 		return end - buf.data();
 	}
 
+	/** Get a pointer to the start of the buffer. Like for allocate(), it
+	  * is only valid until the next call to insert() or allocate().
+	  */
+	const byte* getData() const
+	{
+		return buf.data();
+	}
+
+	/** Remove all data, but keep the allocated memory.
+	  */
+	void clear()
+	{
+		end = buf.data();
+	}
+
 	/** Release ownership of the buffer.
 	 * Returns both the buffer and its size.
 	 */
@@ -127,6 +151,7 @@ private:
 	                     // so   end - buf == size
 	byte* finish;        // points right after the last allocated byte
 	                     // so   finish - buf == capacity
+	bool trackSize;      // use and update 'lastSize'?
 
 	static size_t lastSize;
 };
@@ -222,6 +222,61 @@ void uncompress(const char* input, size_t inLen,
 }
 
 
+bool uncompressChecked(const char* input, size_t inLen,
+                       char* output, size_t outLen)
+{
+	// Like uncompress(), but check every length and offset. Note that
+	// loadNBytes() may read up to 3 bytes past 'ipEnd', that's still
+	// within the (scratch part of the) input.
+	if (inLen < SCRATCH_SIZE) return false;
+	const char* ip = input;
+	const char* ipEnd = input + inLen - SCRATCH_SIZE;
+	char* op = output;
+	char* opEnd = output + outLen;
+
+	while (ip != ipEnd) {
+		unsigned char c = *ip++;
+		if ((c & 0x3) == LITERAL) {
+			size_t literalLen = (c >> 2) + 1;
+			if (literalLen >= 61) {
+				// Long literal.
+				size_t literalLenLen = literalLen - 60;
+				if (size_t(ipEnd - ip) < literalLenLen) return false;
+				literalLen = size_t(loadNBytes(ip, unsigned(literalLenLen))) + 1;
+				ip += literalLenLen;
+			}
+			if ((size_t(ipEnd - ip) < literalLen) ||
+			    (size_t(opEnd - op) < literalLen)) {
+				return false;
+			}
+			memcpy(op, ip, literalLen);
+			op += literalLen;
+			ip += literalLen;
+		} else {
+			uint32_t entry = charTable[c];
+			size_t extraLen = entry >> 11;
+			if (size_t(ipEnd - ip) < extraLen) return false;
+			uint32_t trailer = loadNBytes(ip, unsigned(extraLen));
+			size_t length = entry & 0xff;
+			ip += extraLen;
+
+			size_t offset = (entry & 0x700) + trailer;
+			if ((offset == 0) || (offset > size_t(op - output)) ||
+			    (length > size_t(opEnd - op))) {
+				return false;
+			}
+			// The source may overlap the destination.
+			const char* src = op - offset;
+			for (size_t i = 0; i < length; ++i) {
+				op[i] = src[i];
+			}
+			op += length;
+		}
+	}
+	return op == opEnd;
+}
+
+
 /////////////////
 
 // Any hash function will produce a valid compressed bitstream, but a good hash
@@ -52,7 +52,9 @@
 //   would return an error on invalid input, this code will crash on
 //   such input (but that shouldn't happen because we only feed input
 //   that was previously produced by the compression routine (and always
-//   keeping that compressed block in memory).
+//   keeping that compressed block in memory). Data that comes from
+//   outside (e.g. a savestate file) must be decompressed with
+//   uncompressChecked() instead.
 // The motivation for this rewrite is to:
 // - Reduce code duplication between the snappy code and the rest of
 //   openMSX.
@@ -71,6 +73,12 @@ namespace snappy {
 	              char* output, size_t& outLen);
 	void uncompress(const char* input, size_t inLen,
 	                char* output, size_t outLen);
+	/** Slower version of uncompress() for input that may be invalid: it
+	  * never reads or writes outside the given buffers.
+	  * @return Was the input a valid compressed block of exactly 'outLen'
+	  *         bytes? */
+	bool uncompressChecked(const char* input, size_t inLen,
+	                       char* output, size_t outLen);
 	size_t maxCompressedLength(size_t inLen);
 }
 
@@ -83,7 +83,8 @@ void AviRecorder::start(bool recordAudio, bool recordVideo, bool recordMono,
 		try {
 			aviWriter = make_unique<AviWriter>(
 				filename, frameWidth, frameHeight, bpp,
-				(recordAudio && stereo) ? 2 : 1, sampleRate);
+				(recordAudio && stereo) ? 2 : 1, sampleRate,
+				reactor.getCliComm());
 		} catch (MSXException& e) {
 			throw CommandException("Can't start recording: " +
 			                       e.getMessage());
@@ -1,12 +1,15 @@
 // Code based on DOSBox-0.65
 
 #include "AviWriter.hh"
+#include "FrameSource.hh"
 #include "FileOperations.hh"
+#include "CliComm.hh"
 #include "MSXException.hh"
 #include "memory.hh"
 #include "build-info.hh"
 #include "Version.hh"
 #include "cstdiop.hh" // for snprintf
+#include <SDL.h>
 #include <cstring>
 #include <ctime>
 #include <cassert>
@@ -14,17 +17,30 @@
 namespace openmsx {
 
 static const unsigned AVI_HEADER_SIZE = 500;
+static const unsigned MAX_QUEUED_FRAMES = 8;
+
+struct AviWriter::Frame
+{
+	explicit Frame(unsigned size) : pixels(size) {}
+
+	MemBuffer<uint8_t, SSE2_ALIGNMENT> pixels; // also used as scaler work buffer
+	SDL_PixelFormat pixelFormat;
+	std::vector<int16_t> samples;
+};
 
 AviWriter::AviWriter(const Filename& filename, unsigned width_,
                      unsigned height_, unsigned bpp, unsigned channels_,
-		     unsigned freq_)
+		     unsigned freq_, CliComm& cliComm_)
 	: file(filename, "wb")
+	, cliComm(cliComm_)
 	, codec(width_, height_, bpp)
+	, errorReported(false)
 	, fps(0.0f) // will be filled in later
 	, width(width_)
 	, height(height_)
 	, channels(channels_)
 	, audiorate(freq_)
+	, encoder(1)
 {
 	char dummy[AVI_HEADER_SIZE];
 	memset(dummy, 0, sizeof(dummy));
@@ -39,6 +55,13 @@ AviWriter::AviWriter(const Filename& filename, unsigned width_,
 
 AviWriter::~AviWriter()
 {
+	encoder.waitIdle(); // finish the queued frames
+	if (!error.empty() && !errorReported) {
+		// can't throw from destructor, and there's no next addFrame()
+		cliComm.printWarning("Error while writing video recording "
+		                     "(the file may be incomplete): " + error);
+	}
+
 	if (written == 0) {
 		// no data written yet (a recording less than one video frame)
 		std::string filename = file.getURL();
@@ -245,13 +268,57 @@ void AviWriter::addAviChunk(const char* tag, unsigned size, void* data, unsigned
 }
 
 void AviWriter::addFrame(FrameSource* frame, unsigned samples, int16_t* sampleData)
+{
+	Frame* f;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (freeFrames.empty() && (framePool.size() < MAX_QUEUED_FRAMES)) {
+			framePool.push_back(make_unique<Frame>(codec.getFrameSize()));
+			freeFrames.push_back(framePool.back().get());
+		}
+		frameFreed.wait(lock, [&] { return !freeFrames.empty(); });
+		if (!error.empty()) {
+			// the caller reports it, don't warn again in ~AviWriter
+			errorReported = true;
+			throw MSXException(error);
+		}
+		f = freeFrames.back();
+		freeFrames.pop_back();
+	}
+
+	codec.copyFrame(frame, f->pixels.data());
+	f->pixelFormat = frame->getSDLPixelFormat();
+	f->samples.assign(sampleData, sampleData + samples);
+	encoder.addTask([this, f] {
+		// Only this thread writes 'error'. After an error the remaining
+		// frames are dropped.
+		if (error.empty()) {
+			try {
+				writeFrame(*f);
+			} catch (MSXException& e) {
+				std::lock_guard<std::mutex> lock(mutex);
+				error = e.getMessage();
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			freeFrames.push_back(f);
+		}
+		frameFreed.notify_one();
+	});
+}
+
+void AviWriter::writeFrame(Frame& f)
 {
 	bool keyFrame = (frames++ % 300 == 0);
 	void* buffer;
 	unsigned size;
-	codec.compressFrame(keyFrame, frame, buffer, size);
+	codec.compressFrame(keyFrame, f.pixels.data(), f.pixelFormat,
+	                    buffer, size);
 	addAviChunk("00dc", size, buffer, keyFrame ? 0x10 : 0x0);
 
+	unsigned samples = unsigned(f.samples.size());
+	int16_t* sampleData = f.samples.data();
 	if (samples) {
 		assert((samples % channels) == 0);
 		assert(audiorate != 0);
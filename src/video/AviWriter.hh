@@ -5,7 +5,11 @@
 
 #include "ZMBVEncoder.hh"
 #include "File.hh"
+#include "ThreadPool.hh"
 #include "endian.hh"
+#include <condition_variable>
+#include <mutex>
+#include <string>
 #include <cstdint>
 #include <vector>
 #include <memory>
@@ -14,23 +18,46 @@ namespace openmsx {
 
 class Filename;
 class FrameSource;
+class CliComm;
 
 class AviWriter
 {
 public:
 	AviWriter(const Filename& filename, unsigned width, unsigned height,
-	          unsigned bpp, unsigned channels, unsigned freq);
+	          unsigned bpp, unsigned channels, unsigned freq,
+	          CliComm& cliComm);
 	~AviWriter();
+
+	/** Add a video frame and the audio samples that belong to it. This
+	  * only copies the frame (and the samples), compressing and writing
+	  * them to the file happens on a worker thread, in the same order as
+	  * the frames were added. When too many frames are queued this waits
+	  * for the worker. Errors of the worker are reported (as
+	  * MSXException) by the next call, or as a warning when the writer is
+	  * destroyed.
+	  */
 	void addFrame(FrameSource* frame, unsigned samples, int16_t* sampleData);
 	void setFps(float fps_) { fps = fps_; }
 
 private:
+	struct Frame;
+	void writeFrame(Frame& frame);
 	void addAviChunk(const char* tag, unsigned size, void* data, unsigned flags);
 
 	File file;
+	CliComm& cliComm;
 	ZMBVEncoder codec;
 	std::vector<Endian::L32> index;
 
+	// The copied frames, they are reused. The number of frames is limited,
+	// so this also limits the number of frames that can be queued.
+	std::vector<std::unique_ptr<Frame>> framePool;
+	std::vector<Frame*> freeFrames;
+	std::string error; // first error of the worker thread
+	std::mutex mutex;  // protects 'freeFrames' and 'error'
+	bool errorReported; // 'error' was already thrown from addFrame()
+	std::condition_variable frameFreed;
+
 	float fps;
 	const unsigned width;
 	const unsigned height;
@@ -40,6 +67,8 @@ private:
 	unsigned frames;
 	unsigned audiowritten;
 	unsigned written;
+
+	ThreadPool encoder; // must be destroyed first
 };
 
 } // namespace openmsx
@@ -10,6 +10,7 @@
 #include "InputEvents.hh"
 #include "CliComm.hh"
 #include "Timer.hh"
+#include "HostTimeProfile.hh"
 #include "BooleanSetting.hh"
 #include "IntegerSetting.hh"
 #include "EnumSetting.hh"
@@ -330,6 +331,7 @@ void Display::repaint()
 	cancelRT(); // cancel delayed repaint
 
 	if (!renderFrozen) {
+		HostTimeProfile::Scope profile(HostTimeProfile::POSTPROCESS);
 		assert(videoSystem);
 		if (OutputSurface* surface = videoSystem->getOutputSurface()) {
 			repaint(*surface);
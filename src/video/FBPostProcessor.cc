@@ -6,6 +6,7 @@
 #include "Scaler.hh"
 #include "ScalerFactory.hh"
 #include "OutputSurface.hh"
+#include "ThreadPool.hh"
 #include "IntegerSetting.hh"
 #include "FloatSetting.hh"
 #include "BooleanSetting.hh"
@@ -14,16 +15,23 @@
 #include "aligned.hh"
 #include "random.hh"
 #include "xrange.hh"
+#include "vla.hh"
+#include "memory.hh"
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
 #ifdef __SSE2__
 #include <emmintrin.h>
 #endif
 
 namespace openmsx {
 
+// The scalers look at most this many source lines above and below the lines
+// they're scaling.
+static const unsigned LINE_CACHE_MARGIN = 2;
+
 static const unsigned NOISE_SHIFT = 8192;
 static const unsigned NOISE_BUF_SIZE = 2 * NOISE_SHIFT;
 SSE_ALIGNED(static signed char noiseBuf[NOISE_BUF_SIZE]);
@@ -243,6 +251,9 @@ FBPostProcessor<Pixel>::FBPostProcessor(MSXMotherBoard& motherBoard_,
 {
 	scaleAlgorithm = RenderSettings::NO_SCALER;
 	scaleFactor = unsigned(-1);
+	bandPoolSize = 0;
+	lineCacheKey.srcHeight = 0; // cache is empty
+	useLineCache = false;
 
 	auto& noiseSetting = renderSettings.getNoiseSetting();
 	noiseSetting.attach(*this);
@@ -256,6 +267,170 @@ FBPostProcessor<Pixel>::~FBPostProcessor()
 	renderSettings.getNoiseSetting().detach(*this);
 }
 
+template <class Pixel>
+bool FBPostProcessor<Pixel>::canSplit(unsigned grp, unsigned g, unsigned srcStep)
+{
+	// The scalers handle a region of blank lines (line width 1) specially:
+	// when it doesn't end at the bottom of the screen, the last line is
+	// scaled together with the following (non-blank) line. So a region
+	// must not end in the middle of a run of blank lines.
+	return (grp == 0) || (grp == g) ||
+	       (getLineWidth(paintFrame, (grp - 1) * srcStep, srcStep) != 1) ||
+	       (getLineWidth(paintFrame,  grp      * srcStep, srcStep) != 1);
+}
+
+template <class Pixel>
+bool FBPostProcessor<Pixel>::updateLineCache(
+	OutputSurface& output, unsigned g, unsigned srcStep, unsigned inWidth)
+{
+	const unsigned srcHeight = paintFrame->getHeight();
+	const unsigned dstWidth  = output.getWidth();
+	const unsigned dstHeight = output.getHeight();
+
+	// MLAA looks at the whole image at once. When superimposing, the
+	// result also depends on the video frame.
+	if ((scaleAlgorithm == RenderSettings::SCALER_MLAA) ||
+	    superImposeVideoFrame) {
+		lineCacheKey.srcHeight = 0;
+		numScaledLines += dstHeight;
+		return false;
+	}
+
+	LineCacheKey key = {
+		scaleAlgorithm, scaleFactor,
+		renderSettings.getScanlineFactor(), renderSettings.getBlurFactor(),
+		inWidth, srcHeight, dstWidth, dstHeight };
+	if (!(key == lineCacheKey)) {
+		lineCacheKey = key;
+		prevSrc.resize(srcHeight * maxWidth);
+		prevSrcWidth.assign(srcHeight, 0);
+		prevDst.resize(dstHeight * dstWidth);
+	}
+
+	// Which source lines changed since the previous image? Lines are
+	// compared exactly (a hash collision would leave a wrong line on
+	// the screen), that's still much cheaper than scaling them.
+	changedLines.assign(srcHeight, false);
+	VLA_SSE_ALIGNED(Pixel, buf, maxWidth);
+	for (unsigned y = 0; y < srcHeight; ++y) {
+		unsigned width = paintFrame->getLineWidth(y);
+		if (width > unsigned(maxWidth)) {
+			// can't cache this line
+			prevSrcWidth[y] = 0;
+			changedLines[y] = true;
+			continue;
+		}
+		auto* line = paintFrame->getLinePtr(y, width, buf);
+		auto* prev = &prevSrc[y * maxWidth];
+		if ((prevSrcWidth[y] != width) ||
+		    (memcmp(line, prev, width * sizeof(Pixel)) != 0)) {
+			memcpy(prev, line, width * sizeof(Pixel));
+			prevSrcWidth[y] = width;
+			changedLines[y] = true;
+		}
+	}
+
+	// A group of output lines must be scaled again when one of its own
+	// source lines or a neighbouring source line changed.
+	dirtyGroups.assign(g, false);
+	for (unsigned y = 0; y < srcHeight; ++y) {
+		if (!changedLines[y]) continue;
+		unsigned first = (y < LINE_CACHE_MARGIN)
+		               ? 0 : (y - LINE_CACHE_MARGIN) / srcStep;
+		unsigned last = std::min(g - 1, (y + LINE_CACHE_MARGIN) / srcStep);
+		for (unsigned grp = first; grp <= last; ++grp) {
+			dirtyGroups[grp] = true;
+		}
+	}
+	// The boundaries between clean and dirty lines split the image in
+	// regions, so (just like for the bands) a run of blank lines must be
+	// either completely clean or completely dirty.
+	for (unsigned grp = 1; grp < g; ++grp) {
+		if (dirtyGroups[grp - 1] && !canSplit(grp, g, srcStep)) {
+			dirtyGroups[grp] = true;
+		}
+	}
+	for (unsigned grp = g - 1; grp > 0; --grp) {
+		if (dirtyGroups[grp] && !canSplit(grp, g, srcStep)) {
+			dirtyGroups[grp - 1] = true;
+		}
+	}
+
+	unsigned dstStep = dstHeight / g;
+	for (unsigned grp = 0; grp < g; ++grp) {
+		if (dirtyGroups[grp]) {
+			numScaledLines += dstStep;
+		} else {
+			numReusedLines += dstStep;
+		}
+	}
+	return true;
+}
+
+template <class Pixel>
+void FBPostProcessor<Pixel>::scaleBand(
+	Scaler<Pixel>& scaler, OutputSurface& output,
+	unsigned dstStartY, unsigned dstEndY,
+	unsigned srcStep, unsigned dstStep, unsigned inWidth)
+{
+	const unsigned srcHeight = paintFrame->getHeight();
+	const unsigned dstWidth = output.getWidth();
+	assert((dstStartY % dstStep) == 0);
+	unsigned srcStartY = (dstStartY / dstStep) * srcStep;
+	unsigned bandEndY = dstEndY;
+
+	// TODO: Store all MSX lines in RawFrame and only scale the ones that fit
+	//       on the PC screen, as a preparation for resizable output window.
+	while (dstStartY < bandEndY) {
+		// Currently this is true because the source frame height
+		// is always >= dstHeight/(dstStep/srcStep).
+		assert(srcStartY < srcHeight);
+
+		// get region with equal lineWidth (and equal dirty state)
+		unsigned lineWidth = getLineWidth(paintFrame, srcStartY, srcStep);
+		bool dirty = !useLineCache || dirtyGroups[srcStartY / srcStep];
+		unsigned srcEndY = srcStartY + srcStep;
+		dstEndY = dstStartY + dstStep;
+		while ((srcEndY < srcHeight) && (dstEndY < bandEndY) &&
+		       (getLineWidth(paintFrame, srcEndY, srcStep) == lineWidth) &&
+		       (!useLineCache || (dirtyGroups[srcEndY / srcStep] == dirty))) {
+			srcEndY += srcStep;
+			dstEndY += dstStep;
+		}
+
+		if (!dirty) {
+			// reuse the lines of the previous image
+			for (unsigned y = dstStartY; y < dstEndY; ++y) {
+				memcpy(output.getLinePtrDirect<Pixel>(y),
+				       &prevDst[y * dstWidth],
+				       dstWidth * sizeof(Pixel));
+			}
+		} else {
+			// fill region
+			//fprintf(stderr, "post processing lines %d-%d: %d\n",
+			//	srcStartY, srcEndY, lineWidth );
+			std::unique_ptr<ScalerOutput<Pixel>> dst(
+				StretchScalerOutputFactory<Pixel>::create(
+					output, pixelOps, inWidth));
+			scaler.scaleImage(
+				*paintFrame, superImposeVideoFrame,
+				srcStartY, srcEndY, lineWidth, // source
+				*dst, dstStartY, dstEndY); // dest
+			if (useLineCache) {
+				for (unsigned y = dstStartY; y < dstEndY; ++y) {
+					memcpy(&prevDst[y * dstWidth],
+					       output.getLinePtrDirect<Pixel>(y),
+					       dstWidth * sizeof(Pixel));
+				}
+			}
+		}
+
+		// next region
+		srcStartY = srcEndY;
+		dstStartY = dstEndY;
+	}
+}
+
 template <class Pixel>
 void FBPostProcessor<Pixel>::paint(OutputSurface& output)
 {
@@ -278,6 +453,7 @@ void FBPostProcessor<Pixel>::paint(OutputSurface& output)
 		currScaler = ScalerFactory<Pixel>::createScaler(
 			PixelOperations<Pixel>(output.getSDLFormat()),
 			renderSettings);
+		bandScalers.clear();
 	}
 
 	// Scale image.
@@ -288,42 +464,51 @@ void FBPostProcessor<Pixel>::paint(OutputSurface& output)
 	unsigned srcStep = srcHeight / g;
 	unsigned dstStep = dstHeight / g;
 
-	// TODO: Store all MSX lines in RawFrame and only scale the ones that fit
-	//       on the PC screen, as a preparation for resizable output window.
-	unsigned srcStartY = 0;
-	unsigned dstStartY = 0;
-	while (dstStartY < dstHeight) {
-		// Currently this is true because the source frame height
-		// is always >= dstHeight/(dstStep/srcStep).
-		assert(srcStartY < srcHeight);
-
-		// get region with equal lineWidth
-		unsigned lineWidth = getLineWidth(paintFrame, srcStartY, srcStep);
-		unsigned srcEndY = srcStartY + srcStep;
-		unsigned dstEndY = dstStartY + dstStep;
-		while ((srcEndY < srcHeight) && (dstEndY < dstHeight) &&
-		       (getLineWidth(paintFrame, srcEndY, srcStep) == lineWidth)) {
-			srcEndY += srcStep;
-			dstEndY += dstStep;
+	output.lock();
+	float horStretch = renderSettings.getHorizontalStretch();
+	unsigned inWidth = unsigned(horStretch + 0.5f);
+	useLineCache = updateLineCache(output, g, srcStep, inWidth);
+
+	// MLAA looks at the whole region at once, splitting it in bands would
+	// change the result.
+	unsigned numBands = (scaleAlgorithm == RenderSettings::SCALER_MLAA)
+	                  ? 1
+	                  : std::min<unsigned>(renderSettings.getScaleThreads(), g);
+	if (numBands <= 1) {
+		scaleBand(*currScaler, output, 0, dstHeight,
+		          srcStep, dstStep, inWidth);
+	} else {
+		if (bandPoolSize != (numBands - 1)) {
+			bandPool = make_unique<ThreadPool>(numBands - 1);
+			bandPoolSize = numBands - 1;
 		}
-
-		// fill region
-		//fprintf(stderr, "post processing lines %d-%d: %d\n",
-		//	srcStartY, srcEndY, lineWidth );
-		output.lock();
-		float horStretch = renderSettings.getHorizontalStretch();
-		unsigned inWidth = unsigned(horStretch + 0.5f);
-		std::unique_ptr<ScalerOutput<Pixel>> dst(
-			StretchScalerOutputFactory<Pixel>::create(
-				output, pixelOps, inWidth));
-		currScaler->scaleImage(
-			*paintFrame, superImposeVideoFrame,
-			srcStartY, srcEndY, lineWidth, // source
-			*dst, dstStartY, dstEndY); // dest
-
-		// next region
-		srcStartY = srcEndY;
-		dstStartY = dstEndY;
+		while (bandScalers.size() < (numBands - 1)) {
+			bandScalers.push_back(ScalerFactory<Pixel>::createScaler(
+				PixelOperations<Pixel>(output.getSDLFormat()),
+				renderSettings));
+		}
+		// Band boundaries are multiples of dstStep (so they map to whole
+		// source lines). The scalers fetch the neighbouring source lines
+		// they need directly from the frame, also across band
+		// boundaries, just like for the boundaries between regions
+		// of different line width.
+		auto bandStart = [&](unsigned b) {
+			unsigned grp = g * b / numBands;
+			while (!canSplit(grp, g, srcStep)) ++grp;
+			return grp * dstStep;
+		};
+		for (unsigned b = 1; b < numBands; ++b) {
+			auto* scaler = bandScalers[b - 1].get();
+			unsigned start = bandStart(b);
+			unsigned end   = bandStart(b + 1);
+			bandPool->addTask([=, &output] {
+				scaleBand(*scaler, output, start, end,
+				          srcStep, dstStep, inWidth);
+			});
+		}
+		scaleBand(*currScaler, output, 0, bandStart(1),
+		          srcStep, dstStep, inWidth);
+		bandPool->waitIdle();
 	}
 
 	drawNoise(output);
@@ -4,12 +4,14 @@
 #include "PostProcessor.hh"
 #include "RenderSettings.hh"
 #include "PixelOperations.hh"
+#include "MemBuffer.hh"
 #include <vector>
 
 namespace openmsx {
 
 class MSXMotherBoard;
 class Display;
+class ThreadPool;
 template<typename Pixel> class Scaler;
 
 /** Rasterizer using SDL.
@@ -31,6 +33,28 @@ public:
 		std::unique_ptr<RawFrame> finishedFrame, EmuTime::param time) override;
 
 private:
+	/** May the scaled image be split (in bands) before the given group
+	  * of source lines? A group is 'srcStep' source lines, there are 'g'
+	  * groups in total.
+	  */
+	bool canSplit(unsigned grp, unsigned g, unsigned srcStep);
+
+	/** Compare the source lines of paintFrame with those of the previous
+	  * paint() and mark the groups of output lines that must be scaled
+	  * again (see dirtyGroups).
+	  * @return Can the line cache be used for this image?
+	  */
+	bool updateLineCache(OutputSurface& output, unsigned g,
+	                     unsigned srcStep, unsigned inWidth);
+
+	/** Scale the output lines [dstStartY, dstEndY) with the given scaler.
+	  * Both must be a multiple of dstStep. When the line cache is used,
+	  * the clean lines are copied from the previous image instead.
+	  */
+	void scaleBand(Scaler<Pixel>& scaler, OutputSurface& output,
+	               unsigned dstStartY, unsigned dstEndY,
+	               unsigned srcStep, unsigned dstStep, unsigned inWidth);
+
 	void preCalcNoise(float factor);
 	void drawNoise(OutputSurface& output);
 	void drawNoiseLine(Pixel* buf, signed char* noise,
@@ -51,6 +75,47 @@ private:
 	  */
 	unsigned scaleFactor;
 
+	/** With 'scale_threads' > 1 the output is split in horizontal bands,
+	  * the first band is scaled by currScaler on this thread, each other
+	  * band by its own scaler (scalers have internal state) on a worker
+	  * thread.
+	  */
+	std::vector<std::unique_ptr<Scaler<Pixel>>> bandScalers;
+	std::unique_ptr<ThreadPool> bandPool;
+	unsigned bandPoolSize; // number of threads in bandPool
+
+	/** Line cache: often only a small part of the MSX screen changes from
+	  * one frame to the next. The output lines that only depend on
+	  * unchanged source lines are copied from the previous (scaled, but
+	  * without noise) image instead of scaled again.
+	  * prevSrc holds the source lines (each maxWidth pixels apart) from
+	  * which prevDst was created, the width of a line is 0 when unknown.
+	  */
+	struct LineCacheKey {
+		RenderSettings::ScaleAlgorithm algo;
+		unsigned factor;
+		int scanline;
+		int blur;
+		unsigned inWidth;
+		unsigned srcHeight;
+		unsigned dstWidth;
+		unsigned dstHeight;
+
+		bool operator==(const LineCacheKey& o) const {
+			return (algo      == o.algo)      && (factor    == o.factor) &&
+			       (scanline  == o.scanline)  && (blur      == o.blur) &&
+			       (inWidth   == o.inWidth)   && (srcHeight == o.srcHeight) &&
+			       (dstWidth  == o.dstWidth)  && (dstHeight == o.dstHeight);
+		}
+	};
+	LineCacheKey lineCacheKey; // everything else the scaled image depends on
+	MemBuffer<Pixel> prevSrc;
+	std::vector<unsigned> prevSrcWidth;
+	MemBuffer<Pixel> prevDst;
+	std::vector<bool> changedLines; // per source line
+	std::vector<bool> dirtyGroups;  // per group of srcStep source lines
+	bool useLineCache;
+
 	/** Remember the noise values to get a stable image when paused.
 	 */
 	std::vector<unsigned> noiseShift;
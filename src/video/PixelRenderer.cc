@@ -20,6 +20,7 @@ TODO:
 #include "MSXMotherBoard.hh"
 #include "Reactor.hh"
 #include "Timer.hh"
+#include "HostTimeProfile.hh"
 #include "unreachable.hh"
 #include <algorithm>
 #include <cassert>
@@ -202,6 +203,7 @@ void PixelRenderer::frameStart(EmuTime::param time)
 
 void PixelRenderer::frameEnd(EmuTime::param time)
 {
+	HostTimeProfile::Scope profile(HostTimeProfile::VDP);
 	bool skipEvent = !renderFrame;
 	if (renderFrame) {
 		// Render changes from this last frame.
@@ -530,6 +532,7 @@ void PixelRenderer::sync(EmuTime::param time, bool force)
 
 void PixelRenderer::renderUntil(EmuTime::param time)
 {
+	HostTimeProfile::Scope profile(HostTimeProfile::VDP);
 	// Translate from time to pixel position.
 	int limitTicks = vdp.getTicksThisFrame(time);
 	assert(limitTicks <= vdp.getTicksPerFrame());
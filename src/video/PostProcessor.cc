@@ -26,6 +26,9 @@
 
 namespace openmsx {
 
+uint64_t PostProcessor::numScaledLines = 0;
+uint64_t PostProcessor::numReusedLines = 0;
+
 PostProcessor::PostProcessor(MSXMotherBoard& motherBoard_,
 	Display& display_, OutputSurface& screen_, const std::string& videoSource,
 	unsigned maxWidth_, unsigned height_, bool canDoInterlace_)
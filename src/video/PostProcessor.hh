@@ -7,6 +7,7 @@
 #include "EmuTime.hh"
 #include <memory>
 #include <vector>
+#include <cstdint>
 
 namespace openmsx {
 
@@ -87,6 +88,14 @@ public:
 	  */
 	FrameSource* getPaintFrame() const { return paintFrame; }
 
+	/** Number of output lines that were scaled resp. copied from the
+	  * line cache of the previous image (see FBPostProcessor) since the
+	  * last call to resetLineStats(). Used by the 'benchmark' command.
+	  */
+	static uint64_t getScaledLines() { return numScaledLines; }
+	static uint64_t getReusedLines() { return numReusedLines; }
+	static void resetLineStats() { numScaledLines = numReusedLines = 0; }
+
 	// VideoLayer
 	void takeRawScreenShot(unsigned height, const std::string& filename) override;
 
@@ -143,6 +152,9 @@ protected:
 	int maxWidth; // we lazily create RawFrame objects in lastFrames[]
 	int height;   // these two vars remember how big those should be
 
+	static uint64_t numScaledLines;
+	static uint64_t numReusedLines;
+
 private:
 	// Schedulable
 	void executeUntil(EmuTime::param time) override;
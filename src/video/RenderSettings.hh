@@ -120,6 +120,10 @@ public:
 	IntegerSetting& getScaleFactorSetting() { return scaleFactorSetting; }
 	int getScaleFactor() const { return scaleFactorSetting.getInt(); }
 
+	/** The number of threads used by the SDL renderers to scale the
+	  * image. */
+	int getScaleThreads() const { return scaleThreadsSetting.getInt(); }
+
 	/** Limit number of sprites per line?
 	  * If true, limit number of sprites per line as real VDP does.
 	  * If false, display all sprites.
@@ -216,6 +220,7 @@ private:
 	IntegerSetting horizontalBlurSetting;
 	EnumSetting<ScaleAlgorithm> scaleAlgorithmSetting;
 	IntegerSetting scaleFactorSetting;
+	IntegerSetting scaleThreadsSetting;
 	IntegerSetting scanlineAlphaSetting;
 	BooleanSetting limitSpritesSetting;
 	BooleanSetting disableSpritesSetting;
@@ -128,6 +128,10 @@ VDPVRAM::VDPVRAM(VDP& vdp_, unsigned size, EmuTime::param time)
 {
 	(void)time;
 
+	// All writes go via writeCommon() or via the methods below, so the
+	// reverse snapshots only need to look at the written pages.
+	data.getDirtyPages().enableTracking(true);
+
 	vrMode = vdp.getVRMode();
 	setSizeMask(time);
 
@@ -151,6 +155,7 @@ void VDPVRAM::clear()
 		// TODO reading same location multiple times does not always
 		// give the same value.
 		memset(&data[actualSize], 0xFF, data.getSize() - actualSize);
+		data.getDirtyPages().mark(actualSize, data.getSize() - actualSize);
 	}
 }
 
@@ -227,6 +232,7 @@ void VDPVRAM::updateVRMode(bool newVRmode, EmuTime::param time)
 			std::swap(data[i], data[swapAddr(i)]);
 		}
 	}
+	data.getDirtyPages().mark(0, 0x10000);
 }
 
 void VDPVRAM::setRenderer(Renderer* newRenderer, EmuTime::param time)
@@ -309,6 +315,7 @@ void VDPVRAM::change4k8kMapping(bool mapping8k)
 		}
 	}
 	memcpy(&data[0], tmp, sizeof(tmp));
+	data.getDirtyPages().mark(0, sizeof(tmp));
 }
 
 
@@ -333,7 +340,7 @@ void VDPVRAM::serialize(Archive& ar, unsigned /*version*/)
 		setSizeMask(static_cast<MSXDevice&>(vdp).getCurrentTime());
 	}
 
-	ar.serialize_blob("data", &data[0], actualSize);
+	ar.serialize_blob("data", &data[0], actualSize, data.getDirtyPages());
 	ar.serialize("cmdReadWindow",       cmdReadWindow);
 	ar.serialize("cmdWriteWindow",      cmdWriteWindow);
 	ar.serialize("nameTable",           nameTable);
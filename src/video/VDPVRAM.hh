@@ -557,6 +557,7 @@ private:
 		spritePatternTable.notify(address, time);
 
 		data[address] = value;
+		data.getDirtyPages().mark(address);
 		#ifdef DEBUG
 		vramTime = time;
 		#endif
@@ -22,7 +22,19 @@ public:
 	ZMBVEncoder(unsigned width, unsigned height, unsigned bpp);
 	~ZMBVEncoder();
 
-	void compressFrame(bool keyFrame, FrameSource* frame,
+	/** Size in bytes of a frame as stored by copyFrame(). */
+	unsigned getFrameSize() const { return width * height * pixelSize; }
+
+	/** Copy the (scaled) lines of the given frame to 'dest', without
+	  * padding between the lines. Unlike compressFrame() this doesn't
+	  * touch the encoder state, so it can be called on another thread
+	  * while a previous frame is being compressed.
+	  */
+	void copyFrame(FrameSource* frame, void* dest) const;
+
+	/** Compress a frame that was stored by copyFrame(). */
+	void compressFrame(bool keyFrame, const void* pixels,
+	                   const SDL_PixelFormat& pixelFormat,
 	                   void*& buffer, unsigned& written);
 
 private:
@@ -40,7 +52,7 @@ private:
 	template<class P> void addXorBlock(
 		const PixelOperations<P>& pixelOps, int vx, int vy,
 		unsigned offset, unsigned& workUsed);
-	const void* getScaledLine(FrameSource* frame, unsigned y, void* workBuf);
+	const void* getScaledLine(FrameSource* frame, unsigned y, void* workBuf) const;
 
 	MemBuffer<uint8_t, SSE2_ALIGNMENT> oldframe;
 	MemBuffer<uint8_t, SSE2_ALIGNMENT> newframe;
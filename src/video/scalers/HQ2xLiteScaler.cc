@@ -14,6 +14,7 @@
 #include "HQCommon.hh"
 #include "LineScalers.hh"
 #include "unreachable.hh"
+#include "vla.hh"
 #include "build-info.hh"
 #include <cstdint>
 
@@ -39,13 +40,16 @@ void HQLite_1x1on2x2<Pixel>::operator()(
 	const Pixel* __restrict in2,
 	Pixel* __restrict out0, Pixel* __restrict out1,
 	unsigned srcWidth, unsigned* __restrict edgeBuf,
-	EdgeHQLite /*edgeOp*/) __restrict
+	EdgeHQLite edgeOp) __restrict
 {
 	unsigned c2, c4, c5, c6, c8, c9;
 	c2 =      readPixel(in0[0]);
 	c5 = c6 = readPixel(in1[0]);
 	c8 = c9 = readPixel(in2[0]);
 
+	VLA(uint16_t, edges, srcWidth);
+	calcEdges(in1, in2, srcWidth, edges, edgeOp);
+
 	unsigned pattern = 0;
 	if (c5 != c8) pattern |= 3 <<  6;
 	if (c5 != c2) pattern |= 3 <<  9;
@@ -66,10 +70,7 @@ void HQLite_1x1on2x2<Pixel>::operator()(
 		//if (c5 != c1) pattern |= 1 <<  3; //     l: c2-c6 9,  t: c4-c8 0
 		//if (c4 != c2) pattern |= 1 <<  4; //     l: c5-c3 10, t: c5-c7 1
 		// non-overlapping pixels
-		if (c5 != c8) pattern |= 1 <<  5; // B
-		if (c5 != c9) pattern |= 1 <<  6; // BR
-		if (c6 != c8) pattern |= 1 <<  7; // BR
-		if (c5 != c6) pattern |= 1 <<  8; // R
+		pattern |= edges[x]; // B, BR, BR, R
 		// overlaps with top
 		//if (c2 != c6) pattern |= 1 <<  9; // R - t: c5-c9 6
 		//if (c5 != c3) pattern |= 1 << 10; // R - t: c6-c8 7
@@ -95,7 +96,7 @@ void HQLite_1x1on1x2<Pixel>::operator()(
 	const Pixel* __restrict in2,
 	Pixel* __restrict out0, Pixel* __restrict out1,
 	unsigned srcWidth, unsigned* __restrict edgeBuf,
-	EdgeHQLite /*edgeOp*/) __restrict
+	EdgeHQLite edgeOp) __restrict
 {
 	//  +---+---+---+
 	//  | 1 | 2 | 3 |
@@ -109,6 +110,9 @@ void HQLite_1x1on1x2<Pixel>::operator()(
 	c5 = c6 = readPixel(in1[0]);
 	c8 = c9 = readPixel(in2[0]);
 
+	VLA(uint16_t, edges, srcWidth);
+	calcEdges(in1, in2, srcWidth, edges, edgeOp);
+
 	unsigned pattern = 0;
 	if (c5 != c8) pattern |= 3 <<  6;
 	if (c5 != c2) pattern |= 3 <<  9;
@@ -129,10 +133,7 @@ void HQLite_1x1on1x2<Pixel>::operator()(
 		//if (c5 != c1) pattern |= 1 <<  3; //     l: c2-c6 9,  t: c4-c8 0
 		//if (c4 != c2) pattern |= 1 <<  4; //     l: c5-c3 10, t: c5-c7 1
 		// non-overlapping pixels
-		if (c5 != c8) pattern |= 1 <<  5; // B
-		if (c5 != c9) pattern |= 1 <<  6; // BR
-		if (c6 != c8) pattern |= 1 <<  7; // BR
-		if (c5 != c6) pattern |= 1 <<  8; // R
+		pattern |= edges[x]; // B, BR, BR, R
 		// overlaps with top
 		//if (c2 != c6) pattern |= 1 <<  9; // R - t: c5-c9 6
 		//if (c5 != c3) pattern |= 1 << 10; // R - t: c6-c8 7
@@ -12,6 +12,7 @@ Visit the HiEnd3D site for info:
 #include "HQCommon.hh"
 #include "LineScalers.hh"
 #include "unreachable.hh"
+#include "vla.hh"
 #include "build-info.hh"
 #include <cstdint>
 
@@ -32,13 +33,16 @@ void HQLite_1x1on3x3<Pixel>::operator()(
 	Pixel* __restrict out0, Pixel* __restrict out1,
 	Pixel* __restrict out2,
 	unsigned srcWidth, unsigned* __restrict edgeBuf,
-	EdgeHQLite /*edgeOp*/) __restrict
+	EdgeHQLite edgeOp) __restrict
 {
 	unsigned c2, c4, c5, c6, c8, c9;
 	c2 =      readPixel(in0[0]);
 	c5 = c6 = readPixel(in1[0]);
 	c8 = c9 = readPixel(in2[0]);
 
+	VLA(uint16_t, edges, srcWidth);
+	calcEdges(in1, in2, srcWidth, edges, edgeOp);
+
 	unsigned pattern = 0;
 	if (c5 != c8) pattern |= 3 <<  6;
 	if (c5 != c2) pattern |= 3 <<  9;
@@ -59,10 +63,7 @@ void HQLite_1x1on3x3<Pixel>::operator()(
 		//if (c5 != c1) pattern |= 1 <<  3; //     l: c2-c6 9,  t: c4-c8 0
 		//if (c4 != c2) pattern |= 1 <<  4; //     l: c5-c3 10, t: c5-c7 1
 		// non-overlapping pixels
-		if (c5 != c8) pattern |= 1 <<  5; // B
-		if (c5 != c9) pattern |= 1 <<  6; // BR
-		if (c6 != c8) pattern |= 1 <<  7; // BR
-		if (c5 != c6) pattern |= 1 <<  8; // R
+		pattern |= edges[x]; // B, BR, BR, R
 		// overlaps with top
 		//if (c2 != c6) pattern |= 1 <<  9; // R - t: c5-c9 6
 		//if (c5 != c3) pattern |= 1 << 10; // R - t: c6-c8 7
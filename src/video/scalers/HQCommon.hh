@@ -10,6 +10,9 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace openmsx {
 
@@ -74,7 +77,50 @@ public:
 
 		return false;
 	}
+
+#ifdef __SSE2__
+	/** Same as above, but for 8 pairs of pixels at once: (a0, b0) are the
+	  * first 4 pairs, (a1, b1) the next 4. The result has a 16-bit lane
+	  * per pair, all ones when there's an edge.
+	  */
+	inline __m128i operator()(__m128i a0, __m128i a1,
+	                          __m128i b0, __m128i b1) const
+	{
+		// All intermediate values fit in 16 bits.
+		__m128i dr = _mm_sub_epi16(channel(a0, a1, shiftR),
+		                           channel(b0, b1, shiftR));
+		__m128i dg = _mm_sub_epi16(channel(a0, a1, shiftG),
+		                           channel(b0, b1, shiftG));
+		__m128i db = _mm_sub_epi16(channel(a0, a1, shiftB),
+		                           channel(b0, b1, shiftB));
+		__m128i dy = _mm_add_epi16(_mm_add_epi16(dr, dg), db);
+		__m128i du = _mm_sub_epi16(dr, db);
+		__m128i dv = _mm_sub_epi16(
+			_mm_add_epi16(_mm_add_epi16(dg, dg), dg), dy);
+		return _mm_or_si128(_mm_or_si128(outside(dy, 0xC0),
+		                                 outside(du, 0x1C)),
+		                    outside(dv, 0x30));
+	}
+#endif
+
 private:
+#ifdef __SSE2__
+	// The 8-bit channel at the given position of 8 pixels, as 16-bit values.
+	static inline __m128i channel(__m128i p0, __m128i p1, unsigned shift)
+	{
+		__m128i s = _mm_cvtsi32_si128(shift);
+		__m128i mask = _mm_set1_epi32(0xFF);
+		return _mm_packs_epi32(_mm_and_si128(_mm_srl_epi32(p0, s), mask),
+		                       _mm_and_si128(_mm_srl_epi32(p1, s), mask));
+	}
+	// Is 'd' outside the range [-limit, limit]?
+	static inline __m128i outside(__m128i d, short limit)
+	{
+		return _mm_or_si128(_mm_cmpgt_epi16(d, _mm_set1_epi16( limit)),
+		                    _mm_cmplt_epi16(d, _mm_set1_epi16(-limit)));
+	}
+#endif
+
 	const unsigned shiftR;
 	const unsigned shiftG;
 	const unsigned shiftB;
@@ -98,8 +144,86 @@ struct EdgeHQLite
 	{
 		return c1 != c2;
 	}
+
+#ifdef __SSE2__
+	// See EdgeHQ.
+	inline __m128i operator()(__m128i a0, __m128i a1,
+	                          __m128i b0, __m128i b1) const
+	{
+		__m128i eq = _mm_packs_epi32(_mm_cmpeq_epi32(a0, b0),
+		                             _mm_cmpeq_epi32(a1, b1));
+		return _mm_xor_si128(eq, _mm_set1_epi16(-1));
+	}
+#endif
 };
 
+/** Calculate the edges that the HQ scalers need for the pixels of a line,
+  * in the position of the pattern bits. For pixel x with
+  *     c5 = curr[x], c6 = curr[x + 1],
+  *     c8 = next[x], c9 = next[x + 1]
+  * (at the end of the line c6 = c5 and c9 = c8) these are
+  *     bit 5: c5-c8, bit 6: c5-c9, bit 7: c6-c8, bit 8: c5-c6
+  */
+template <typename Pixel, typename EdgeOp>
+static void calcEdges(
+	const Pixel* __restrict curr, const Pixel* __restrict next,
+	unsigned srcWidth, uint16_t* __restrict edges, EdgeOp edgeOp,
+	unsigned x = 0)
+{
+	uint32_t c5 = readPixel(curr[x]);
+	uint32_t c8 = readPixel(next[x]);
+	for (/* */; x < srcWidth; ++x) {
+		uint32_t c6 = c5;
+		uint32_t c9 = c8;
+		if (x != srcWidth - 1) {
+			c6 = readPixel(curr[x + 1]);
+			c9 = readPixel(next[x + 1]);
+		}
+		uint16_t pattern = 0;
+		if (edgeOp(c5, c8)) pattern |= 1 << 5;
+		if (edgeOp(c5, c9)) pattern |= 1 << 6;
+		if (edgeOp(c6, c8)) pattern |= 1 << 7;
+		if (edgeOp(c5, c6)) pattern |= 1 << 8;
+		edges[x] = pattern;
+		c5 = c6;
+		c8 = c9;
+	}
+}
+
+#ifdef __SSE2__
+// 32bpp: 8 pixels per step.
+template <typename EdgeOp>
+static void calcEdges(
+	const uint32_t* __restrict curr, const uint32_t* __restrict next,
+	unsigned srcWidth, uint16_t* __restrict edges, EdgeOp edgeOp)
+{
+	auto load = [](const uint32_t* p) {
+		return _mm_and_si128( // readPixel()
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+			_mm_set1_epi32(0xF8F8F8F8));
+	};
+	unsigned x = 0;
+	for (/* */; (x + 8) < srcWidth; x += 8) {
+		__m128i c5a = load(curr + x + 0), c5b = load(curr + x + 4);
+		__m128i c6a = load(curr + x + 1), c6b = load(curr + x + 5);
+		__m128i c8a = load(next + x + 0), c8b = load(next + x + 4);
+		__m128i c9a = load(next + x + 1), c9b = load(next + x + 5);
+		__m128i e58 = edgeOp(c5a, c5b, c8a, c8b);
+		__m128i e59 = edgeOp(c5a, c5b, c9a, c9b);
+		__m128i e68 = edgeOp(c6a, c6b, c8a, c8b);
+		__m128i e56 = edgeOp(c5a, c5b, c6a, c6b);
+		__m128i pattern = _mm_or_si128(
+			_mm_or_si128(_mm_and_si128(e58, _mm_set1_epi16(1 << 5)),
+			             _mm_and_si128(e59, _mm_set1_epi16(1 << 6))),
+			_mm_or_si128(_mm_and_si128(e68, _mm_set1_epi16(1 << 7)),
+			             _mm_and_si128(e56, _mm_set1_epi16(1 << 8))));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(edges + x), pattern);
+	}
+	// remaining pixels (including the last one)
+	calcEdges<uint32_t>(curr, next, srcWidth, edges, edgeOp, x);
+}
+#endif
+
 template <typename EdgeOp>
 void calcEdgesGL(const uint32_t* __restrict curr, const uint32_t* __restrict next,
                  uint32_t* __restrict edges2, EdgeOp edgeOp)
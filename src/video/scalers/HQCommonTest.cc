@@ -0,0 +1,182 @@
+// Checks that the SSE2 edge detection of the HQ and MLAA scalers gives
+// exactly the same result as the plain C++ code.
+//
+// Usage: HQCommonTest [<image.png> ...]
+// Without arguments only generated test images are used. Screenshots given
+// on the command line (e.g. doc/manual/nocartfound.png) are checked as
+// well, those contain real MSX graphics instead of random pixels.
+
+#include "HQCommon.hh"
+#include "MLAAScaler.hh"
+#include "PNG.hh"
+#include "MSXException.hh"
+#include <SDL.h>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cassert>
+
+using namespace openmsx;
+
+#ifdef __SSE2__
+
+template<typename EdgeOp>
+static bool checkHQ(const uint32_t* image, unsigned width, unsigned height,
+                    EdgeOp edgeOp)
+{
+	std::vector<uint16_t> simd(width), plain(width);
+	for (unsigned y = 0; (y + 1) < height; ++y) {
+		const uint32_t* curr = &image[(y + 0) * width];
+		const uint32_t* next = &image[(y + 1) * width];
+		calcEdges(curr, next, width, simd.data(), edgeOp);
+		calcEdges<uint32_t>(curr, next, width, plain.data(), edgeOp, 0);
+		if (simd != plain) return false;
+	}
+	return true;
+}
+
+// The first and last line are only used as neighbours.
+template<typename Pixel>
+static bool checkMLAA(const Pixel* image, unsigned width, unsigned height)
+{
+	assert(height >= 3);
+	std::vector<const Pixel*> lines;
+	for (unsigned y = 0; y < height; ++y) {
+		lines.push_back(&image[y * width]);
+	}
+	unsigned n = height - 2;
+	std::vector<uint8_t> simd(width * n), plain(width * n);
+	MLAAScaler<Pixel>::calcEdges(&lines[1], n, width, simd.data(), true);
+	MLAAScaler<Pixel>::calcEdges(&lines[1], n, width, plain.data(), false);
+	return simd == plain;
+}
+
+static std::vector<uint16_t> to16bpp(const std::vector<uint32_t>& image)
+{
+	std::vector<uint16_t> result;
+	for (auto p : image) {
+		result.push_back(((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) |
+		                 ((p >> 3) & 0x001F));
+	}
+	return result;
+}
+
+static void checkImage(const std::vector<uint32_t>& image, unsigned width)
+{
+	auto height = unsigned(image.size() / width);
+	assert(checkHQ(image.data(), width, height, EdgeHQ(0, 8, 16)));
+	assert(checkHQ(image.data(), width, height, EdgeHQ(16, 8, 0)));
+	assert(checkHQ(image.data(), width, height, EdgeHQLite()));
+	assert(checkMLAA(image.data(), width, height));
+	auto image16 = to16bpp(image);
+	assert(checkMLAA(image16.data(), width, height));
+}
+
+// 'height' lines of random pixels, taken from a palette of 'numColors'
+// random colors. With few colors many neighbouring pixels are equal. With
+// 'numColors' zero all channels are random values close to 0x80, then the
+// differences are often close to the thresholds of EdgeHQ.
+static std::vector<uint32_t> makePattern(
+	std::mt19937& rng, unsigned width, unsigned height, unsigned numColors)
+{
+	std::vector<uint32_t> palette(numColors);
+	for (auto& c : palette) c = rng();
+	std::vector<uint32_t> result(width * height);
+	for (auto& p : result) {
+		if (numColors) {
+			p = palette[rng() % numColors];
+		} else {
+			uint32_t c = 0;
+			for (int i = 0; i < 4; ++i) {
+				c = (c << 8) | (0x5C + rng() % 0x49);
+			}
+			p = c;
+		}
+	}
+	return result;
+}
+
+static void checkPatterns()
+{
+	// fixed seed: the same patterns in every run
+	std::mt19937 rng(12345);
+	// cover the SIMD loop and the scalar tails
+	static const unsigned widths[] = {
+		1, 2, 7, 8, 9, 15, 16, 17, 18, 31, 32, 33, 34, 256, 272, 320, 512, 640,
+	};
+	static const unsigned numColors[] = { 2, 16, 1 << 16, 0 };
+	for (auto w : widths) {
+		for (auto n : numColors) {
+			checkImage(makePattern(rng, w, 10, n), w);
+		}
+	}
+}
+
+// All combinations of channel differences in the range [-0x48, 0x48]
+// between the pixels of two lines, that covers all thresholds of EdgeHQ.
+static void checkHQDeltas()
+{
+	static const int MAX = 0x48;
+	static const unsigned N = 2 * MAX + 1;
+	auto pixel = [](int r, int g, int b) {
+		return uint32_t(((0x80 + b) << 16) | ((0x80 + g) << 8) | (0x80 + r));
+	};
+	std::vector<uint32_t> image(2 * N * N, pixel(0, 0, 0));
+	for (int dr = -MAX; dr <= MAX; ++dr) {
+		for (int dg = -MAX; dg <= MAX; ++dg) {
+			for (int db = -MAX; db <= MAX; ++db) {
+				image[N * N + (dg + MAX) * N + (db + MAX)] =
+					pixel(dr, dg, db);
+			}
+		}
+		assert(checkHQ(image.data(), N * N, 2, EdgeHQ(0, 8, 16)));
+		assert(checkHQ(image.data(), N * N, 2, EdgeHQ(16, 8, 0)));
+	}
+}
+
+static void checkScreenshot(const char* filename)
+{
+	SDLSurfacePtr surface = PNG::load(filename, true);
+	auto width  = unsigned(surface->w);
+	auto height = unsigned(surface->h);
+	std::vector<uint32_t> image(width * height);
+	for (unsigned y = 0; y < height; ++y) {
+		memcpy(&image[y * width], surface.getLinePtr(y),
+		       width * sizeof(uint32_t));
+	}
+	checkImage(image, width);
+	// also at the MSX resolution, those are the lines the scalers see
+	std::vector<uint32_t> half;
+	for (unsigned y = 0; y < height; y += 2) {
+		for (unsigned x = 0; x < width; x += 2) {
+			half.push_back(image[y * width + x]);
+		}
+	}
+	checkImage(half, (width + 1) / 2);
+}
+
+int main(int argc, char** argv)
+{
+	checkPatterns();
+	checkHQDeltas();
+	for (int i = 1; i < argc; ++i) {
+		try {
+			checkScreenshot(argv[i]);
+		} catch (MSXException& e) {
+			std::cerr << argv[i] << ": " << e.getMessage() << '\n';
+			return 1;
+		}
+	}
+}
+
+#else
+
+int main()
+{
+	std::cout << "This build doesn't use SSE2, there's nothing to compare.\n";
+}
+
+#endif
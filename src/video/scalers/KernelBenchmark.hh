@@ -0,0 +1,19 @@
+#ifndef KERNELBENCHMARK_HH
+#define KERNELBENCHMARK_HH
+
+#include <string>
+
+namespace openmsx {
+namespace KernelBenchmark {
+
+/** Measure the speed of the pixel routines that have an AVX2 variant (see
+  * HostCPU), once with the SSE2 and once with the AVX2 variant. The result
+  * is a table with the time per output line of 640 pixels (32bpp).
+  * Used by 'benchmark kernels'.
+  */
+std::string run();
+
+} // namespace KernelBenchmark
+} // namespace openmsx
+
+#endif
@@ -2,9 +2,11 @@
 #define LINESCALERS_HH
 
 #include "PixelOperations.hh"
+#include "HostCPU.hh"
 #include "likely.hh"
 #include <type_traits>
 #include <cstring>
+#include <cstdint>
 #include <cassert>
 #ifdef __SSE2__
 #include "emmintrin.h"
@@ -12,6 +14,9 @@
 #ifdef __SSSE3__
 #include "tmmintrin.h"
 #endif
+#if ASM_AVX2
+#include "immintrin.h"
+#endif
 
 namespace openmsx {
 
@@ -452,6 +457,111 @@ static inline void scale_1on2_SSE(const Pixel* in_, Pixel* out_, size_t srcWidth
 }
 #endif
 
+#if ASM_AVX2
+// AVX2 variants of the routines above, only used when the host CPU supports
+// it (see HostCPU). The 256-bit unpack instructions work per 128-bit lane,
+// so the lanes have to be put in the right order again.
+template<typename Pixel> TARGET_AVX2 static inline __m256i unpacklo(__m256i x, __m256i y)
+{
+	if (sizeof(Pixel) == 4) {
+		return _mm256_unpacklo_epi32(x, y);
+	} else if (sizeof(Pixel) == 2) {
+		return _mm256_unpacklo_epi16(x, y);
+	} else {
+		UNREACHABLE;
+	}
+}
+template<typename Pixel> TARGET_AVX2 static inline __m256i unpackhi(__m256i x, __m256i y)
+{
+	if (sizeof(Pixel) == 4) {
+		return _mm256_unpackhi_epi32(x, y);
+	} else if (sizeof(Pixel) == 2) {
+		return _mm256_unpackhi_epi16(x, y);
+	} else {
+		UNREACHABLE;
+	}
+}
+
+template<typename Pixel>
+TARGET_AVX2 static inline void scale_1on2_AVX2(
+	const Pixel* in_, Pixel* out_, size_t srcWidth)
+{
+	size_t bytes = srcWidth * sizeof(Pixel);
+	assert((bytes % (2 * sizeof(__m256i))) == 0);
+	assert(bytes != 0);
+
+	auto* in  = reinterpret_cast<const char*>(in_)  +     bytes;
+	auto* out = reinterpret_cast<      char*>(out_) + 2 * bytes;
+
+	auto x = -ptrdiff_t(bytes);
+	do {
+		__m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x +  0));
+		__m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x + 32));
+		__m256i l0 = unpacklo<Pixel>(a0, a0);
+		__m256i h0 = unpackhi<Pixel>(a0, a0);
+		__m256i l1 = unpacklo<Pixel>(a1, a1);
+		__m256i h1 = unpackhi<Pixel>(a1, a1);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2*x +  0), _mm256_permute2x128_si256(l0, h0, 0x20));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2*x + 32), _mm256_permute2x128_si256(l0, h0, 0x31));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2*x + 64), _mm256_permute2x128_si256(l1, h1, 0x20));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2*x + 96), _mm256_permute2x128_si256(l1, h1, 0x31));
+		x += 2 * sizeof(__m256i);
+	} while (x < 0);
+}
+
+TARGET_AVX2 static inline void memcpy_AVX2_128(
+	const void* __restrict in_, void* __restrict out_, size_t size)
+{
+	assert((size % 128) == 0);
+	assert(size != 0);
+
+	auto* in  = reinterpret_cast<const __m256i*>(in_);
+	auto* out = reinterpret_cast<      __m256i*>(out_);
+	auto* end = in + (size / sizeof(__m256i));
+	do {
+		__m256i a0 = _mm256_loadu_si256(in + 0);
+		__m256i a1 = _mm256_loadu_si256(in + 1);
+		__m256i a2 = _mm256_loadu_si256(in + 2);
+		__m256i a3 = _mm256_loadu_si256(in + 3);
+		_mm256_storeu_si256(out + 0, a0);
+		_mm256_storeu_si256(out + 1, a1);
+		_mm256_storeu_si256(out + 2, a2);
+		_mm256_storeu_si256(out + 3, a3);
+		in += 4;
+		out += 4;
+	} while (in != end);
+}
+
+// Only for 32bpp, see blend() below.
+TARGET_AVX2 static inline void scale_2on1_AVX2(
+	const uint32_t* __restrict in_, uint32_t* __restrict out_, size_t dstBytes)
+{
+	assert((dstBytes % (2 * sizeof(__m256i))) == 0);
+	assert(dstBytes != 0);
+
+	auto* in  = reinterpret_cast<const char*>(in_)  + 2 * dstBytes;
+	auto* out = reinterpret_cast<      char*>(out_) +     dstBytes;
+
+	auto x = -ptrdiff_t(dstBytes);
+	do {
+		__m256 a0 = _mm256_loadu_ps(reinterpret_cast<const float*>(in + 2*x +  0));
+		__m256 a1 = _mm256_loadu_ps(reinterpret_cast<const float*>(in + 2*x + 32));
+		__m256 a2 = _mm256_loadu_ps(reinterpret_cast<const float*>(in + 2*x + 64));
+		__m256 a3 = _mm256_loadu_ps(reinterpret_cast<const float*>(in + 2*x + 96));
+		// even/odd pixels, but (per lane) in the order 0 1 4 5 2 3 6 7
+		__m256i p0 = _mm256_castps_si256(_mm256_shuffle_ps(a0, a1, 0x88));
+		__m256i q0 = _mm256_castps_si256(_mm256_shuffle_ps(a0, a1, 0xDD));
+		__m256i p1 = _mm256_castps_si256(_mm256_shuffle_ps(a2, a3, 0x88));
+		__m256i q1 = _mm256_castps_si256(_mm256_shuffle_ps(a2, a3, 0xDD));
+		__m256i b0 = _mm256_permute4x64_epi64(_mm256_avg_epu8(p0, q0), 0xD8);
+		__m256i b1 = _mm256_permute4x64_epi64(_mm256_avg_epu8(p1, q1), 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x +  0), b0);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x + 32), b1);
+		x += 2 * sizeof(__m256i);
+	} while (x < 0);
+}
+#endif
+
 template <typename Pixel>
 void Scale_1on2<Pixel>::operator()(
 	const Pixel* __restrict in, Pixel* __restrict out, size_t dstWidth)
@@ -473,6 +583,11 @@ void Scale_1on2<Pixel>::operator()(
 #ifdef __SSE2__
 	size_t chunk = 4 * sizeof(__m128i) / sizeof(Pixel);
 	size_t srcWidth2 = srcWidth & ~(chunk - 1);
+#if ASM_AVX2
+	if (HostCPU::hasAVX2()) {
+		scale_1on2_AVX2(in, out, srcWidth2);
+	} else
+#endif
 	scale_1on2_SSE(in, out, srcWidth2);
 	in  +=      srcWidth2;
 	out +=  2 * srcWidth2;
@@ -527,6 +642,11 @@ void Scale_1on1<Pixel>::operator()(
 	// 10% faster than a simple memcpy(). When using gcc-4.6 (still the
 	// default on many systems), it's still about 66% faster.
 	size_t n128 = nBytes & ~127;
+#if ASM_AVX2
+	if (HostCPU::hasAVX2()) {
+		memcpy_AVX2_128(in, out, n128);
+	} else
+#endif
 	memcpy_SSE_128(in, out, n128); // copy 128 byte chunks
 	nBytes &= 127; // remaning bytes (if any)
 	if (likely(nBytes == 0)) return;
@@ -673,6 +793,14 @@ void Scale_2on1<Pixel>::operator()(
 #ifdef __SSE2__
 	size_t n64 = (dstWidth * sizeof(Pixel)) & ~63;
 	Pixel mask = pixelOps.getBlendMask();
+#if ASM_AVX2
+	if ((sizeof(Pixel) == 4) && HostCPU::hasAVX2()) {
+		// cast to avoid compilation error in case of 16bpp (even
+		// though this code is dead in that case).
+		scale_2on1_AVX2(reinterpret_cast<const uint32_t*>(in),
+		                reinterpret_cast<uint32_t*>(out), n64);
+	} else
+#endif
 	scale_2on1_SSE(in, out, n64, mask); // process 64 byte chunks
 	dstWidth &= ((64 / sizeof(Pixel)) - 1); // remaning pixels (if any)
 	if (likely(dstWidth == 0)) return;
@@ -3,16 +3,44 @@
 #include "ScalerOutput.hh"
 #include "Math.hh"
 #include "MemBuffer.hh"
-#include "MemBuffer.hh"
 #include "vla.hh"
 #include "build-info.hh"
 #include <algorithm>
 #include <vector>
 #include <cassert>
 #include <cstdint>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace openmsx {
 
+#ifdef __SSE2__
+// Compare 16 pixels: 0xFF in each byte where a and b differ, 0 elsewhere.
+static inline __m128i notEqual16(const uint32_t* a, const uint32_t* b)
+{
+	__m128i eq[4];
+	for (int i = 0; i < 4; ++i) {
+		eq[i] = _mm_cmpeq_epi32(
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 4 * i)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 4 * i)));
+	}
+	__m128i eq8 = _mm_packs_epi16(_mm_packs_epi32(eq[0], eq[1]),
+	                              _mm_packs_epi32(eq[2], eq[3]));
+	return _mm_xor_si128(eq8, _mm_set1_epi8(-1));
+}
+static inline __m128i notEqual16(const uint16_t* a, const uint16_t* b)
+{
+	__m128i eq[2];
+	for (int i = 0; i < 2; ++i) {
+		eq[i] = _mm_cmpeq_epi16(
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 8 * i)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 8 * i)));
+	}
+	return _mm_xor_si128(_mm_packs_epi16(eq[0], eq[1]), _mm_set1_epi8(-1));
+}
+#endif
+
 template <class Pixel>
 MLAAScaler<Pixel>::MLAAScaler(
 		unsigned dstWidth_, const PixelOperations<Pixel>& pixelOps_)
@@ -21,6 +49,65 @@ MLAAScaler<Pixel>::MLAAScaler(
 {
 }
 
+template <class Pixel>
+void MLAAScaler<Pixel>::calcEdges(
+		const Pixel* const* srcLinePtrs, int srcNumLines,
+		unsigned srcWidth, uint8_t* edgeGenPtr, bool useSimd)
+{
+#ifndef __SSE2__
+	(void)useSimd;
+#endif
+	for (int y = 0; y < srcNumLines; y++) {
+		auto* srcLinePtr = srcLinePtrs[y];
+		auto* upLinePtr = srcLinePtrs[y - 1];
+		auto* downLinePtr = srcLinePtrs[y + 1];
+		auto pixelEdges = [&](unsigned x) {
+			Pixel colMid = srcLinePtr[x];
+			uint8_t pixEdges = 0;
+			if (x > 0 && srcLinePtr[x - 1] != colMid) {
+				pixEdges |= LEFT;
+			}
+			if (x < srcWidth - 1 && srcLinePtr[x + 1] != colMid) {
+				pixEdges |= RIGHT;
+			}
+			if (upLinePtr[x] != colMid) {
+				pixEdges |= UP;
+			}
+			if (downLinePtr[x] != colMid) {
+				pixEdges |= DOWN;
+			}
+			return pixEdges;
+		};
+		unsigned x = 0;
+#ifdef __SSE2__
+		// Away from the left and right border, do 16 pixels at a time.
+		if (useSimd && (srcWidth > 17)) {
+			edgeGenPtr[0] = pixelEdges(0);
+			for (x = 1; (x + 16) < srcWidth; x += 16) {
+				const Pixel* mid = srcLinePtr + x;
+				__m128i e = _mm_or_si128(
+					_mm_or_si128(
+						_mm_and_si128(notEqual16(mid, upLinePtr + x),
+						              _mm_set1_epi8(UP)),
+						_mm_and_si128(notEqual16(mid, mid + 1),
+						              _mm_set1_epi8(RIGHT))),
+					_mm_or_si128(
+						_mm_and_si128(notEqual16(mid, downLinePtr + x),
+						              _mm_set1_epi8(DOWN)),
+						_mm_and_si128(notEqual16(mid, mid - 1),
+						              _mm_set1_epi8(LEFT))));
+				_mm_storeu_si128(
+					reinterpret_cast<__m128i*>(edgeGenPtr + x), e);
+			}
+		}
+#endif
+		for (/* */; x < srcWidth; x++) {
+			edgeGenPtr[x] = pixelEdges(x);
+		}
+		edgeGenPtr += srcWidth;
+	}
+}
+
 template <class Pixel>
 void MLAAScaler<Pixel>::scaleImage(
 		FrameSource& src, const RawFrame* superImpose,
@@ -57,29 +144,8 @@ void MLAAScaler<Pixel>::scaleImage(
 		srcLinePtrs[y] = line;
 	}
 
-	enum { UP = 1 << 0, RIGHT = 1 << 1, DOWN = 1 << 2, LEFT = 1 << 3 };
 	MemBuffer<uint8_t> edges(srcNumLines * srcWidth);
-	uint8_t* edgeGenPtr = edges.data();
-	for (int y = 0; y < srcNumLines; y++) {
-		auto* srcLinePtr = srcLinePtrs[y];
-		for (unsigned x = 0; x < srcWidth; x++) {
-			Pixel colMid = srcLinePtr[x];
-			uint8_t pixEdges = 0;
-			if (x > 0 && srcLinePtr[x - 1] != colMid) {
-				pixEdges |= LEFT;
-			}
-			if (x < srcWidth - 1 && srcLinePtr[x + 1] != colMid) {
-				pixEdges |= RIGHT;
-			}
-			if (srcLinePtrs[y - 1][x] != colMid) {
-				pixEdges |= UP;
-			}
-			if (srcLinePtrs[y + 1][x] != colMid) {
-				pixEdges |= DOWN;
-			}
-			*edgeGenPtr++ = pixEdges;
-		}
-	}
+	calcEdges(srcLinePtrs, srcNumLines, srcWidth, edges.data());
 
 	enum {
 		// Is this pixel part of an edge?
@@ -3,6 +3,7 @@
 
 #include "Scaler.hh"
 #include "PixelOperations.hh"
+#include <cstdint>
 
 namespace openmsx {
 
@@ -25,6 +26,20 @@ public:
 		unsigned srcStartY, unsigned srcEndY, unsigned srcWidth,
 		ScalerOutput<Pixel>& dst, unsigned dstStartY, unsigned dstEndY) override;
 
+	enum { UP = 1 << 0, RIGHT = 1 << 1, DOWN = 1 << 2, LEFT = 1 << 3 };
+
+	/** Calculate for each pixel of the given lines with which of its
+	  * neighbours (UP, RIGHT, DOWN, LEFT) it has an edge. The lines before
+	  * and after the given lines (srcLinePtrs[-1] and
+	  * srcLinePtrs[srcNumLines]) must also be valid.
+	  * @param useSimd Use the SSE2 code (if available). Only turned off to
+	  *                compare it with the plain C++ code, see
+	  *                HQCommonTest.cc.
+	  */
+	static void calcEdges(const Pixel* const* srcLinePtrs, int srcNumLines,
+	                      unsigned srcWidth, uint8_t* edges,
+	                      bool useSimd = true);
+
 private:
 	const PixelOperations<Pixel> pixelOps;
 	const unsigned dstWidth;
@@ -1,5 +1,6 @@
 #include "Scanline.hh"
 #include "PixelOperations.hh"
+#include "HostCPU.hh"
 #include "unreachable.hh"
 #include <cassert>
 #include <cstddef>
@@ -7,6 +8,9 @@
 #ifdef __SSE2__
 #include <emmintrin.h>
 #endif
+#if ASM_AVX2
+#include <immintrin.h>
+#endif
 
 namespace openmsx {
 
@@ -186,6 +190,65 @@ static inline void drawSSE2(
 
 #endif
 
+#if ASM_AVX2
+
+// 32bpp, same as drawSSE2() but on 32 bytes at a time. Unpack and pack both
+// work per 128-bit lane, so the pixels end up in the right order.
+TARGET_AVX2 static inline void drawAVX2_1(
+	const char* __restrict in1, const char* __restrict in2,
+	      char* __restrict out, __m256i f)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in1));
+	__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in2));
+	__m256i c = _mm256_avg_epu8(a, b);
+	__m256i l = _mm256_unpacklo_epi8(c, zero);
+	__m256i h = _mm256_unpackhi_epi8(c, zero);
+	__m256i m = _mm256_mulhi_epu16(l, f);
+	__m256i n = _mm256_mulhi_epu16(h, f);
+	__m256i r = _mm256_packus_epi16(m, n);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), r);
+}
+TARGET_AVX2 static void drawAVX2(
+	const uint32_t* __restrict in1_,
+	const uint32_t* __restrict in2_,
+	      uint32_t* __restrict out_,
+	unsigned factor,
+	size_t width,
+	PixelOperations<uint32_t>& /*dummy*/,
+	Multiply<uint32_t>& /*dummy*/)
+{
+	width *= sizeof(uint32_t); // in bytes
+	assert(width >= 64);
+	assert((width % 64) == 0);
+	auto* in1 = reinterpret_cast<const char*>(in1_) + width;
+	auto* in2 = reinterpret_cast<const char*>(in2_) + width;
+	auto* out = reinterpret_cast<      char*>(out_) + width;
+
+	__m256i f = _mm256_set1_epi16(factor << 8);
+	ptrdiff_t x = -ptrdiff_t(width);
+	do {
+		drawAVX2_1(in1 + x +  0, in2 + x +  0, out + x +  0, f);
+		drawAVX2_1(in1 + x + 32, in2 + x + 32, out + x + 32, f);
+		x += 64;
+	} while (x < 0);
+}
+
+// 16bpp, the table lookups dominate, there's no AVX2 variant.
+static inline void drawAVX2(
+	const uint16_t* __restrict in1,
+	const uint16_t* __restrict in2,
+	      uint16_t* __restrict out,
+	unsigned factor,
+	size_t width,
+	PixelOperations<uint16_t>& pixelOps,
+	Multiply<uint16_t>& darkener)
+{
+	drawSSE2(in1, in2, out, factor, width, pixelOps, darkener);
+}
+
+#endif
+
 
 // class Scanline
 
@@ -202,6 +265,12 @@ void Scanline<Pixel>::draw(
 	Pixel* __restrict dst, unsigned factor, size_t width)
 {
 #ifdef __SSE2__
+#if ASM_AVX2
+	if (HostCPU::hasAVX2()) {
+		drawAVX2(src1, src2, dst, factor, width, pixelOps, darkener);
+		return;
+	}
+#endif
 	drawSSE2(src1, src2, dst, factor, width, pixelOps, darkener);
 #else
 	// non-SSE2 routine, both 16bpp and 32bpp